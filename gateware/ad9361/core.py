@@ -131,7 +131,8 @@ class AD9361RFIC(LiteXModule):
         self.cd_rfic = ClockDomain("rfic")
 
         # SPI --------------------------------------------------------------------------------------
-        self.spi = AD9361SPIMaster(spi_pads, data_width=24, clk_divider=8)
+        # 80-bit: 16-bit instruction + up to 8 data bytes (AD9361 multi-byte transfers).
+        self.spi = AD9361SPIMaster(spi_pads, data_width=80, clk_divider=8)
 
         # Config / Status --------------------------------------------------------------------------
         self.sync += [
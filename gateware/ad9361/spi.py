@@ -19,6 +19,9 @@ class AD9361SPIMaster(LiteXModule):
 
     This module implements a 4-wire SPI Master with CPOL=0 and CPHA=1. It supports configurable data
     width and SPI clk divider at build time.
+
+    Transfers shorter than data_width shift out the MSBs of MOSI and return the received bits in the
+    LSBs of MISO.
     """
     def __init__(self, pads, data_width=24, clk_divider=2):
         self.pads = pads
@@ -32,6 +35,7 @@ class AD9361SPIMaster(LiteXModule):
                 ("``  8``", "8-bit transfer."),
                 ("`` 16``", "16-bit transfer."),
                 ("`` 24``", "24-bit transfer."),
+                ("`` 80``", "80-bit transfer (AD9361 8-byte multi-byte transfer)."),
             ], description="Transfer length in bits.")
         ])
         self._status  = CSRStatus(fields=[
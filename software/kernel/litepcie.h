@@ -28,6 +28,15 @@ struct litepcie_ioctl_flash {
 	__u64 rx_data; /* 40 bits */
 };
 
+#define LITEPCIE_FLASH_PAGE_SIZE 256
+
+struct litepcie_ioctl_flash_page {
+	uint32_t addr;     /* Flash address */
+	uint32_t is_write; /* 1: page program (write enable, program, wait end), 0: read */
+	uint32_t len;      /* Number of bytes (multiple of 4, up to LITEPCIE_FLASH_PAGE_SIZE) */
+	uint8_t data[LITEPCIE_FLASH_PAGE_SIZE];
+};
+
 struct litepcie_ioctl_icap {
 	uint8_t addr;
 	uint32_t data;
@@ -72,6 +81,91 @@ struct litepcie_ioctl_mmap_dma_update {
 	int64_t sw_count;
 };
 
+struct litepcie_ioctl_eventfd {
+	int32_t rx_fd;         /* eventfd signaled when RX buffers are ready, -1 to disable */
+	int32_t tx_fd;         /* eventfd signaled when TX buffers are free,  -1 to disable */
+	uint32_t rx_watermark; /* minimum number of RX buffers ready before signaling (1 to DMA_BUFFER_COUNT/2) */
+	uint32_t tx_watermark; /* minimum number of TX buffers free  before signaling (1 to DMA_BUFFER_COUNT/2) */
+};
+
+#define LITEPCIE_DMA_TIMESTAMP_COUNT 64
+
+struct litepcie_dma_timestamp {
+	int64_t hw_count;  /* DMA buffers count at MSI (from loop_status) */
+	int64_t host_time; /* Host time at MSI (ktime_get_raw, in ns) */
+	int64_t fpga_time; /* FPGA TimeGenerator time latched at MSI (in ns, 0 if not available/enabled) */
+};
+
+struct litepcie_ioctl_dma_timestamps {
+	uint8_t writer;  /* 1: DMA Writer (RX), 0: DMA Reader (TX) */
+	uint32_t count;  /* Number of valid records in ts */
+	uint64_t seq;    /* Number of records since DMA start */
+	struct litepcie_dma_timestamp ts[LITEPCIE_DMA_TIMESTAMP_COUNT]; /* Latest records, oldest first */
+};
+
+struct litepcie_ioctl_dma_timestamps_enable {
+	uint8_t enable; /* 1: latch FPGA time on DMA MSIs (while this file is open), 0: host time only */
+};
+
+#define LITEPCIE_TIME_OP_READ           0 /* Latch and read time */
+#define LITEPCIE_TIME_OP_WRITE          1 /* Write time counter (time = counter + adjustment) */
+#define LITEPCIE_TIME_OP_SET_ADJUSTMENT 2 /* Write time adjustment */
+#define LITEPCIE_TIME_OP_ADD_ADJUSTMENT 3 /* Add value to time adjustment (atomic read-modify-write) */
+
+struct litepcie_ioctl_time {
+	uint32_t op;         /* LITEPCIE_TIME_OP_* */
+	uint32_t reserved;
+	int64_t  value;      /* In: time counter (WRITE) or adjustment (SET/ADD_ADJUSTMENT) in ns */
+	int64_t  time;       /* Out: time after the operation in ns */
+	int64_t  adjustment; /* Out: time adjustment after the operation in ns */
+};
+
+#define LITEPCIE_IDENTIFIER_SIZE 256
+
+struct litepcie_ioctl_info {
+	char identifier[LITEPCIE_IDENTIFIER_SIZE]; /* SoC identifier (read at probe) */
+	uint64_t dna;                              /* FPGA DNA (read at probe, 0 if not available) */
+};
+
+#define LITEPCIE_REG_BATCH_MAX 32
+
+#define LITEPCIE_REG_OP_READ  0 /* val = CSR */
+#define LITEPCIE_REG_OP_WRITE 1 /* CSR = val */
+#define LITEPCIE_REG_OP_POLL  2 /* Wait (CSR & mask) == (val & mask), val = last CSR read */
+
+struct litepcie_reg_op {
+	uint32_t op;
+	uint32_t addr;
+	uint32_t val;
+	uint32_t mask;
+};
+
+struct litepcie_ioctl_reg_batch {
+	uint32_t count;      /* Number of ops */
+	uint32_t done;       /* Number of ops executed (returned) */
+	uint32_t timeout_us; /* Timeout of each poll op */
+	uint32_t reserved;
+	struct litepcie_reg_op ops[LITEPCIE_REG_BATCH_MAX];
+};
+
+struct litepcie_ioctl_mmap_csr_info {
+	uint64_t csr_offset; /* mmap offset of the CSR window */
+	uint64_t csr_size;   /* Size of the CSR window (0 if CSR mmap is disabled) */
+	uint64_t csr_base;   /* CSR address of the first byte of the window */
+};
+
+#define LITEPCIE_I2C_MAX_LEN 32
+
+struct litepcie_ioctl_i2c {
+	uint8_t slave_addr; /* 7-bit slave address */
+	uint8_t addr;       /* Register address */
+	uint8_t is_read;    /* 1: read len bytes (restart after addr), 0: write len bytes */
+	uint8_t send_stop;  /* Read: send a STOP between addr and restart */
+	uint8_t len;        /* Number of data bytes (1 to LITEPCIE_I2C_MAX_LEN) */
+	uint8_t reserved[3];
+	uint8_t data[LITEPCIE_I2C_MAX_LEN];
+};
+
 #define LITEPCIE_IOCTL 'S'
 
 #define LITEPCIE_IOCTL_REG               _IOWR(LITEPCIE_IOCTL,  0, struct litepcie_ioctl_reg)
@@ -85,5 +179,14 @@ struct litepcie_ioctl_mmap_dma_update {
 #define LITEPCIE_IOCTL_LOCK                      _IOWR(LITEPCIE_IOCTL, 25, struct litepcie_ioctl_lock)
 #define LITEPCIE_IOCTL_MMAP_DMA_WRITER_UPDATE    _IOW(LITEPCIE_IOCTL,  26, struct litepcie_ioctl_mmap_dma_update)
 #define LITEPCIE_IOCTL_MMAP_DMA_READER_UPDATE    _IOW(LITEPCIE_IOCTL,  27, struct litepcie_ioctl_mmap_dma_update)
+#define LITEPCIE_IOCTL_EVENTFD                   _IOW(LITEPCIE_IOCTL,  28, struct litepcie_ioctl_eventfd)
+#define LITEPCIE_IOCTL_DMA_TIMESTAMPS            _IOWR(LITEPCIE_IOCTL, 29, struct litepcie_ioctl_dma_timestamps)
+#define LITEPCIE_IOCTL_INFO                      _IOR(LITEPCIE_IOCTL,  30, struct litepcie_ioctl_info)
+#define LITEPCIE_IOCTL_MMAP_CSR_INFO             _IOR(LITEPCIE_IOCTL,  31, struct litepcie_ioctl_mmap_csr_info)
+#define LITEPCIE_IOCTL_REG_BATCH                 _IOWR(LITEPCIE_IOCTL, 32, struct litepcie_ioctl_reg_batch)
+#define LITEPCIE_IOCTL_I2C                       _IOWR(LITEPCIE_IOCTL, 33, struct litepcie_ioctl_i2c)
+#define LITEPCIE_IOCTL_FLASH_PAGE                _IOWR(LITEPCIE_IOCTL, 34, struct litepcie_ioctl_flash_page)
+#define LITEPCIE_IOCTL_DMA_TIMESTAMPS_ENABLE     _IOW(LITEPCIE_IOCTL,  35, struct litepcie_ioctl_dma_timestamps_enable)
+#define LITEPCIE_IOCTL_TIME                      _IOWR(LITEPCIE_IOCTL, 36, struct litepcie_ioctl_time)
 
 #endif /* _LINUX_LITEPCIE_H */
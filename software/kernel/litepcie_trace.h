@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+ *
+ * LitePCIe driver tracepoints
+ *
+ * This file is part of LitePCIe.
+ *
+ * Copyright (C) 2018-2024 / EnjoyDigital  / florent@enjoy-digital.fr
+ *
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM m2sdr
+
+#if !defined(_LITEPCIE_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _LITEPCIE_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/* MSI received (irq_vector already masked with the enabled interrupts) */
+TRACE_EVENT(litepcie_msi,
+	TP_PROTO(int irq, uint32_t irq_vector),
+	TP_ARGS(irq, irq_vector),
+	TP_STRUCT__entry(
+		__field(int, irq)
+		__field(uint32_t, irq_vector)
+	),
+	TP_fast_assign(
+		__entry->irq = irq;
+		__entry->irq_vector = irq_vector;
+	),
+	TP_printk("irq=%d vector=0x%08x", __entry->irq, __entry->irq_vector)
+);
+
+/* DMA counters update (hw_count from the MSI handler, sw_count from userspace) */
+DECLARE_EVENT_CLASS(litepcie_dma_count,
+	TP_PROTO(int minor, int64_t hw_count, int64_t sw_count),
+	TP_ARGS(minor, hw_count, sw_count),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(int64_t, hw_count)
+		__field(int64_t, sw_count)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->hw_count = hw_count;
+		__entry->sw_count = sw_count;
+	),
+	TP_printk("m2sdr%d hw_count=%lld sw_count=%lld backlog=%lld",
+		__entry->minor, __entry->hw_count, __entry->sw_count,
+		__entry->hw_count - __entry->sw_count)
+);
+
+DEFINE_EVENT(litepcie_dma_count, litepcie_dma_writer_hw_count,
+	TP_PROTO(int minor, int64_t hw_count, int64_t sw_count),
+	TP_ARGS(minor, hw_count, sw_count)
+);
+
+DEFINE_EVENT(litepcie_dma_count, litepcie_dma_writer_sw_count,
+	TP_PROTO(int minor, int64_t hw_count, int64_t sw_count),
+	TP_ARGS(minor, hw_count, sw_count)
+);
+
+DEFINE_EVENT(litepcie_dma_count, litepcie_dma_reader_hw_count,
+	TP_PROTO(int minor, int64_t hw_count, int64_t sw_count),
+	TP_ARGS(minor, hw_count, sw_count)
+);
+
+DEFINE_EVENT(litepcie_dma_count, litepcie_dma_reader_sw_count,
+	TP_PROTO(int minor, int64_t hw_count, int64_t sw_count),
+	TP_ARGS(minor, hw_count, sw_count)
+);
+
+/* DMA buffers lost (overflow on the Writer/RX side, underflow on the Reader/TX side) */
+DECLARE_EVENT_CLASS(litepcie_dma_lost,
+	TP_PROTO(int minor, int64_t count),
+	TP_ARGS(minor, count),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(int64_t, count)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->count = count;
+	),
+	TP_printk("m2sdr%d buffers=%lld", __entry->minor, __entry->count)
+);
+
+DEFINE_EVENT(litepcie_dma_lost, litepcie_dma_overflow,
+	TP_PROTO(int minor, int64_t count),
+	TP_ARGS(minor, count)
+);
+
+DEFINE_EVENT(litepcie_dma_lost, litepcie_dma_underflow,
+	TP_PROTO(int minor, int64_t count),
+	TP_ARGS(minor, count)
+);
+
+#endif /* _LITEPCIE_TRACE_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE litepcie_trace
+#include <trace/define_trace.h>
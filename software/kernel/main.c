@@ -33,6 +33,13 @@
 #include <linux/cdev.h>
 #include <linux/platform_device.h>
 #include <linux/version.h>
+#include <linux/eventfd.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/pipe_fs_i.h>
+#include <linux/splice.h>
+#include <linux/ptp_clock_kernel.h>
 
 #if defined(__arm__) || defined(__aarch64__)
 #include <linux/dma-direct.h>
@@ -43,6 +50,10 @@
 #include "config.h"
 #include "flags.h"
 #include "soc.h"
+#include "mem.h"
+
+#define CREATE_TRACE_POINTS
+#include "litepcie_trace.h"
 
 //#define DEBUG_CSR
 //#define DEBUG_MSI
@@ -57,6 +68,23 @@
 #define CSR_BASE 0x00000000
 #endif
 
+#ifndef CSR_SIZE
+#define CSR_SIZE 0x00010000
+#endif
+
+/* CSR window mmap offset (after the TX/RX DMA buffers) and size */
+#define LITEPCIE_CSR_MMAP_OFFSET (2 * DMA_BUFFER_TOTAL_SIZE)
+#define LITEPCIE_CSR_MMAP_SIZE   PAGE_ALIGN(CSR_SIZE)
+
+static bool csr_mmap = true;
+module_param(csr_mmap, bool, 0444);
+MODULE_PARM_DESC(csr_mmap, "Allow user-space mmap of the CSR window (direct MMIO CSR accesses)");
+
+/* Expose TimeGenerator as a PTP Hardware Clock when available */
+#if defined(CSR_TIME_GEN_BASE) && IS_ENABLED(CONFIG_PTP_1588_CLOCK)
+#define LITEPCIE_WITH_PTP
+#endif
+
 struct litepcie_dma_chan {
 	uint32_t base;
 	uint32_t writer_interrupt;
@@ -75,6 +103,29 @@ struct litepcie_dma_chan {
 	uint8_t reader_enable;
 	uint8_t writer_lock;
 	uint8_t reader_lock;
+	int writer_splice_offset;        /* bytes of the current DMA Writer buffer already spliced */
+};
+
+/* Histograms use log2(us) bins: [0-2us[, [2-4us[, [4-8us[, ..., [32ms-inf[ */
+#define LITEPCIE_HIST_BINS 16
+
+struct litepcie_chan_stats {
+	uint64_t writer_irqs;                                   /* DMA Writer (RX) MSIs */
+	uint64_t reader_irqs;                                   /* DMA Reader (TX) MSIs */
+	uint64_t writer_buffers;                                /* Buffers filled by the DMA Writer */
+	uint64_t reader_buffers;                                /* Buffers consumed by the DMA Reader */
+	uint64_t overflows;                                     /* RX buffers pending over DMA_BUFFER_COUNT/2 */
+	uint64_t underflows;                                    /* TX buffers consumed before being written */
+	int64_t writer_max_backlog;                             /* Max RX buffers pending for userspace */
+	int64_t reader_max_backlog;                             /* Max TX buffers queued by userspace */
+	ktime_t writer_irq_time;                                /* Time of last DMA Writer MSI */
+	ktime_t reader_irq_time;                                /* Time of last DMA Reader MSI */
+	bool writer_wakeup_pending;                             /* DMA Writer MSI not yet seen by a waiter */
+	bool reader_wakeup_pending;                             /* DMA Reader MSI not yet seen by a waiter */
+	uint64_t writer_wakeup_hist[LITEPCIE_HIST_BINS];        /* RX MSI to read/poll wakeup latency */
+	uint64_t reader_wakeup_hist[LITEPCIE_HIST_BINS];        /* TX MSI to write/poll wakeup latency */
+	uint64_t writer_irq_interval_hist[LITEPCIE_HIST_BINS];  /* Time between DMA Writer MSIs */
+	uint64_t reader_irq_interval_hist[LITEPCIE_HIST_BINS];  /* Time between DMA Reader MSIs */
 };
 
 struct litepcie_chan {
@@ -86,6 +137,23 @@ struct litepcie_chan {
 	wait_queue_head_t wait_rd; /* to wait for an ongoing read */
 	wait_queue_head_t wait_wr; /* to wait for an ongoing write */
 
+	spinlock_t eventfd_lock;         /* protects eventfd contexts against the IRQ handler */
+	struct eventfd_ctx *rx_eventfd;  /* signaled when rx_watermark RX buffers are ready */
+	struct eventfd_ctx *tx_eventfd;  /* signaled when tx_watermark TX buffers are free */
+	uint32_t rx_watermark;
+	uint32_t tx_watermark;
+	struct litepcie_chan_priv *eventfd_owner; /* file that registered the eventfds */
+
+	spinlock_t stats_lock;           /* protects stats against the IRQ handler */
+	struct litepcie_chan_stats stats;
+	struct dentry *debugfs_dir;
+
+	spinlock_t ts_lock;                                                     /* protects timestamps */
+	struct litepcie_dma_timestamp writer_ts[LITEPCIE_DMA_TIMESTAMP_COUNT]; /* DMA Writer MSI timestamps */
+	struct litepcie_dma_timestamp reader_ts[LITEPCIE_DMA_TIMESTAMP_COUNT]; /* DMA Reader MSI timestamps */
+	uint64_t writer_ts_seq;
+	uint64_t reader_ts_seq;
+
 	int index;
 	int minor;
 };
@@ -102,18 +170,35 @@ struct litepcie_device {
 	int minor_base;                               /* Base minor number for the device */
 	int irqs;                                     /* Number of IRQs */
 	int channels;                                 /* Number of DMA channels */
+	struct dentry *debugfs_dir;                   /* debugfs directory */
+	char identifier[LITEPCIE_IDENTIFIER_SIZE];    /* SoC identifier (read at probe) */
+	uint64_t dna;                                 /* FPGA DNA (read at probe) */
+	atomic_t fpga_ts_users;                       /* Files with FPGA MSI timestamps enabled */
+#ifdef CSR_SI5351_I2C_W_ADDR
+	struct mutex i2c_lock;                        /* I2C transactions lock */
+#endif
+#ifdef LITEPCIE_WITH_PTP
+	struct ptp_clock *ptp_clock;                  /* PTP Hardware Clock */
+	struct ptp_clock_info ptp_info;               /* PTP Hardware Clock capabilities/ops */
+	struct mutex ptp_lock;                        /* PTP Hardware Clock state lock */
+	int64_t ptp_last;                             /* Time of last frequency correction (ns) */
+	int64_t ptp_ppb;                              /* Frequency correction (ppb) */
+	int64_t ptp_frac;                             /* Frequency correction remainder (ns * 1e9) */
+#endif
 };
 
 struct litepcie_chan_priv {
 	struct litepcie_chan *chan;
 	bool reader;
 	bool writer;
+	bool fpga_ts;
 };
 
 static int litepcie_major;
 static int litepcie_minor_idx;
 static struct class *litepcie_class;
 static dev_t litepcie_dev_t;
+static struct dentry *litepcie_debugfs_root;
 
 /* Function to read a 32-bit value from a LitePCIe device register */
 static inline uint32_t litepcie_readl(struct litepcie_device *s, uint32_t addr)
@@ -136,6 +221,45 @@ static inline void litepcie_writel(struct litepcie_device *s, uint32_t addr, uin
 	return writel(val, s->bar0_addr + addr - CSR_BASE);
 }
 
+/* Function to add a duration to a log2(us) histogram */
+static inline void litepcie_hist_add(uint64_t *hist, ktime_t delta)
+{
+	int64_t us = ktime_to_us(delta);
+	int bin;
+
+	bin = (us < 2) ? 0 : ilog2((uint64_t)us);
+	if (bin >= LITEPCIE_HIST_BINS)
+		bin = LITEPCIE_HIST_BINS - 1;
+	hist[bin]++;
+}
+
+/* Functions to account the latency between a DMA MSI and the wakeup of a waiter */
+static inline void litepcie_stats_writer_wakeup(struct litepcie_chan *chan)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->stats_lock, flags);
+	if (chan->stats.writer_wakeup_pending) {
+		chan->stats.writer_wakeup_pending = false;
+		litepcie_hist_add(chan->stats.writer_wakeup_hist,
+			ktime_sub(ktime_get(), chan->stats.writer_irq_time));
+	}
+	spin_unlock_irqrestore(&chan->stats_lock, flags);
+}
+
+static inline void litepcie_stats_reader_wakeup(struct litepcie_chan *chan)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->stats_lock, flags);
+	if (chan->stats.reader_wakeup_pending) {
+		chan->stats.reader_wakeup_pending = false;
+		litepcie_hist_add(chan->stats.reader_wakeup_hist,
+			ktime_sub(ktime_get(), chan->stats.reader_irq_time));
+	}
+	spin_unlock_irqrestore(&chan->stats_lock, flags);
+}
+
 /* Function to enable a specific interrupt on a LitePCIe device */
 static void litepcie_enable_interrupt(struct litepcie_device *s, int irq_num)
 {
@@ -234,6 +358,10 @@ static void litepcie_dma_writer_start(struct litepcie_device *s, int chan_num)
 	dmachan->writer_hw_count = 0;
 	dmachan->writer_hw_count_last = 0;
 	dmachan->writer_sw_count = 0;
+	dmachan->writer_splice_offset = 0;
+	s->chan[chan_num].stats.writer_irq_time = 0;
+	s->chan[chan_num].stats.writer_wakeup_pending = false;
+	s->chan[chan_num].writer_ts_seq = 0;
 
 	/* Start DMA Writer. */
 	litepcie_writel(s, dmachan->base + PCIE_DMA_WRITER_ENABLE_OFFSET, 1);
@@ -268,6 +396,7 @@ static void litepcie_dma_writer_stop(struct litepcie_device *s, int chan_num)
 	dmachan->writer_hw_count = 0;
 	dmachan->writer_hw_count_last = 0;
 	dmachan->writer_sw_count = 0;
+	dmachan->writer_splice_offset = 0;
 }
 
 static void litepcie_dma_reader_start(struct litepcie_device *s, int chan_num)
@@ -300,6 +429,9 @@ static void litepcie_dma_reader_start(struct litepcie_device *s, int chan_num)
 	dmachan->reader_hw_count = 0;
 	dmachan->reader_hw_count_last = 0;
 	dmachan->reader_sw_count = 0;
+	s->chan[chan_num].stats.reader_irq_time = 0;
+	s->chan[chan_num].stats.reader_wakeup_pending = false;
+	s->chan[chan_num].reader_ts_seq = 0;
 
 	/* Start dma reader */
 	litepcie_writel(s, dmachan->base + PCIE_DMA_READER_ENABLE_OFFSET, 1);
@@ -336,6 +468,348 @@ static void litepcie_dma_reader_stop(struct litepcie_device *s, int chan_num)
 	dmachan->reader_sw_count = 0;
 }
 
+static inline void litepcie_eventfd_signal(struct eventfd_ctx *ctx)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 8, 0)
+	eventfd_signal(ctx, 1);
+#else
+	eventfd_signal(ctx);
+#endif
+}
+
+/* Replace the eventfds of a channel, releasing the previous ones */
+static void litepcie_set_eventfd(struct litepcie_chan *chan, struct litepcie_chan_priv *owner,
+				 struct eventfd_ctx *rx_ctx, struct eventfd_ctx *tx_ctx,
+				 uint32_t rx_watermark, uint32_t tx_watermark)
+{
+	struct eventfd_ctx *rx_old, *tx_old;
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->eventfd_lock, flags);
+	rx_old = chan->rx_eventfd;
+	tx_old = chan->tx_eventfd;
+	chan->rx_eventfd = rx_ctx;
+	chan->tx_eventfd = tx_ctx;
+	chan->rx_watermark = rx_watermark;
+	chan->tx_watermark = tx_watermark;
+	chan->eventfd_owner = owner;
+	spin_unlock_irqrestore(&chan->eventfd_lock, flags);
+
+	if (rx_old)
+		eventfd_ctx_put(rx_old);
+	if (tx_old)
+		eventfd_ctx_put(tx_old);
+}
+
+/* Release the eventfds of a channel if they were registered by owner */
+static void litepcie_release_eventfd(struct litepcie_chan *chan, struct litepcie_chan_priv *owner)
+{
+	struct eventfd_ctx *rx_old = NULL;
+	struct eventfd_ctx *tx_old = NULL;
+	unsigned long flags;
+
+	/* owner check and swap must be atomic against a concurrent EVENTFD ioctl */
+	spin_lock_irqsave(&chan->eventfd_lock, flags);
+	if (chan->eventfd_owner == owner) {
+		rx_old = chan->rx_eventfd;
+		tx_old = chan->tx_eventfd;
+		chan->rx_eventfd = NULL;
+		chan->tx_eventfd = NULL;
+		chan->rx_watermark = 1;
+		chan->tx_watermark = 1;
+		chan->eventfd_owner = NULL;
+	}
+	spin_unlock_irqrestore(&chan->eventfd_lock, flags);
+
+	if (rx_old)
+		eventfd_ctx_put(rx_old);
+	if (tx_old)
+		eventfd_ctx_put(tx_old);
+}
+
+#ifdef CSR_TIME_GEN_BASE
+/* TimeGenerator accesses (MSI latch, PTP clock, LITEPCIE_IOCTL_TIME) are serialized by s->lock, the
+ * __ helpers below must be called with it held. Pulses are written as constants (as user-space does)
+ * to not race with other CSR accesses to the control register. */
+
+static int64_t __litepcie_time_read(struct litepcie_device *s)
+{
+	int64_t time_ns;
+
+	litepcie_writel(s, CSR_TIME_GEN_CONTROL_ADDR,
+		(1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET) | (1 << CSR_TIME_GEN_CONTROL_READ_OFFSET));
+	litepcie_writel(s, CSR_TIME_GEN_CONTROL_ADDR,
+		(1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET));
+	time_ns  = (int64_t)litepcie_readl(s, CSR_TIME_GEN_READ_TIME_ADDR + 0) << 32;
+	time_ns |= (int64_t)litepcie_readl(s, CSR_TIME_GEN_READ_TIME_ADDR + 4) <<  0;
+
+	return time_ns;
+}
+
+static void __litepcie_time_write(struct litepcie_device *s, int64_t time_ns)
+{
+	litepcie_writel(s, CSR_TIME_GEN_WRITE_TIME_ADDR + 0, (uint32_t)(time_ns >> 32));
+	litepcie_writel(s, CSR_TIME_GEN_WRITE_TIME_ADDR + 4, (uint32_t)(time_ns >>  0));
+	litepcie_writel(s, CSR_TIME_GEN_CONTROL_ADDR,
+		(1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET) | (1 << CSR_TIME_GEN_CONTROL_WRITE_OFFSET));
+	litepcie_writel(s, CSR_TIME_GEN_CONTROL_ADDR,
+		(1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET));
+}
+
+static int64_t __litepcie_time_read_adjustment(struct litepcie_device *s)
+{
+	int64_t adjustment_ns;
+
+	adjustment_ns  = (int64_t)litepcie_readl(s, CSR_TIME_GEN_TIME_ADJUSTMENT_ADDR + 0) << 32;
+	adjustment_ns |= (int64_t)litepcie_readl(s, CSR_TIME_GEN_TIME_ADJUSTMENT_ADDR + 4) <<  0;
+
+	return adjustment_ns;
+}
+
+static void __litepcie_time_write_adjustment(struct litepcie_device *s, int64_t adjustment_ns)
+{
+	litepcie_writel(s, CSR_TIME_GEN_TIME_ADJUSTMENT_ADDR + 0, (uint32_t)(adjustment_ns >> 32));
+	litepcie_writel(s, CSR_TIME_GEN_TIME_ADJUSTMENT_ADDR + 4, (uint32_t)(adjustment_ns >>  0));
+}
+#endif
+
+/* Function to latch and read the FPGA TimeGenerator time (in ns) */
+static int64_t litepcie_read_fpga_time(struct litepcie_device *s)
+{
+#ifdef CSR_TIME_GEN_BASE
+	unsigned long flags;
+	int64_t time_ns;
+
+	spin_lock_irqsave(&s->lock, flags);
+	time_ns = __litepcie_time_read(s);
+	spin_unlock_irqrestore(&s->lock, flags);
+	return time_ns;
+#else
+	return 0;
+#endif
+}
+
+#ifdef LITEPCIE_WITH_PTP
+/* PTP Hardware Clock */
+
+/*
+ * TimeGenerator only provides an offset (time_adjustment) on top of a free-running ns counter, so
+ * frequency corrections are applied by the driver: the offset is moved by ppb * elapsed time on
+ * each access and periodically from the PTP auxiliary worker.
+ *
+ * While registered, the PHC owns time_adjustment. User-space time accesses (m2sdr_sync, SoapySDR)
+ * go through LITEPCIE_IOCTL_TIME, serialized with the PHC and the MSI latch by s->lock, and no
+ * shadow copy is kept: offsets are always applied as deltas to the value read back from the hardware.
+ */
+
+#define LITEPCIE_PTP_MAX_ADJ   1000000 /* in ppb */
+#define LITEPCIE_PTP_AUX_DELAY (HZ/10)
+
+static void litepcie_ptp_add_offset(struct litepcie_device *s, int64_t delta)
+{
+	unsigned long flags;
+
+	/* read-modify-write under s->lock: composes with LITEPCIE_IOCTL_TIME adjustments */
+	spin_lock_irqsave(&s->lock, flags);
+	__litepcie_time_write_adjustment(s, __litepcie_time_read_adjustment(s) + delta);
+	spin_unlock_irqrestore(&s->lock, flags);
+}
+
+/* Apply frequency correction since last call and return current time (called with ptp_lock held) */
+static int64_t litepcie_ptp_update(struct litepcie_device *s)
+{
+	int64_t now, delta;
+	s32 rem;
+
+	now = litepcie_read_fpga_time(s);
+	if (s->ptp_ppb != 0) {
+		delta = (now - s->ptp_last) * s->ptp_ppb + s->ptp_frac;
+		delta = div_s64_rem(delta, NSEC_PER_SEC, &rem);
+		s->ptp_frac = rem;
+		if (delta != 0) {
+			litepcie_ptp_add_offset(s, delta);
+			now += delta;
+		}
+	}
+	s->ptp_last = now;
+
+	return now;
+}
+
+static int litepcie_ptp_gettime64(struct ptp_clock_info *ptp, struct timespec64 *ts)
+{
+	struct litepcie_device *s = container_of(ptp, struct litepcie_device, ptp_info);
+	int64_t now;
+
+	mutex_lock(&s->ptp_lock);
+	now = litepcie_ptp_update(s);
+	mutex_unlock(&s->ptp_lock);
+
+	*ts = ns_to_timespec64(now);
+
+	return 0;
+}
+
+static int litepcie_ptp_settime64(struct ptp_clock_info *ptp, const struct timespec64 *ts)
+{
+	struct litepcie_device *s = container_of(ptp, struct litepcie_device, ptp_info);
+	unsigned long flags;
+	int64_t ns;
+
+	ns = timespec64_to_ns(ts);
+
+	mutex_lock(&s->ptp_lock);
+	s->ptp_frac   = 0;
+	s->ptp_last   = ns;
+	/* time = counter + time_adjustment: write the counter, keeping the current adjustment */
+	spin_lock_irqsave(&s->lock, flags);
+	__litepcie_time_write(s, ns - __litepcie_time_read_adjustment(s));
+	spin_unlock_irqrestore(&s->lock, flags);
+	mutex_unlock(&s->ptp_lock);
+
+	return 0;
+}
+
+static int litepcie_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
+{
+	struct litepcie_device *s = container_of(ptp, struct litepcie_device, ptp_info);
+
+	mutex_lock(&s->ptp_lock);
+	litepcie_ptp_update(s);
+	litepcie_ptp_add_offset(s, delta);
+	s->ptp_last   += delta;
+	mutex_unlock(&s->ptp_lock);
+
+	return 0;
+}
+
+static int litepcie_ptp_adjfine(struct ptp_clock_info *ptp, long scaled_ppm)
+{
+	struct litepcie_device *s = container_of(ptp, struct litepcie_device, ptp_info);
+
+	mutex_lock(&s->ptp_lock);
+	/* apply previous correction up to now, then switch to the new one */
+	litepcie_ptp_update(s);
+	/* scaled_ppm is ppm with a 16-bit fractional part: ppb = scaled_ppm * 1000 / 65536 */
+	s->ptp_ppb = div_s64((int64_t)scaled_ppm * 125, 8192);
+	mutex_unlock(&s->ptp_lock);
+
+	if (s->ptp_ppb != 0)
+		ptp_schedule_worker(s->ptp_clock, LITEPCIE_PTP_AUX_DELAY);
+
+	return 0;
+}
+
+static long litepcie_ptp_do_aux_work(struct ptp_clock_info *ptp)
+{
+	struct litepcie_device *s = container_of(ptp, struct litepcie_device, ptp_info);
+	long delay;
+
+	mutex_lock(&s->ptp_lock);
+	litepcie_ptp_update(s);
+	delay = (s->ptp_ppb != 0) ? LITEPCIE_PTP_AUX_DELAY : -1;
+	mutex_unlock(&s->ptp_lock);
+
+	return delay;
+}
+
+static const struct ptp_clock_info litepcie_ptp_info = {
+	.owner       = THIS_MODULE,
+	.name        = LITEPCIE_NAME,
+	.max_adj     = LITEPCIE_PTP_MAX_ADJ,
+	.gettime64   = litepcie_ptp_gettime64,
+	.settime64   = litepcie_ptp_settime64,
+	.adjtime     = litepcie_ptp_adjtime,
+	.adjfine     = litepcie_ptp_adjfine,
+	.do_aux_work = litepcie_ptp_do_aux_work,
+};
+
+static void litepcie_ptp_register(struct litepcie_device *s)
+{
+	mutex_init(&s->ptp_lock);
+	s->ptp_info   = litepcie_ptp_info;
+	s->ptp_ppb    = 0;
+	s->ptp_frac   = 0;
+	s->ptp_last   = litepcie_read_fpga_time(s);
+
+	s->ptp_clock = ptp_clock_register(&s->ptp_info, &s->dev->dev);
+	if (IS_ERR(s->ptp_clock)) {
+		dev_err(&s->dev->dev, "Failed to register PTP clock\n");
+		s->ptp_clock = NULL;
+	} else if (s->ptp_clock) {
+		dev_info(&s->dev->dev, "Registered PTP clock /dev/ptp%d\n", ptp_clock_index(s->ptp_clock));
+	}
+}
+
+static void litepcie_ptp_unregister(struct litepcie_device *s)
+{
+	if (s->ptp_clock)
+		ptp_clock_unregister(s->ptp_clock);
+	s->ptp_clock = NULL;
+}
+#endif
+
+#ifdef CSR_TIME_GEN_BASE
+/* Function to serve LITEPCIE_IOCTL_TIME: one kernel-serialized path for user-space time accesses */
+static int litepcie_time_ioctl(struct litepcie_device *s, struct litepcie_ioctl_time *m)
+{
+	unsigned long flags;
+	int ret = 0;
+#ifdef LITEPCIE_WITH_PTP
+	bool ptp = s->ptp_clock && (m->op != LITEPCIE_TIME_OP_READ);
+
+	/* writes: apply the pending PHC frequency correction first and restart it from the new time */
+	if (ptp) {
+		mutex_lock(&s->ptp_lock);
+		litepcie_ptp_update(s);
+	}
+#endif
+	spin_lock_irqsave(&s->lock, flags);
+	switch (m->op) {
+	case LITEPCIE_TIME_OP_READ:
+		break;
+	case LITEPCIE_TIME_OP_WRITE:
+		__litepcie_time_write(s, m->value);
+		break;
+	case LITEPCIE_TIME_OP_SET_ADJUSTMENT:
+		__litepcie_time_write_adjustment(s, m->value);
+		break;
+	case LITEPCIE_TIME_OP_ADD_ADJUSTMENT:
+		__litepcie_time_write_adjustment(s, __litepcie_time_read_adjustment(s) + m->value);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+	m->adjustment = __litepcie_time_read_adjustment(s);
+	m->time       = __litepcie_time_read(s);
+	spin_unlock_irqrestore(&s->lock, flags);
+#ifdef LITEPCIE_WITH_PTP
+	if (ptp) {
+		s->ptp_last = m->time;
+		mutex_unlock(&s->ptp_lock);
+	}
+#endif
+
+	return ret;
+}
+#endif
+
+/* Function to record a DMA MSI timestamp in a channel ring */
+static inline void litepcie_record_timestamp(struct litepcie_chan *chan, struct litepcie_dma_timestamp *ts,
+					     uint64_t *seq, int64_t hw_count, int64_t host_time, int64_t fpga_time)
+{
+	struct litepcie_dma_timestamp *t;
+
+	spin_lock(&chan->ts_lock);
+	t = &ts[*seq % LITEPCIE_DMA_TIMESTAMP_COUNT];
+	t->hw_count  = hw_count;
+	t->host_time = host_time;
+	t->fpga_time = fpga_time;
+	*seq += 1;
+	spin_unlock(&chan->ts_lock);
+}
+
 static void litepcie_stop_dma(struct litepcie_device *s)
 {
 	struct litepcie_dma_chan *dmachan;
@@ -354,6 +828,9 @@ static irqreturn_t litepcie_interrupt(int irq, void *data)
 	struct litepcie_chan *chan;
 	uint32_t loop_status;
 	uint32_t clear_mask, irq_vector, irq_enable;
+	int64_t hw_count_prev, backlog, lost;
+	int64_t host_time, fpga_time;
+	ktime_t now;
 	int i;
 
 /* Single MSI */
@@ -377,6 +854,16 @@ static irqreturn_t litepcie_interrupt(int irq, void *data)
 #endif
 	irq_vector &= irq_enable;
 	clear_mask = 0;
+	now = ktime_get();
+
+	trace_litepcie_msi(irq, irq_vector);
+
+	/* Timestamp MSI with Host and FPGA times (shared by all channels, FPGA time only latched when
+	 * requested through LITEPCIE_IOCTL_DMA_TIMESTAMPS_ENABLE: 4 MMIO accesses per MSI) */
+	host_time = ktime_get_raw_ns();
+	fpga_time = 0;
+	if (irq_vector && atomic_read(&s->fpga_ts_users))
+		fpga_time = litepcie_read_fpga_time(s);
 
 	for (i = 0; i < s->channels; i++) {
 		chan = &s->chan[i];
@@ -384,6 +871,7 @@ static irqreturn_t litepcie_interrupt(int irq, void *data)
 		if (irq_vector & (1 << chan->dma.reader_interrupt)) {
 			loop_status = litepcie_readl(s, chan->dma.base +
 				PCIE_DMA_READER_TABLE_LOOP_STATUS_OFFSET);
+			hw_count_prev = chan->dma.reader_hw_count_last;
 			chan->dma.reader_hw_count &= ((~(DMA_BUFFER_COUNT - 1) << 16) & 0xffffffffffff0000);
 			chan->dma.reader_hw_count |= (loop_status >> 16) * DMA_BUFFER_COUNT + (loop_status & 0xffff);
 			if (chan->dma.reader_hw_count_last > chan->dma.reader_hw_count)
@@ -393,13 +881,41 @@ static irqreturn_t litepcie_interrupt(int irq, void *data)
 			dev_dbg(&s->dev->dev, "MSI DMA%d Reader buf: %lld\n", i,
 				chan->dma.reader_hw_count);
 #endif
+			trace_litepcie_dma_reader_hw_count(chan->minor,
+				chan->dma.reader_hw_count, chan->dma.reader_sw_count);
+			litepcie_record_timestamp(chan, chan->reader_ts, &chan->reader_ts_seq,
+				chan->dma.reader_hw_count, host_time, fpga_time);
+			/* statistics */
+			spin_lock(&chan->stats_lock);
+			chan->stats.reader_irqs++;
+			chan->stats.reader_buffers += chan->dma.reader_hw_count - hw_count_prev;
+			backlog = chan->dma.reader_sw_count - chan->dma.reader_hw_count;
+			if (backlog > chan->stats.reader_max_backlog)
+				chan->stats.reader_max_backlog = backlog;
+			if (backlog < 0) {
+				lost = min(-backlog, chan->dma.reader_hw_count - hw_count_prev);
+				chan->stats.underflows += lost;
+				trace_litepcie_dma_underflow(chan->minor, lost);
+			}
+			if (chan->stats.reader_irq_time)
+				litepcie_hist_add(chan->stats.reader_irq_interval_hist,
+					ktime_sub(now, chan->stats.reader_irq_time));
+			chan->stats.reader_irq_time = now;
+			chan->stats.reader_wakeup_pending = true;
+			spin_unlock(&chan->stats_lock);
 			wake_up_interruptible(&chan->wait_wr);
+			spin_lock(&chan->eventfd_lock);
+			if (chan->tx_eventfd && (DMA_BUFFER_COUNT/2 -
+			    (chan->dma.reader_sw_count - chan->dma.reader_hw_count)) >= chan->tx_watermark)
+				litepcie_eventfd_signal(chan->tx_eventfd);
+			spin_unlock(&chan->eventfd_lock);
 			clear_mask |= (1 << chan->dma.reader_interrupt);
 		}
 		/* dma writer interrupt handling */
 		if (irq_vector & (1 << chan->dma.writer_interrupt)) {
 			loop_status = litepcie_readl(s, chan->dma.base +
 				PCIE_DMA_WRITER_TABLE_LOOP_STATUS_OFFSET);
+			hw_count_prev = chan->dma.writer_hw_count_last;
 			chan->dma.writer_hw_count &= ((~(DMA_BUFFER_COUNT - 1) << 16) & 0xffffffffffff0000);
 			chan->dma.writer_hw_count |= (loop_status >> 16) * DMA_BUFFER_COUNT + (loop_status & 0xffff);
 			if (chan->dma.writer_hw_count_last > chan->dma.writer_hw_count)
@@ -409,7 +925,34 @@ static irqreturn_t litepcie_interrupt(int irq, void *data)
 			dev_dbg(&s->dev->dev, "MSI DMA%d Writer buf: %lld\n", i,
 				chan->dma.writer_hw_count);
 #endif
+			trace_litepcie_dma_writer_hw_count(chan->minor,
+				chan->dma.writer_hw_count, chan->dma.writer_sw_count);
+			litepcie_record_timestamp(chan, chan->writer_ts, &chan->writer_ts_seq,
+				chan->dma.writer_hw_count, host_time, fpga_time);
+			/* statistics */
+			spin_lock(&chan->stats_lock);
+			chan->stats.writer_irqs++;
+			chan->stats.writer_buffers += chan->dma.writer_hw_count - hw_count_prev;
+			backlog = chan->dma.writer_hw_count - chan->dma.writer_sw_count;
+			if (backlog > chan->stats.writer_max_backlog)
+				chan->stats.writer_max_backlog = backlog;
+			if (backlog > DMA_BUFFER_COUNT/2) {
+				lost = min(backlog - DMA_BUFFER_COUNT/2, chan->dma.writer_hw_count - hw_count_prev);
+				chan->stats.overflows += lost;
+				trace_litepcie_dma_overflow(chan->minor, lost);
+			}
+			if (chan->stats.writer_irq_time)
+				litepcie_hist_add(chan->stats.writer_irq_interval_hist,
+					ktime_sub(now, chan->stats.writer_irq_time));
+			chan->stats.writer_irq_time = now;
+			chan->stats.writer_wakeup_pending = true;
+			spin_unlock(&chan->stats_lock);
 			wake_up_interruptible(&chan->wait_rd);
+			spin_lock(&chan->eventfd_lock);
+			if (chan->rx_eventfd &&
+			    (chan->dma.writer_hw_count - chan->dma.writer_sw_count) >= chan->rx_watermark)
+				litepcie_eventfd_signal(chan->rx_eventfd);
+			spin_unlock(&chan->eventfd_lock);
 			clear_mask |= (1 << chan->dma.writer_interrupt);
 		}
 	}
@@ -442,6 +985,7 @@ static int litepcie_open(struct inode *inode, struct file *file)
 		chan->dma.writer_hw_count = 0;
 		chan->dma.writer_hw_count_last = 0;
 		chan->dma.writer_sw_count = 0;
+		chan->dma.writer_splice_offset = 0;
 	}
 
 	return 0;
@@ -470,6 +1014,13 @@ static int litepcie_release(struct inode *inode, struct file *file)
 		chan->dma.writer_enable = 0;
 	}
 
+	/* release eventfds registered through this file */
+	litepcie_release_eventfd(chan, chan_priv);
+
+	/* release FPGA MSI timestamps request */
+	if (chan_priv->fpga_ts)
+		atomic_dec(&chan->litepcie_dev->fpga_ts_users);
+
 	kfree(chan_priv);
 
 	return 0;
@@ -498,6 +1049,8 @@ static ssize_t litepcie_read(struct file *file, char __user *data, size_t size,
 	if (ret < 0)
 		return ret;
 
+	litepcie_stats_writer_wakeup(chan);
+
 	i = 0;
 	overflows = 0;
 	len = size;
@@ -523,6 +1076,9 @@ static ssize_t litepcie_read(struct file *file, char __user *data, size_t size,
 	if (overflows)
 		dev_err(&s->dev->dev, "Reading too late, %d buffers lost\n", overflows);
 
+	trace_litepcie_dma_writer_sw_count(chan->minor,
+		chan->dma.writer_hw_count, chan->dma.writer_sw_count);
+
 #ifdef DEBUG_READ
 	dev_dbg(&s->dev->dev, "read: read %ld bytes out of %ld\n", size - len, size);
 #endif
@@ -553,6 +1109,8 @@ static ssize_t litepcie_write(struct file *file, const char __user *data, size_t
 	if (ret < 0)
 		return ret;
 
+	litepcie_stats_reader_wakeup(chan);
+
 	i = 0;
 	underflows = 0;
 	len = size;
@@ -577,6 +1135,9 @@ static ssize_t litepcie_write(struct file *file, const char __user *data, size_t
 	if (underflows)
 		dev_err(&s->dev->dev, "Writing too late, %d buffers lost\n", underflows);
 
+	trace_litepcie_dma_reader_sw_count(chan->minor,
+		chan->dma.reader_hw_count, chan->dma.reader_sw_count);
+
 #ifdef DEBUG_WRITE
 	dev_dbg(&s->dev->dev, "write: write %ld bytes out of %ld\n", size - len, size);
 #endif
@@ -584,6 +1145,184 @@ static ssize_t litepcie_write(struct file *file, const char __user *data, size_t
 	return size - len;
 }
 
+/* splice */
+
+/*
+ * The DMA Writer runs in loop mode and overwrites its buffers without any feedback from software,
+ * so DMA pages can't be lent to a pipe (the consumer may hold them for an unbounded time). Ready
+ * buffers are copied into freshly allocated pages that are then owned by the pipe: compared to
+ * read() + write(), this saves the copies to/from user-space and the user-space round-trip.
+ */
+static void litepcie_pipe_buf_release(struct pipe_inode_info *pipe, struct pipe_buffer *buf)
+{
+	put_page(buf->page);
+}
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 1, 0)
+static void litepcie_pipe_buf_get(struct pipe_inode_info *pipe, struct pipe_buffer *buf)
+{
+	get_page(buf->page);
+}
+#else
+static bool litepcie_pipe_buf_get(struct pipe_inode_info *pipe, struct pipe_buffer *buf)
+{
+	return try_get_page(buf->page);
+}
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 8, 0)
+/* confirm/steal are not optional on older kernels */
+static int litepcie_pipe_buf_confirm(struct pipe_inode_info *pipe, struct pipe_buffer *buf)
+{
+	return 0;
+}
+
+static int litepcie_pipe_buf_steal(struct pipe_inode_info *pipe, struct pipe_buffer *buf)
+{
+	return 1;
+}
+#endif
+
+static const struct pipe_buf_operations litepcie_pipe_buf_ops = {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 8, 0)
+	.confirm = litepcie_pipe_buf_confirm,
+	.steal = litepcie_pipe_buf_steal,
+#endif
+	.release = litepcie_pipe_buf_release,
+	.get = litepcie_pipe_buf_get,
+};
+
+static void litepcie_spd_release(struct splice_pipe_desc *spd, unsigned int i)
+{
+	put_page(spd->pages[i]);
+}
+
+static ssize_t litepcie_splice_read(struct file *file, loff_t *ppos, struct pipe_inode_info *pipe,
+				    size_t size, unsigned int flags)
+{
+	struct page *pages[PIPE_DEF_BUFFERS];
+	struct partial_page partial[PIPE_DEF_BUFFERS];
+	struct splice_pipe_desc spd = {
+		.pages = pages,
+		.partial = partial,
+		.nr_pages = 0,
+		.nr_pages_max = PIPE_DEF_BUFFERS,
+		.ops = &litepcie_pipe_buf_ops,
+		.spd_release = litepcie_spd_release,
+	};
+	struct page *page;
+	int i, ret;
+	int overflows, space, offset;
+	size_t len, chunk;
+
+	struct litepcie_chan_priv *chan_priv = file->private_data;
+	struct litepcie_chan *chan = chan_priv->chan;
+	struct litepcie_device *s = chan->litepcie_dev;
+
+	if (size < PAGE_SIZE)
+		return -EINVAL;
+
+	/* limit to the free pipe slots (in blocking mode, the splice core waits for a free slot) */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
+	space = pipe->max_usage - pipe_occupancy(pipe->head, pipe->tail);
+#else
+	space = pipe->buffers - pipe->nrbufs;
+#endif
+	space = min(space, PIPE_DEF_BUFFERS);
+	if (space <= 0)
+		return -EAGAIN;
+
+again:
+	if ((file->f_flags & O_NONBLOCK) || (flags & SPLICE_F_NONBLOCK)) {
+		if (chan->dma.writer_hw_count == chan->dma.writer_sw_count)
+			return -EAGAIN;
+	} else {
+		ret = wait_event_interruptible(chan->wait_rd,
+					       (chan->dma.writer_hw_count - chan->dma.writer_sw_count) > 0);
+		if (ret < 0)
+			return ret;
+	}
+
+	litepcie_stats_writer_wakeup(chan);
+
+	/* splice page by page, a buffer can be split over several calls when the pipe is almost full */
+	overflows = 0;
+	len = size;
+	while (spd.nr_pages < space) {
+		if ((chan->dma.writer_hw_count - chan->dma.writer_sw_count) <= 0)
+			break;
+		offset = chan->dma.writer_splice_offset;
+		if ((chan->dma.writer_hw_count - chan->dma.writer_sw_count) > DMA_BUFFER_COUNT/2) {
+			/* buffer lost (or overwritten while partially spliced): skip it */
+			overflows++;
+			chan->dma.writer_splice_offset = 0;
+			chan->dma.writer_sw_count += 1;
+			continue;
+		}
+		chunk = min_t(size_t, PAGE_SIZE, DMA_BUFFER_SIZE - offset);
+		if (len < chunk)
+			break;
+		page = alloc_page(GFP_KERNEL);
+		if (!page)
+			break;
+		i = chan->dma.writer_sw_count % DMA_BUFFER_COUNT;
+		memcpy(page_address(page), (uint8_t *)chan->dma.writer_addr[i] + offset, chunk);
+		pages[spd.nr_pages] = page;
+		partial[spd.nr_pages].offset  = 0;
+		partial[spd.nr_pages].len     = chunk;
+		partial[spd.nr_pages].private = 0;
+		spd.nr_pages++;
+		len -= chunk;
+		offset += chunk;
+		if (offset >= DMA_BUFFER_SIZE) {
+			chan->dma.writer_splice_offset = 0;
+			chan->dma.writer_sw_count += 1;
+		} else {
+			chan->dma.writer_splice_offset = offset;
+		}
+	}
+
+	if (overflows)
+		dev_err(&s->dev->dev, "Splicing too late, %d buffers lost\n", overflows);
+
+	trace_litepcie_dma_writer_sw_count(chan->minor,
+		chan->dma.writer_hw_count, chan->dma.writer_sw_count);
+
+	if (spd.nr_pages == 0) {
+		/* buffers pending but no page could be allocated */
+		if (!overflows && (chan->dma.writer_hw_count - chan->dma.writer_sw_count) > 0)
+			return -ENOMEM;
+		/* all pending buffers were lost: wait for new ones */
+		if ((file->f_flags & O_NONBLOCK) || (flags & SPLICE_F_NONBLOCK))
+			return -EAGAIN;
+		goto again;
+	}
+
+	return splice_to_pipe(pipe, &spd);
+}
+
+/* Map the CSR window of BAR0 (uncached, shared mappings only, nothing beyond the CSRs). */
+static int litepcie_mmap_csr(struct litepcie_device *s, struct vm_area_struct *vma)
+{
+	if (!csr_mmap)
+		return -EPERM;
+	if (vma->vm_end - vma->vm_start != LITEPCIE_CSR_MMAP_SIZE)
+		return -EINVAL;
+	if (LITEPCIE_CSR_MMAP_SIZE > s->bar0_size)
+		return -EINVAL;
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	if (io_remap_pfn_range(vma, vma->vm_start, s->bar0_phys_addr >> PAGE_SHIFT,
+			       LITEPCIE_CSR_MMAP_SIZE, vma->vm_page_prot)) {
+		dev_err(&s->dev->dev, "mmap io_remap_pfn_range failed\n");
+		return -EAGAIN;
+	}
+
+	return 0;
+}
+
 static int litepcie_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	struct litepcie_chan_priv *chan_priv = file->private_data;
@@ -592,6 +1331,9 @@ static int litepcie_mmap(struct file *file, struct vm_area_struct *vma)
 	unsigned long pfn;
 	int is_tx, i;
 
+	if (vma->vm_pgoff == (LITEPCIE_CSR_MMAP_OFFSET >> PAGE_SHIFT))
+		return litepcie_mmap_csr(s, vma);
+
 	if (vma->vm_end - vma->vm_start != DMA_BUFFER_TOTAL_SIZE)
 		return -EINVAL;
 
@@ -654,11 +1396,15 @@ static unsigned int litepcie_poll(struct file *file, poll_table *wait)
 	chan->dma.reader_hw_count, chan->dma.reader_sw_count);
 #endif
 
-	if ((chan->dma.writer_hw_count - chan->dma.writer_sw_count) > 2)
+	if ((chan->dma.writer_hw_count - chan->dma.writer_sw_count) > 2) {
 		mask |= POLLIN | POLLRDNORM;
+		litepcie_stats_writer_wakeup(chan);
+	}
 
-	if ((chan->dma.reader_sw_count - chan->dma.reader_hw_count) < DMA_BUFFER_COUNT/2)
+	if ((chan->dma.reader_sw_count - chan->dma.reader_hw_count) < DMA_BUFFER_COUNT/2) {
 		mask |= POLLOUT | POLLWRNORM;
+		litepcie_stats_reader_wakeup(chan);
+	}
 
 	return mask;
 }
@@ -668,29 +1414,281 @@ static unsigned int litepcie_poll(struct file *file, poll_table *wait)
 
 #define SPI_TIMEOUT 100000 /* in us */
 
-static int litepcie_flash_spi(struct litepcie_device *s, struct litepcie_ioctl_flash *m)
+static uint64_t litepcie_flash_spi_xfer(struct litepcie_device *s, int tx_len, uint64_t tx_data)
 {
 	int i;
 
-	if (m->tx_len < 8 || m->tx_len > 40)
-		return -EINVAL;
-
-	litepcie_writel(s, CSR_FLASH_SPI_MOSI_ADDR, m->tx_data >> 32);
-	litepcie_writel(s, CSR_FLASH_SPI_MOSI_ADDR + 4, m->tx_data);
+	litepcie_writel(s, CSR_FLASH_SPI_MOSI_ADDR, tx_data >> 32);
+	litepcie_writel(s, CSR_FLASH_SPI_MOSI_ADDR + 4, tx_data);
 	litepcie_writel(s, CSR_FLASH_SPI_CONTROL_ADDR,
-		SPI_CTRL_START | (m->tx_len * SPI_CTRL_LENGTH));
-	udelay(16);
+		SPI_CTRL_START | (tx_len * SPI_CTRL_LENGTH));
+	/* poll done (40 bits take 1.6us at 25MHz) */
 	for (i = 0; i < SPI_TIMEOUT; i++) {
 		if (litepcie_readl(s, CSR_FLASH_SPI_STATUS_ADDR) & SPI_STATUS_DONE)
 			break;
 		udelay(1);
 	}
-	m->rx_data = ((uint64_t)litepcie_readl(s, CSR_FLASH_SPI_MISO_ADDR) << 32) |
+	return ((uint64_t)litepcie_readl(s, CSR_FLASH_SPI_MISO_ADDR) << 32) |
 		litepcie_readl(s, CSR_FLASH_SPI_MISO_ADDR + 4);
+}
+
+static int litepcie_flash_spi(struct litepcie_device *s, struct litepcie_ioctl_flash *m)
+{
+	if (m->tx_len < 8 || m->tx_len > 40)
+		return -EINVAL;
+
+	m->rx_data = litepcie_flash_spi_xfer(s, m->tx_len, m->tx_data);
 	return 0;
 }
+
+#ifdef CSR_FLASH_CS_N_OUT_ADDR
+/* Flash pages (whole page read/program sequences in one ioctl) */
+
+#define FLASH_CMD_READ 0x03
+#define FLASH_CMD_WREN 0x06
+#define FLASH_CMD_PP   0x02
+#define FLASH_CMD_RDSR 0x05
+#define FLASH_WIP      0x01
+
+#define FLASH_PAGE_TIMEOUT 100000 /* in us */
+
+static uint64_t litepcie_flash_cmd(struct litepcie_device *s, int tx_len, uint8_t cmd, uint32_t tx_data)
+{
+	uint64_t rx_data;
+
+	litepcie_writel(s, CSR_FLASH_CS_N_OUT_ADDR, 0);
+	rx_data = litepcie_flash_spi_xfer(s, tx_len, ((uint64_t)cmd << 32) | tx_data);
+	litepcie_writel(s, CSR_FLASH_CS_N_OUT_ADDR, 1);
+	return rx_data;
+}
+
+static int litepcie_flash_page(struct litepcie_device *s, struct litepcie_ioctl_flash_page *m)
+{
+	ktime_t deadline;
+	uint64_t rx_data;
+	uint8_t *d;
+	int i;
+
+	if (m->len == 0 || m->len > LITEPCIE_FLASH_PAGE_SIZE || (m->len & 3))
+		return -EINVAL;
+	/* a page program can't cross a page boundary */
+	if (m->is_write && ((m->addr % LITEPCIE_FLASH_PAGE_SIZE) + m->len) > LITEPCIE_FLASH_PAGE_SIZE)
+		return -EINVAL;
+
+	if (m->is_write)
+		litepcie_flash_cmd(s, 8, FLASH_CMD_WREN, 0);
+
+	/* command/address then 4 bytes per SPI transfer */
+	litepcie_writel(s, CSR_FLASH_CS_N_OUT_ADDR, 0);
+	litepcie_flash_spi_xfer(s, 32,
+		((uint64_t)(m->is_write ? FLASH_CMD_PP : FLASH_CMD_READ) << 32) | ((uint64_t)m->addr << 8));
+	for (i = 0; i < m->len; i += 4) {
+		d = &m->data[i];
+		rx_data = litepcie_flash_spi_xfer(s, 32, m->is_write ?
+			(((uint64_t)d[0] << 32) | ((uint64_t)d[1] << 24) | ((uint64_t)d[2] << 16) | ((uint64_t)d[3] << 8)) : 0);
+		if (!m->is_write) {
+			d[0] = rx_data >> 24;
+			d[1] = rx_data >> 16;
+			d[2] = rx_data >>  8;
+			d[3] = rx_data >>  0;
+		}
+	}
+	litepcie_writel(s, CSR_FLASH_CS_N_OUT_ADDR, 1);
+
+	/* wait end of page program */
+	if (m->is_write) {
+		deadline = ktime_add_us(ktime_get(), FLASH_PAGE_TIMEOUT);
+		while (litepcie_flash_cmd(s, 16, FLASH_CMD_RDSR, 0) & FLASH_WIP) {
+			if (ktime_after(ktime_get(), deadline))
+				return -ETIMEDOUT;
+			usleep_range(10, 20);
+		}
+	}
+
+	return 0;
+}
+#endif
 #endif
 
+#ifdef CSR_SI5351_I2C_W_ADDR
+/* I2C (SI5351, bit-banged on the I2C CSRs: whole transactions in one ioctl) */
+
+#define I2C_DELAY_US 1 /* Quarter of SCL period (250kHz SCL) */
+
+static void litepcie_i2c_oe_scl_sda(struct litepcie_device *s, bool oe, bool scl, bool sda)
+{
+	litepcie_writel(s, CSR_SI5351_I2C_W_ADDR,
+		((oe  & 1) << CSR_SI5351_I2C_W_OE_OFFSET)  |
+		((scl & 1) << CSR_SI5351_I2C_W_SCL_OFFSET) |
+		((sda & 1) << CSR_SI5351_I2C_W_SDA_OFFSET));
+}
+
+static void litepcie_i2c_start(struct litepcie_device *s)
+{
+	litepcie_i2c_oe_scl_sda(s, 1, 1, 1);
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 1, 1, 0);
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 1, 0, 0);
+	udelay(I2C_DELAY_US);
+}
+
+static void litepcie_i2c_stop(struct litepcie_device *s)
+{
+	litepcie_i2c_oe_scl_sda(s, 1, 0, 0);
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 1, 1, 0);
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 1, 1, 1);
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 0, 1, 1);
+}
+
+static void litepcie_i2c_transmit_bit(struct litepcie_device *s, int value)
+{
+	litepcie_i2c_oe_scl_sda(s, 1, 0, value);
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 1, 1, value);
+	udelay(2*I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 1, 0, value);
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 0, 0, 0);
+}
+
+static int litepcie_i2c_receive_bit(struct litepcie_device *s)
+{
+	int value;
+
+	litepcie_i2c_oe_scl_sda(s, 0, 0, 0);
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 0, 1, 0);
+	udelay(I2C_DELAY_US);
+	value = litepcie_readl(s, CSR_SI5351_I2C_R_ADDR) & 1;
+	udelay(I2C_DELAY_US);
+	litepcie_i2c_oe_scl_sda(s, 0, 0, 0);
+	udelay(I2C_DELAY_US);
+	return value;
+}
+
+/* Transmit byte (MSB first) and return true if the slave sends an ACK */
+static bool litepcie_i2c_transmit_byte(struct litepcie_device *s, uint8_t data)
+{
+	int i;
+
+	litepcie_i2c_oe_scl_sda(s, 0, 0, 0);
+	for (i = 0; i < 8; i++) {
+		litepcie_i2c_transmit_bit(s, (data & (1 << 7)) != 0);
+		data <<= 1;
+	}
+	return litepcie_i2c_receive_bit(s) == 0;
+}
+
+/* Receive byte and send ACK if ack */
+static uint8_t litepcie_i2c_receive_byte(struct litepcie_device *s, bool ack)
+{
+	int i;
+	uint8_t data = 0;
+
+	for (i = 0; i < 8; i++) {
+		data <<= 1;
+		data |= litepcie_i2c_receive_bit(s);
+	}
+	litepcie_i2c_transmit_bit(s, !ack);
+
+	return data;
+}
+
+static int litepcie_i2c_xfer(struct litepcie_device *s, struct litepcie_ioctl_i2c *m)
+{
+	int i;
+
+	if (m->len < 1 || m->len > LITEPCIE_I2C_MAX_LEN || m->slave_addr > 0x7f)
+		return -EINVAL;
+
+	litepcie_i2c_start(s);
+	if (!litepcie_i2c_transmit_byte(s, m->slave_addr << 1) ||
+	    !litepcie_i2c_transmit_byte(s, m->addr))
+		goto nack;
+
+	if (m->is_read) {
+		if (m->send_stop)
+			litepcie_i2c_stop(s);
+		litepcie_i2c_start(s);
+		if (!litepcie_i2c_transmit_byte(s, (m->slave_addr << 1) | 1))
+			goto nack;
+		for (i = 0; i < m->len; i++)
+			m->data[i] = litepcie_i2c_receive_byte(s, i != (m->len - 1));
+	} else {
+		for (i = 0; i < m->len; i++)
+			if (!litepcie_i2c_transmit_byte(s, m->data[i]))
+				goto nack;
+	}
+	litepcie_i2c_stop(s);
+
+	return 0;
+
+nack:
+	litepcie_i2c_stop(s);
+	return -ENXIO;
+}
+#endif
+
+/* Register batch */
+
+#define REG_BATCH_TIMEOUT     10000  /* in us, default poll timeout */
+#define REG_BATCH_TIMEOUT_MAX 100000 /* in us */
+#define REG_BATCH_SPIN        20     /* in us, busy-polling before sleeping between polls */
+
+static int litepcie_reg_batch(struct litepcie_device *s, struct litepcie_ioctl_reg_batch *m)
+{
+	struct litepcie_reg_op *op;
+	uint32_t timeout_us;
+	ktime_t start, spin, deadline;
+	uint32_t val;
+
+	timeout_us = m->timeout_us ? min_t(uint32_t, m->timeout_us, REG_BATCH_TIMEOUT_MAX) : REG_BATCH_TIMEOUT;
+
+	for (m->done = 0; m->done < m->count; m->done++) {
+		op = &m->ops[m->done];
+		/* only the CSR window is accessible */
+		if ((op->addr & 3) || (uint32_t)(op->addr - CSR_BASE) >= CSR_SIZE)
+			return -EINVAL;
+		switch (op->op) {
+		case LITEPCIE_REG_OP_READ:
+			op->val = litepcie_readl(s, op->addr);
+			break;
+		case LITEPCIE_REG_OP_WRITE:
+			litepcie_writel(s, op->addr, op->val);
+			break;
+		case LITEPCIE_REG_OP_POLL:
+			/* process context without lock held: short conditions (SPI/I2C transfers, a few
+			 * us) are busy-polled, longer ones sleep between polls */
+			start    = ktime_get();
+			spin     = ktime_add_us(start, REG_BATCH_SPIN);
+			deadline = ktime_add_us(start, timeout_us);
+			for (;;) {
+				val = litepcie_readl(s, op->addr);
+				if ((val & op->mask) == (op->val & op->mask))
+					break;
+				if (ktime_after(ktime_get(), deadline)) {
+					op->val = val;
+					return -ETIMEDOUT;
+				}
+				if (ktime_after(ktime_get(), spin))
+					usleep_range(10, 20);
+				else
+					cpu_relax();
+			}
+			op->val = val;
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 static long litepcie_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
@@ -720,6 +1718,55 @@ static long litepcie_ioctl(struct file *file, unsigned int cmd,
 		}
 	}
 	break;
+	case LITEPCIE_IOCTL_REG_BATCH:
+	{
+		struct litepcie_ioctl_reg_batch m;
+		size_t hdr_size = offsetof(struct litepcie_ioctl_reg_batch, ops);
+
+		/* only copy the used ops */
+		if (copy_from_user(&m, (void *)arg, hdr_size)) {
+			ret = -EFAULT;
+			break;
+		}
+		if (m.count > LITEPCIE_REG_BATCH_MAX) {
+			ret = -EINVAL;
+			break;
+		}
+		if (copy_from_user(m.ops, (void *)arg + hdr_size, m.count * sizeof(m.ops[0]))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = litepcie_reg_batch(dev, &m);
+
+		if (copy_to_user((void *)arg, &m, hdr_size + m.count * sizeof(m.ops[0]))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+	break;
+#ifdef CSR_SI5351_I2C_W_ADDR
+	case LITEPCIE_IOCTL_I2C:
+	{
+		struct litepcie_ioctl_i2c m;
+
+		if (copy_from_user(&m, (void *)arg, sizeof(m))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		/* one transaction at a time on the bus */
+		mutex_lock(&dev->i2c_lock);
+		ret = litepcie_i2c_xfer(dev, &m);
+		mutex_unlock(&dev->i2c_lock);
+
+		if (copy_to_user((void *)arg, &m, sizeof(m))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+	break;
+#endif
 #ifdef CSR_FLASH_BASE
 	case LITEPCIE_IOCTL_FLASH:
 	{
@@ -739,6 +1786,44 @@ static long litepcie_ioctl(struct file *file, unsigned int cmd,
 	}
 	break;
 #endif
+#if defined(CSR_FLASH_BASE) && defined(CSR_FLASH_CS_N_OUT_ADDR)
+	case LITEPCIE_IOCTL_FLASH_PAGE:
+	{
+		struct litepcie_ioctl_flash_page m;
+
+		if (copy_from_user(&m, (void *)arg, sizeof(m))) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = litepcie_flash_page(dev, &m);
+		if (ret == 0 && !m.is_write) {
+			if (copy_to_user((void *)arg, &m, sizeof(m))) {
+				ret = -EFAULT;
+				break;
+			}
+		}
+	}
+	break;
+#endif
+#ifdef CSR_TIME_GEN_BASE
+	case LITEPCIE_IOCTL_TIME:
+	{
+		struct litepcie_ioctl_time m;
+
+		if (copy_from_user(&m, (void *)arg, sizeof(m))) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = litepcie_time_ioctl(dev, &m);
+		if (ret == 0) {
+			if (copy_to_user((void *)arg, &m, sizeof(m))) {
+				ret = -EFAULT;
+				break;
+			}
+		}
+	}
+	break;
+#endif
 #ifdef CSR_ICAP_BASE
 	case LITEPCIE_IOCTL_ICAP:
 	{
@@ -851,6 +1936,20 @@ static long litepcie_ioctl(struct file *file, unsigned int cmd,
 		}
 	}
 	break;
+	case LITEPCIE_IOCTL_MMAP_CSR_INFO:
+	{
+		struct litepcie_ioctl_mmap_csr_info m;
+
+		m.csr_offset = LITEPCIE_CSR_MMAP_OFFSET;
+		m.csr_size = csr_mmap ? LITEPCIE_CSR_MMAP_SIZE : 0;
+		m.csr_base = CSR_BASE;
+
+		if (copy_to_user((void *)arg, &m, sizeof(m))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+	break;
 	case LITEPCIE_IOCTL_MMAP_DMA_WRITER_UPDATE:
 	{
 		struct litepcie_ioctl_mmap_dma_update m;
@@ -861,6 +1960,9 @@ static long litepcie_ioctl(struct file *file, unsigned int cmd,
 		}
 
 		chan->dma.writer_sw_count = m.sw_count;
+		chan->dma.writer_splice_offset = 0;
+		trace_litepcie_dma_writer_sw_count(chan->minor,
+			chan->dma.writer_hw_count, chan->dma.writer_sw_count);
 	}
 	break;
 	case LITEPCIE_IOCTL_MMAP_DMA_READER_UPDATE:
@@ -873,6 +1975,117 @@ static long litepcie_ioctl(struct file *file, unsigned int cmd,
 		}
 
 		chan->dma.reader_sw_count = m.sw_count;
+		trace_litepcie_dma_reader_sw_count(chan->minor,
+			chan->dma.reader_hw_count, chan->dma.reader_sw_count);
+	}
+	break;
+	case LITEPCIE_IOCTL_DMA_TIMESTAMPS:
+	{
+		struct litepcie_ioctl_dma_timestamps *m;
+		struct litepcie_dma_timestamp *ts;
+		unsigned long flags;
+		uint64_t seq, first;
+		uint32_t i;
+
+		m = kzalloc(sizeof(*m), GFP_KERNEL);
+		if (!m) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		if (copy_from_user(m, (void *)arg, sizeof(*m))) {
+			kfree(m);
+			ret = -EFAULT;
+			break;
+		}
+
+		/* copy the latest records, oldest first */
+		spin_lock_irqsave(&chan->ts_lock, flags);
+		ts  = m->writer ? chan->writer_ts : chan->reader_ts;
+		seq = m->writer ? chan->writer_ts_seq : chan->reader_ts_seq;
+		m->count = min_t(uint64_t, seq, LITEPCIE_DMA_TIMESTAMP_COUNT);
+		m->seq   = seq;
+		first    = seq - m->count;
+		for (i = 0; i < m->count; i++)
+			m->ts[i] = ts[(first + i) % LITEPCIE_DMA_TIMESTAMP_COUNT];
+		spin_unlock_irqrestore(&chan->ts_lock, flags);
+
+		if (copy_to_user((void *)arg, m, sizeof(*m)))
+			ret = -EFAULT;
+		kfree(m);
+	}
+	break;
+	case LITEPCIE_IOCTL_DMA_TIMESTAMPS_ENABLE:
+	{
+		struct litepcie_ioctl_dma_timestamps_enable m;
+
+		if (copy_from_user(&m, (void *)arg, sizeof(m))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		/* reference counted per file, released on close */
+		if (m.enable && !chan_priv->fpga_ts)
+			atomic_inc(&dev->fpga_ts_users);
+		if (!m.enable && chan_priv->fpga_ts)
+			atomic_dec(&dev->fpga_ts_users);
+		chan_priv->fpga_ts = m.enable ? true : false;
+	}
+	break;
+	case LITEPCIE_IOCTL_INFO:
+	{
+		struct litepcie_ioctl_info m;
+
+		memset(&m, 0, sizeof(m));
+		memcpy(m.identifier, dev->identifier, sizeof(m.identifier));
+		m.dna = dev->dna;
+
+		if (copy_to_user((void *)arg, &m, sizeof(m))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+	break;
+	case LITEPCIE_IOCTL_EVENTFD:
+	{
+		struct litepcie_ioctl_eventfd m;
+		struct eventfd_ctx *rx_ctx = NULL;
+		struct eventfd_ctx *tx_ctx = NULL;
+
+		if (copy_from_user(&m, (void *)arg, sizeof(m))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		/* a watermark of 0 means default (1 buffer) */
+		if (m.rx_watermark == 0)
+			m.rx_watermark = 1;
+		if (m.tx_watermark == 0)
+			m.tx_watermark = 1;
+		if (m.rx_watermark > DMA_BUFFER_COUNT/2 || m.tx_watermark > DMA_BUFFER_COUNT/2) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (m.rx_fd >= 0) {
+			rx_ctx = eventfd_ctx_fdget(m.rx_fd);
+			if (IS_ERR(rx_ctx)) {
+				ret = PTR_ERR(rx_ctx);
+				break;
+			}
+		}
+		if (m.tx_fd >= 0) {
+			tx_ctx = eventfd_ctx_fdget(m.tx_fd);
+			if (IS_ERR(tx_ctx)) {
+				if (rx_ctx)
+					eventfd_ctx_put(rx_ctx);
+				ret = PTR_ERR(tx_ctx);
+				break;
+			}
+		}
+
+		litepcie_set_eventfd(chan, (rx_ctx || tx_ctx) ? chan_priv : NULL,
+				     rx_ctx, tx_ctx, m.rx_watermark, m.tx_watermark);
 	}
 	break;
 	case LITEPCIE_IOCTL_LOCK:
@@ -936,8 +2149,127 @@ static const struct file_operations litepcie_fops = {
 	.poll = litepcie_poll,
 	.write = litepcie_write,
 	.mmap = litepcie_mmap,
+	.splice_read = litepcie_splice_read,
+};
+
+/* debugfs */
+
+static void litepcie_debugfs_show_hist(struct seq_file *m, const char *name, const uint64_t *hist)
+{
+	int i;
+
+	seq_printf(m, "%s (us):\n", name);
+	for (i = 0; i < LITEPCIE_HIST_BINS; i++) {
+		if (i == LITEPCIE_HIST_BINS - 1)
+			seq_printf(m, "  [%6u - inf[ : %llu\n", (i == 0) ? 0 : (1u << i), hist[i]);
+		else
+			seq_printf(m, "  [%6u - %6u[ : %llu\n", (i == 0) ? 0 : (1u << i), 2u << i, hist[i]);
+	}
+}
+
+static int litepcie_debugfs_stats_show(struct seq_file *m, void *v)
+{
+	struct litepcie_chan *chan = m->private;
+	struct litepcie_chan_stats *st;
+	unsigned long flags;
+
+	/* print a consistent snapshot, not a set of counters updated by the IRQ handler meanwhile */
+	st = kmalloc(sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return -ENOMEM;
+	spin_lock_irqsave(&chan->stats_lock, flags);
+	*st = chan->stats;
+	spin_unlock_irqrestore(&chan->stats_lock, flags);
+
+	seq_printf(m, "writer_irqs:        %llu\n", st->writer_irqs);
+	seq_printf(m, "writer_buffers:     %llu\n", st->writer_buffers);
+	seq_printf(m, "writer_hw_count:    %lld\n", chan->dma.writer_hw_count);
+	seq_printf(m, "writer_sw_count:    %lld\n", chan->dma.writer_sw_count);
+	seq_printf(m, "writer_max_backlog: %lld\n", st->writer_max_backlog);
+	seq_printf(m, "overflows:          %llu\n", st->overflows);
+	seq_printf(m, "reader_irqs:        %llu\n", st->reader_irqs);
+	seq_printf(m, "reader_buffers:     %llu\n", st->reader_buffers);
+	seq_printf(m, "reader_hw_count:    %lld\n", chan->dma.reader_hw_count);
+	seq_printf(m, "reader_sw_count:    %lld\n", chan->dma.reader_sw_count);
+	seq_printf(m, "reader_max_backlog: %lld\n", st->reader_max_backlog);
+	seq_printf(m, "underflows:         %llu\n", st->underflows);
+	litepcie_debugfs_show_hist(m, "writer_wakeup_latency",  st->writer_wakeup_hist);
+	litepcie_debugfs_show_hist(m, "reader_wakeup_latency",  st->reader_wakeup_hist);
+	litepcie_debugfs_show_hist(m, "writer_irq_interval",    st->writer_irq_interval_hist);
+	litepcie_debugfs_show_hist(m, "reader_irq_interval",    st->reader_irq_interval_hist);
+	kfree(st);
+
+	return 0;
+}
+
+static int litepcie_debugfs_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, litepcie_debugfs_stats_show, inode->i_private);
+}
+
+/* Any write to the stats file clears the statistics */
+static ssize_t litepcie_debugfs_stats_write(struct file *file, const char __user *data,
+					    size_t size, loff_t *offset)
+{
+	struct seq_file *m = file->private_data;
+	struct litepcie_chan *chan = m->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->stats_lock, flags);
+	memset(&chan->stats, 0, sizeof(chan->stats));
+	spin_unlock_irqrestore(&chan->stats_lock, flags);
+
+	return size;
+}
+
+static const struct file_operations litepcie_debugfs_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = litepcie_debugfs_stats_open,
+	.read = seq_read,
+	.write = litepcie_debugfs_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
 };
 
+static void litepcie_debugfs_init(struct litepcie_device *s)
+{
+	char name[16];
+	int i;
+
+	s->debugfs_dir = debugfs_create_dir(pci_name(s->dev), litepcie_debugfs_root);
+	for (i = 0; i < s->channels; i++) {
+		snprintf(name, sizeof(name), "m2sdr%d", s->chan[i].minor);
+		s->chan[i].debugfs_dir = debugfs_create_dir(name, s->debugfs_dir);
+		debugfs_create_file("stats", 0644, s->chan[i].debugfs_dir, &s->chan[i],
+				    &litepcie_debugfs_stats_fops);
+	}
+}
+
+/* sysfs attributes (/sys/class/m2sdr/m2sdrN/): identifier/DNA read at probe, for enumeration
+ * without CSR accesses. */
+static ssize_t identifier_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct litepcie_device *s = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%s\n", s->identifier);
+}
+static DEVICE_ATTR_RO(identifier);
+
+static ssize_t dna_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct litepcie_device *s = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%llx\n", (unsigned long long)s->dna);
+}
+static DEVICE_ATTR_RO(dna);
+
+static struct attribute *litepcie_attrs[] = {
+	&dev_attr_identifier.attr,
+	&dev_attr_dna.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(litepcie);
+
 static int litepcie_alloc_chdev(struct litepcie_device *s)
 {
 	int i, j;
@@ -959,7 +2291,8 @@ static int litepcie_alloc_chdev(struct litepcie_device *s)
 	index = litepcie_minor_idx;
 	for (i = 0; i < s->channels; i++) {
 		dev_info(&s->dev->dev, "Creating /dev/m2sdr%d\n", index);
-		if (!device_create(litepcie_class, NULL, MKDEV(litepcie_major, index), NULL, "m2sdr%d", index)) {
+		if (!device_create_with_groups(litepcie_class, NULL, MKDEV(litepcie_major, index), s,
+					       litepcie_groups, "m2sdr%d", index)) {
 			ret = -EINVAL;
 			dev_err(&s->dev->dev, "Failed to create device\n");
 			goto fail_create;
@@ -1000,7 +2333,6 @@ static int litepcie_pci_probe(struct pci_dev *dev, const struct pci_device_id *i
 	int irqs = 0;
 	uint8_t rev_id;
 	int i;
-	char fpga_identifier[256];
 	struct litepcie_device *litepcie_dev = NULL;
 
 	dev_info(&dev->dev, "\e[1m[Probing device]\e[0m\n");
@@ -1015,6 +2347,10 @@ static int litepcie_pci_probe(struct pci_dev *dev, const struct pci_device_id *i
 	pci_set_drvdata(dev, litepcie_dev);
 	litepcie_dev->dev = dev;
 	spin_lock_init(&litepcie_dev->lock);
+	atomic_set(&litepcie_dev->fpga_ts_users, 0);
+#ifdef CSR_SI5351_I2C_W_ADDR
+	mutex_init(&litepcie_dev->i2c_lock);
+#endif
 
 	/* Enable the PCI device */
 	ret = pcim_enable_device(dev);
@@ -1049,6 +2385,8 @@ static int litepcie_pci_probe(struct pci_dev *dev, const struct pci_device_id *i
 		dev_err(&dev->dev, "Could not map BAR0\n");
 		goto fail1;
 	}
+	litepcie_dev->bar0_phys_addr = pci_resource_start(dev, 0);
+	litepcie_dev->bar0_size = pci_resource_len(dev, 0);
 
 	/* Reset LitePCIe core */
 #ifdef CSR_CTRL_RESET_ADDR
@@ -1056,10 +2394,17 @@ static int litepcie_pci_probe(struct pci_dev *dev, const struct pci_device_id *i
 	msleep(10);
 #endif
 
-	/* Read and display the FPGA identifier */
-	for (i = 0; i < 256; i++)
-		fpga_identifier[i] = litepcie_readl(litepcie_dev, CSR_IDENTIFIER_MEM_BASE + i * 4);
-	dev_info(&dev->dev, "Version %s\n", fpga_identifier);
+	/* Read and display the FPGA identifier (kept for LITEPCIE_IOCTL_INFO/sysfs) */
+	for (i = 0; i < LITEPCIE_IDENTIFIER_SIZE; i++)
+		litepcie_dev->identifier[i] = litepcie_readl(litepcie_dev, CSR_IDENTIFIER_MEM_BASE + i * 4);
+	litepcie_dev->identifier[LITEPCIE_IDENTIFIER_SIZE - 1] = '\0';
+	dev_info(&dev->dev, "Version %s\n", litepcie_dev->identifier);
+
+	/* Read the FPGA DNA */
+#ifdef CSR_DNA_ID_ADDR
+	litepcie_dev->dna  = (uint64_t)litepcie_readl(litepcie_dev, CSR_DNA_ID_ADDR + 0) << 32;
+	litepcie_dev->dna |= (uint64_t)litepcie_readl(litepcie_dev, CSR_DNA_ID_ADDR + 4) <<  0;
+#endif
 
 	pci_set_master(dev);
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 18, 0)
@@ -1128,6 +2473,11 @@ static int litepcie_pci_probe(struct pci_dev *dev, const struct pci_device_id *i
 		litepcie_dev->chan[i].dma.reader_lock = 0;
 		init_waitqueue_head(&litepcie_dev->chan[i].wait_rd);
 		init_waitqueue_head(&litepcie_dev->chan[i].wait_wr);
+		spin_lock_init(&litepcie_dev->chan[i].eventfd_lock);
+		spin_lock_init(&litepcie_dev->chan[i].ts_lock);
+		spin_lock_init(&litepcie_dev->chan[i].stats_lock);
+		litepcie_dev->chan[i].rx_watermark = 1;
+		litepcie_dev->chan[i].tx_watermark = 1;
 		switch (i) {
 #ifdef CSR_PCIE_DMA7_BASE
 		case 7: {
@@ -1202,6 +2552,14 @@ static int litepcie_pci_probe(struct pci_dev *dev, const struct pci_device_id *i
 		goto fail3;
 	}
 
+	/* create debugfs statistics */
+	litepcie_debugfs_init(litepcie_dev);
+
+#ifdef LITEPCIE_WITH_PTP
+	/* register TimeGenerator as PTP Hardware Clock */
+	litepcie_ptp_register(litepcie_dev);
+#endif
+
 	return 0;
 
 fail3:
@@ -1222,6 +2580,14 @@ static void litepcie_pci_remove(struct pci_dev *dev)
 
 	dev_info(&dev->dev, "\e[1m[Removing device]\e[0m\n");
 
+	/* Remove debugfs statistics */
+	debugfs_remove_recursive(litepcie_dev->debugfs_dir);
+
+#ifdef LITEPCIE_WITH_PTP
+	/* Unregister PTP Hardware Clock */
+	litepcie_ptp_unregister(litepcie_dev);
+#endif
+
 	/* Stop the DMAs */
 	litepcie_stop_dma(litepcie_dev);
 
@@ -1318,6 +2684,8 @@ static int __init litepcie_module_init(void)
 	litepcie_major = MAJOR(litepcie_dev_t);
 	litepcie_minor_idx = MINOR(litepcie_dev_t);
 
+	litepcie_debugfs_root = debugfs_create_dir(LITEPCIE_NAME, NULL);
+
 	ret = pci_register_driver(&litepcie_pci_driver);
 	if (ret < 0) {
 		pr_err(" Error while registering PCI driver\n");
@@ -1327,6 +2695,7 @@ static int __init litepcie_module_init(void)
 	return 0;
 
 fail_register:
+	debugfs_remove_recursive(litepcie_debugfs_root);
 	unregister_chrdev_region(litepcie_dev_t, LITEPCIE_MINOR_COUNT);
 fail_alloc_chrdev_region:
 	class_destroy(litepcie_class);
@@ -1338,6 +2707,7 @@ fail_create_class:
 static void __exit litepcie_module_exit(void)
 {
 	pci_unregister_driver(&litepcie_pci_driver);
+	debugfs_remove_recursive(litepcie_debugfs_root);
 	unregister_chrdev_region(litepcie_dev_t, LITEPCIE_MINOR_COUNT);
 	class_destroy(litepcie_class);
 }
@@ -8,7 +8,11 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <chrono>
 #include <memory>
+#include <map>
+#include <sstream>
+#include <thread>
 #include <sys/mman.h>
 #include <arpa/inet.h>
 
@@ -36,34 +40,74 @@
 
 /* AD9361 SPI */
 
-#if USE_LITEPCIE
-static int spi_fd;
-#elif USE_LITEETH
-static struct eb_connection *eb_fd;
-#endif
+/* The AD9361 driver only provides its spi_device (with the id_no of the init parameters) to
+ * spi_write_then_read: each SoapyLiteXM2SDR instance registers its device descriptor under its
+ * own id_no, allowing multiple boards to be opened/configured concurrently in the same process. */
+
+struct spi_registry_entry {
+    litex_m2sdr_device_desc_t fd;
+    std::mutex *csr_mutex; /* CSR lock of the device, taken for each SPI transfer. */
+};
+
+static std::mutex spi_registry_mutex;
+static std::map<uint8_t, spi_registry_entry> spi_registry;
+
+static uint8_t spi_register(litex_m2sdr_device_desc_t fd, std::mutex *csr_mutex)
+{
+    std::lock_guard<std::mutex> lock(spi_registry_mutex);
+    for (unsigned id = 0; id <= UINT8_MAX; id++) {
+        if (spi_registry.count(id) == 0) {
+            spi_registry[id] = {fd, csr_mutex};
+            return id;
+        }
+    }
+    throw std::runtime_error("SoapyLiteXM2SDR: too many AD9361 SPI devices.");
+}
+
+static void spi_unregister(uint8_t id)
+{
+    std::lock_guard<std::mutex> lock(spi_registry_mutex);
+    spi_registry.erase(id);
+}
+
+static spi_registry_entry spi_lookup(const struct spi_device *spi)
+{
+    std::lock_guard<std::mutex> lock(spi_registry_mutex);
+    auto it = spi_registry.find(spi->id_no);
+    if (it == spi_registry.end()) {
+        fprintf(stderr, "Unknown AD9361 SPI device %d\n", spi->id_no);
+        exit(1);
+    }
+    return it->second;
+}
 
 //#define AD9361_SPI_WRITE_DEBUG
 //#define AD9361_SPI_READ_DEBUG
 
-int spi_write_then_read(struct spi_device * /*spi*/,
+int spi_write_then_read(struct spi_device *spi,
                         const unsigned char *txbuf, unsigned n_tx,
                         unsigned char *rxbuf, unsigned n_rx)
 {
+    spi_registry_entry entry = spi_lookup(spi);
+    litex_m2sdr_device_desc_t fd = entry.fd;
 
-    /* Single Byte Read. */
-    if (n_tx == 2 && n_rx == 1) {
+    /* Only hold the CSR lock for the transfer: the RFIC lock serializes the AD9361 operations. */
+    std::lock_guard<std::mutex> lock(*entry.csr_mutex);
+
+    /* Read (multi-byte reads in bursts). */
+    if (n_tx == 2 && n_rx >= 1 && n_rx <= AD9361_SPI_MAX_BURST) {
 #if USE_LITEPCIE
-        rxbuf[0] = m2sdr_ad9361_spi_read(spi_fd, txbuf[0] << 8 | txbuf[1]);
+        m2sdr_ad9361_spi_readm(fd, (txbuf[0] << 8 | txbuf[1]) & 0x3ff, rxbuf, n_rx);
 #elif USE_LITEETH
-        rxbuf[0] = m2sdr_ad9361_eb_spi_read(eb_fd, txbuf[0] << 8 | txbuf[1]);
+        m2sdr_ad9361_eb_spi_readm(fd, (txbuf[0] << 8 | txbuf[1]) & 0x3ff, rxbuf, n_rx);
 #endif
 
-    /* Single Byte Write. */
-    } else if (n_tx == 3 && n_rx == 0) {
+    /* Write (multi-byte writes in bursts). */
+    } else if (n_tx >= 3 && n_tx <= 2 + AD9361_SPI_MAX_BURST && n_rx == 0) {
 #if USE_LITEPCIE
-        m2sdr_ad9361_spi_write(spi_fd, txbuf[0] << 8 | txbuf[1], txbuf[2]);
+        m2sdr_ad9361_spi_writem(fd, (txbuf[0] << 8 | txbuf[1]) & 0x3ff, &txbuf[2], n_tx - 2);
 #else
-        m2sdr_ad9361_eb_spi_write(eb_fd, txbuf[0] << 8 | txbuf[1], txbuf[2]);
+        m2sdr_ad9361_eb_spi_writem(fd, (txbuf[0] << 8 | txbuf[1]) & 0x3ff, &txbuf[2], n_tx - 2);
 #endif
 
     /* Unsupported. */
@@ -110,6 +154,20 @@ bool gpio_is_valid(int number)
 
 void gpio_set_value(unsigned /*gpio*/, int /*value*/){}
 
+/* AD9361 RFIC Lock (SPI register cache only used while held). */
+
+SoapyLiteXM2SDR::RFICLock::RFICLock(const SoapyLiteXM2SDR *dev):
+    _lock(dev->_rfic_mutex),
+    _spi(dev->ad9361_phy ? dev->ad9361_phy->spi : nullptr) {
+    if (_spi)
+        ad9361_spi_cache_begin(_spi);
+}
+
+SoapyLiteXM2SDR::RFICLock::~RFICLock(void) {
+    if (_spi)
+        ad9361_spi_cache_end(_spi);
+}
+
 /***************************************************************************************************
  *                                     Constructor
  **************************************************************************************************/
@@ -153,6 +211,17 @@ static std::string getLocalIPAddressToReach(const std::string &remote_ip, uint16
 std::string getLiteXM2SDRSerial(litex_m2sdr_device_desc_t fd);
 std::string getLiteXM2SDRIdentification(litex_m2sdr_device_desc_t fd);
 
+/* Warm start snapshot key: AD9361 initialization profile (parameters, including the reference
+ * clock, and FIRs). */
+static uint64_t ad9361_snapshot_key(void)
+{
+    uint64_t key = M2SDR_CACHE_HASH_INIT;
+    key = m2sdr_cache_hash(key, &default_init_param, sizeof(default_init_param));
+    key = m2sdr_cache_hash(key, &rx_fir_config, sizeof(rx_fir_config));
+    key = m2sdr_cache_hash(key, &tx_fir_config, sizeof(tx_fir_config));
+    return key;
+}
+
 #if USE_LITEPCIE
 void dma_set_loopback(int fd, bool loopback_enable) {
     struct litepcie_ioctl_dma m;
@@ -162,9 +231,8 @@ void dma_set_loopback(int fd, bool loopback_enable) {
 #endif
 
 SoapyLiteXM2SDR::SoapyLiteXM2SDR(const SoapySDR::Kwargs &args)
-    : _rx_buf_size(0), _tx_buf_size(0), _rx_buf_count(0), _tx_buf_count(0),
-    _rx_udp_receiver(NULL),
-    _fd(FD_INIT), ad9361_phy(NULL) {
+    : _rx_udp_receiver(NULL), _dma_path_index(0), _remote(false),
+    _fd(FD_INIT), ad9361_phy(NULL), _spi_id(0) {
     SoapySDR::logf(SOAPY_SDR_INFO, "SoapyLiteXM2SDR initializing...");
     setvbuf(stdout, NULL, _IOLBF, 0);
 
@@ -185,8 +253,22 @@ SoapyLiteXM2SDR::SoapyLiteXM2SDR(const SoapySDR::Kwargs &args)
     _fd = open(path.c_str(), O_RDWR);
     if (_fd < 0)
         throw std::runtime_error("SoapyLiteXM2SDR(): failed to open " + path);
-    /* Global file descriptor for AD9361 lib. */
-    spi_fd = _fd;
+
+    /* Devnode prefix/index, used to open the additional DMA channels (one minor per channel). */
+    size_t index_pos = path.find_last_not_of("0123456789") + 1;
+    _dma_path_prefix = path.substr(0, index_pos);
+    if (index_pos < path.size())
+        _dma_path_index = std::stoul(path.substr(index_pos));
+
+    /* Remote mode: receive through m2sdr_server instead of locking the RX DMA. */
+    if (args.count("remote") > 0)
+        _remote = args.at("remote")[0] != '0';
+
+    /* Direct MMIO CSR accesses (falls back to ioctls when the driver does not allow the CSR mmap). */
+    if (args.count("csr_mmap") == 0 || args.at("csr_mmap")[0] != '0') {
+        if (litepcie_csr_mmap(_fd) == 0)
+            SoapySDR::logf(SOAPY_SDR_INFO, "Using mmap CSR accesses");
+    }
 
     SoapySDR::logf(SOAPY_SDR_INFO, "Opened devnode %s, serial %s", path.c_str(), getLiteXM2SDRSerial(_fd).c_str());
 #elif USE_LITEETH
@@ -201,7 +283,6 @@ SoapyLiteXM2SDR::SoapyLiteXM2SDR(const SoapySDR::Kwargs &args)
     _fd = eb_connect(eth_ip.c_str(), "1234", 1);
     if (!_fd)
         throw std::runtime_error("Can't connect to EtherBone!");
-    eb_fd = _fd;
 
     /* Ethernet streamer */
     try {
@@ -291,29 +372,103 @@ SoapyLiteXM2SDR::SoapyLiteXM2SDR(const SoapySDR::Kwargs &args)
         _oversampling = std::stoi(args.at("oversampling"));
     }
 
+    /* Warm start: restore the AD9361 from the snapshot saved by a previous full initialization
+     * of the board (same profile) instead of re-running the initialization and calibrations. */
+    bool warm_start = false;
+    if (args.count("warm_start") > 0)
+        warm_start = args.at("warm_start")[0] != '0';
+
+    std::unique_ptr<struct ad9361_snapshot> snapshot;
+    uint64_t snapshot_key = ad9361_snapshot_key();
+    char snapshot_path[1024];
+    bool warm = false;
+    if (do_init && warm_start) {
+        snapshot.reset(new struct ad9361_snapshot);
+        if (m2sdr_cache_path(snapshot_path, sizeof(snapshot_path), getLiteXM2SDRSerial(_fd).c_str(),
+                "ad9361", snapshot_key) < 0) {
+            SoapySDR::log(SOAPY_SDR_WARNING, "No cache directory, AD9361 warm start disabled");
+            warm_start = false;
+        } else {
+            warm = (m2sdr_cache_load(snapshot_path, snapshot.get(), sizeof(*snapshot)) == 0) &&
+                   (snapshot->key == snapshot_key);
+        }
+    }
+    auto init_start = std::chrono::steady_clock::now();
+
     if (do_init) {
 #if USE_LITEPCIE
         /* Initialize SI531 Clocking. */
         m2sdr_si5351_i2c_config(_fd, SI5351_I2C_ADDR, si5351_xo_config, sizeof(si5351_xo_config)/sizeof(si5351_xo_config[0]));
 
-        /* Initialize AD9361 SPI. */
-        m2sdr_ad9361_spi_init(_fd, 1);
+        /* Initialize AD9361 SPI (AD9361 reset, except for a warm start). */
+        m2sdr_ad9361_spi_init(_fd, !warm);
 #else
-        m2sdr_ad9361_eb_spi_init(_fd, 1);
+        m2sdr_ad9361_eb_spi_init(_fd, !warm);
 #endif
     }
 
-    /* Initialize AD9361 RFIC. */
-    default_init_param.gpio_resetb  = AD9361_GPIO_RESET_PIN;
-    default_init_param.gpio_sync    = -1;
-    default_init_param.gpio_cal_sw1 = -1;
-    default_init_param.gpio_cal_sw2 = -1;
-    ad9361_init(&ad9361_phy, &default_init_param, do_init);
+    /* Initialize AD9361 RFIC (with its own SPI context). */
+    _spi_id = spi_register(_fd, &_csr_mutex);
+    AD9361_InitParam init_param = default_init_param;
+    init_param.id_no        = _spi_id;
+    init_param.gpio_resetb  = AD9361_GPIO_RESET_PIN;
+    init_param.gpio_sync    = -1;
+    init_param.gpio_cal_sw1 = -1;
+    init_param.gpio_cal_sw2 = -1;
+    ad9361_init(&ad9361_phy, &init_param, do_init && !warm);
+
+    if (warm) {
+        int32_t reloaded = ad9361_restore_snapshot(ad9361_phy, snapshot.get());
+        if (reloaded < 0) {
+            /* Device reset/reconfigured since the snapshot: full initialization. */
+            SoapySDR::logf(SOAPY_SDR_INFO, "AD9361 warm start not possible (%d), full initialization", reloaded);
+            warm = false;
+#if USE_LITEPCIE
+            m2sdr_ad9361_spi_init(_fd, 1);
+#else
+            m2sdr_ad9361_eb_spi_init(_fd, 1);
+#endif
+            ad9361_remove(ad9361_phy);
+            ad9361_phy = nullptr;
+            ad9361_init(&ad9361_phy, &init_param, 1);
+        } else {
+            SoapySDR::logf(SOAPY_SDR_INFO, "AD9361 warm start from %s (%d registers reloaded)",
+                snapshot_path, reloaded);
+        }
+    }
+
+    /* Calibration cache: TX quadrature calibration results per TX LO band, RF bandwidths and
+     * temperature bin, restored on retunes to a known band (and persisted across openings). */
+    if (args.count("cal_cache") > 0 && args.at("cal_cache")[0] != '0') {
+        char cal_cache_path[1024];
+        _calCache.reset(new struct ad9361_cal_cache);
+        if (m2sdr_cache_path(cal_cache_path, sizeof(cal_cache_path), getLiteXM2SDRSerial(_fd).c_str(),
+                "calib", snapshot_key) == 0) {
+            _calCachePath = cal_cache_path;
+            if (m2sdr_cache_load(cal_cache_path, _calCache.get(), sizeof(*_calCache)) < 0)
+                _calCache->magic = 0;
+        } else {
+            SoapySDR::log(SOAPY_SDR_WARNING, "No cache directory, calibration cache not persisted");
+            _calCache->magic = 0;
+        }
+        ad9361_set_cal_cache(ad9361_phy, _calCache.get());
+        _calCache->hits   = 0;
+        _calCache->misses = 0;
+    }
+
+    /* Rate cache: memoized clock chains and BB filter calibration results of the last sample
+     * rates, switching back to a previous rate only reprograms the deltas. */
+    if (args.count("rate_cache") > 0 && args.at("rate_cache")[0] != '0') {
+        _rateCache.reset(new struct ad9361_rate_cache);
+        ad9361_set_rate_cache(ad9361_phy, _rateCache.get());
+    }
 
     if (do_init) {
-        /* Configure AD9361 TX/RX FIRs. */
-        ad9361_set_tx_fir_config(ad9361_phy, tx_fir_config);
-        ad9361_set_rx_fir_config(ad9361_phy, rx_fir_config);
+        if (!warm) {
+            /* Configure AD9361 TX/RX FIRs. */
+            ad9361_set_tx_fir_config(ad9361_phy, tx_fir_config);
+            ad9361_set_rx_fir_config(ad9361_phy, rx_fir_config);
+        }
 
         /* Some defaults to avoid throwing. */
 
@@ -327,6 +482,14 @@ SoapyLiteXM2SDR::SoapyLiteXM2SDR(const SoapySDR::Kwargs &args)
         _rx_stream.bandwidth    = 30.72e6;
         _tx_stream.bandwidth    = 30.72e6;
 
+        /* Warm start: the AD9361 already runs the defaults (restored from the snapshot), only
+         * the IQ Balance (FPGA) is applied. */
+        if (warm) {
+            RFICLock lock(this);
+            channel_applied(SOAPY_SDR_RX, -1, RF_ALL & ~RF_IQBALANCE);
+            channel_applied(SOAPY_SDR_TX, -1, RF_ALL & ~RF_IQBALANCE);
+        }
+
         /* TX1/RX1. */
         _rx_stream.antenna[0]   = "A_BALANCED";
         _tx_stream.antenna[0]   = "A";
@@ -348,19 +511,73 @@ SoapyLiteXM2SDR::SoapyLiteXM2SDR(const SoapySDR::Kwargs &args)
         _tx_stream.iqbalance[1] = 1.0;
         channel_configure(SOAPY_SDR_RX, 1);
         channel_configure(SOAPY_SDR_TX, 1);
+
+        /* Save the post-initialization state for the next warm starts. */
+        if (warm_start && !warm) {
+            if (ad9361_save_snapshot(ad9361_phy, snapshot_key, snapshot.get()) == 0 &&
+                m2sdr_cache_save(snapshot_path, snapshot.get(), sizeof(*snapshot)) == 0)
+                SoapySDR::logf(SOAPY_SDR_INFO, "AD9361 snapshot saved to %s", snapshot_path);
+            else
+                SoapySDR::logf(SOAPY_SDR_WARNING, "Could not save AD9361 snapshot to %s", snapshot_path);
+        }
+
+        SoapySDR::logf(SOAPY_SDR_INFO, "AD9361 %s initialization in %.1f ms", warm ? "warm" : "full",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count());
     }
 
+    /* AD9361 SPI accesses (and those saved by the register cache). */
+    struct ad9361_spi_stats spi_stats;
+    ad9361_spi_get_stats(ad9361_phy->spi, &spi_stats);
+    SoapySDR::logf(SOAPY_SDR_DEBUG, "AD9361 SPI: %u reads (%u cached), %u writes (%u elided), %u transfers",
+        spi_stats.reads, spi_stats.reads_cached, spi_stats.writes, spi_stats.writes_elided,
+        spi_stats.transfers);
+
 #if USE_LITEPCIE
     /* Set-up the DMA. */
     checked_ioctl(_fd, LITEPCIE_IOCTL_MMAP_DMA_INFO, &_dma_mmap_info);
     _dma_buf = NULL;
 #endif
 
+    /* Frequency hopping profiles (comma separated frequencies). */
+    if (args.count("rx_hop_frequencies") > 0)
+        writeSetting(SOAPY_SDR_RX, 0, "HOP_FREQUENCIES", args.at("rx_hop_frequencies"));
+    if (args.count("tx_hop_frequencies") > 0)
+        writeSetting(SOAPY_SDR_TX, 0, "HOP_FREQUENCIES", args.at("tx_hop_frequencies"));
+
     SoapySDR::log(SOAPY_SDR_INFO, "SoapyLiteXM2SDR initialization complete");
 }
 
 SoapyLiteXM2SDR::~SoapyLiteXM2SDR(void) {
     SoapySDR::log(SOAPY_SDR_INFO, "Power down and cleanup");
+
+    /* Stop the control thread (pending asynchronous commands are dropped). */
+    {
+        std::lock_guard<std::mutex> lock(_controlMutex);
+        _controlStop = true;
+    }
+    _controlCond.notify_all();
+    if (_controlThread.joinable())
+        _controlThread.join();
+#if USE_LITEPCIE
+    /* Release the additional streams. */
+    for (auto &slot : _rx_dma_streams) {
+        RXStream *rx = slot.exchange(nullptr);
+        if (!rx)
+            continue;
+        litepcie_dma_cleanup(&rx->dma);
+        close(rx->fd);
+        delete rx;
+    }
+    for (auto &slot : _tx_dma_streams) {
+        TXStream *tx = slot.exchange(nullptr);
+        if (!tx)
+            continue;
+        litepcie_dma_cleanup(&tx->dma);
+        close(tx->fd);
+        delete tx;
+    }
+#endif
+
     if (_rx_stream.opened) {
 #if USE_LITEPCIE
         litepcie_release_dma(_fd, 0, 1);
@@ -387,7 +604,29 @@ SoapyLiteXM2SDR::~SoapyLiteXM2SDR(void) {
     /* Crossbar Demux: Select PCIe streaming */
     litex_m2sdr_writel(_fd, CSR_CROSSBAR_DEMUX_SEL_ADDR, 0);
 
+    if (_rateCache) {
+        SoapySDR::logf(SOAPY_SDR_INFO, "Rate cache: %u hits, %u misses",
+            _rateCache->hits, _rateCache->misses);
+        ad9361_set_rate_cache(ad9361_phy, NULL);
+    }
+
+    /* Save the calibration cache. */
+    if (_calCache) {
+        SoapySDR::logf(SOAPY_SDR_INFO, "Calibration cache: %u hits, %u misses",
+            _calCache->hits, _calCache->misses);
+        if (!_calCachePath.empty() &&
+            m2sdr_cache_save(_calCachePath.c_str(), _calCache.get(), sizeof(*_calCache)) < 0)
+            SoapySDR::logf(SOAPY_SDR_WARNING, "Could not save calibration cache to %s", _calCachePath.c_str());
+        ad9361_set_cal_cache(ad9361_phy, NULL);
+    }
+
+    /* Release AD9361 driver state and SPI context. */
+    ad9361_remove(ad9361_phy);
+    ad9361_phy = nullptr;
+    spi_unregister(_spi_id);
+
 #if USE_LITEPCIE
+    litepcie_csr_munmap(_fd);
     close(_fd);
 #elif USE_LITEETH
     if (_rx_udp_receiver) {
@@ -405,25 +644,75 @@ SoapyLiteXM2SDR::~SoapyLiteXM2SDR(void) {
  *                                 Channel configuration
  **************************************************************************************************/
 
+/* Apply the RF settings of a channel that changed since they were last applied (setters apply
+ * immediately when called directly, so activate/deactivate cycles only reprogram what changed). */
 void SoapyLiteXM2SDR::channel_configure(const int direction, const size_t channel) {
+    uint32_t dirty;
+    {
+        RFICLock lock(this);
+        if (direction == SOAPY_SDR_TX)
+            dirty = _tx_stream.rf_dirty[channel];
+        else
+            dirty = _rx_stream.rf_dirty[channel];
+    }
+    if (dirty == 0)
+        return;
+
     if (direction == SOAPY_SDR_TX) {
-        this->setSampleRate(SOAPY_SDR_TX, channel, _tx_stream.samplerate);
-        this->setAntenna(SOAPY_SDR_TX,    channel, _tx_stream.antenna[channel]);
-        this->setFrequency(SOAPY_SDR_TX,  channel, "BB", _tx_stream.frequency);
-        this->setBandwidth(SOAPY_SDR_TX,  channel, _tx_stream.bandwidth);
-        this->setGain(SOAPY_SDR_TX,       channel, _tx_stream.gain[channel]);
-        this->setIQBalance(SOAPY_SDR_TX,  channel, _tx_stream.iqbalance[channel]);
+        if (dirty & RF_SAMPLERATE)
+            this->setSampleRate(SOAPY_SDR_TX, channel, _tx_stream.samplerate);
+        if (dirty & RF_ANTENNA)
+            this->setAntenna(SOAPY_SDR_TX,    channel, _tx_stream.antenna[channel]);
+        if (dirty & RF_FREQUENCY)
+            this->setFrequency(SOAPY_SDR_TX,  channel, "BB", _tx_stream.frequency);
+        if (dirty & RF_BANDWIDTH)
+            this->setBandwidth(SOAPY_SDR_TX,  channel, _tx_stream.bandwidth);
+        if (dirty & RF_GAIN)
+            this->setGain(SOAPY_SDR_TX,       channel, _tx_stream.gain[channel]);
+        if (dirty & RF_IQBALANCE)
+            this->setIQBalance(SOAPY_SDR_TX,  channel, _tx_stream.iqbalance[channel]);
     }
     if (direction == SOAPY_SDR_RX) {
-        this->setSampleRate(SOAPY_SDR_RX, channel, _rx_stream.samplerate);
-        this->setAntenna(SOAPY_SDR_RX,    channel, _rx_stream.antenna[channel]);
-        this->setFrequency(SOAPY_SDR_RX,  channel, "BB", _rx_stream.frequency);
-        this->setBandwidth(SOAPY_SDR_RX,  channel, _rx_stream.bandwidth);
-        this->setGainMode(SOAPY_SDR_RX,   channel, _rx_stream.gainMode[channel]);
-        this->setGain(SOAPY_SDR_RX,       channel, _rx_stream.gain[channel]);
-        this->setIQBalance(SOAPY_SDR_RX,  channel, _rx_stream.iqbalance[channel]);
+        if (dirty & RF_SAMPLERATE)
+            this->setSampleRate(SOAPY_SDR_RX, channel, _rx_stream.samplerate);
+        if (dirty & RF_ANTENNA)
+            this->setAntenna(SOAPY_SDR_RX,    channel, _rx_stream.antenna[channel]);
+        if (dirty & RF_FREQUENCY)
+            this->setFrequency(SOAPY_SDR_RX,  channel, "BB", _rx_stream.frequency);
+        if (dirty & RF_BANDWIDTH)
+            this->setBandwidth(SOAPY_SDR_RX,  channel, _rx_stream.bandwidth);
+        if (dirty & RF_GAINMODE)
+            this->setGainMode(SOAPY_SDR_RX,   channel, _rx_stream.gainMode[channel]);
+        if (dirty & RF_GAIN)
+            this->setGain(SOAPY_SDR_RX,       channel, _rx_stream.gain[channel]);
+        if (dirty & RF_IQBALANCE)
+            this->setIQBalance(SOAPY_SDR_RX,  channel, _rx_stream.iqbalance[channel]);
     }
 
+    /* Settings without AD9361 setter (IQ Balance) are applied once called. */
+    RFICLock lock(this);
+    channel_applied(direction, channel, RF_IQBALANCE);
+}
+
+/* Mark RF settings as applied (channel -1: settings common to both channels). Called with the
+ * RFIC lock held. */
+void SoapyLiteXM2SDR::channel_applied(const int direction, const int channel, const uint32_t settings) {
+    for (int i = 0; i < 2; i++) {
+        if (channel >= 0 && channel != i)
+            continue;
+        if (direction == SOAPY_SDR_TX)
+            _tx_stream.rf_dirty[i] &= ~settings;
+        else
+            _rx_stream.rf_dirty[i] &= ~settings;
+    }
+}
+
+/* Mark all RF settings as not applied (AD9361 reset). Called with the RFIC lock held. */
+void SoapyLiteXM2SDR::channel_invalidate(void) {
+    for (int i = 0; i < 2; i++) {
+        _rx_stream.rf_dirty[i] = RF_ALL;
+        _tx_stream.rf_dirty[i] = RF_ALL;
+    }
 }
 
 /***************************************************************************************************
@@ -469,16 +758,18 @@ void SoapyLiteXM2SDR::setAntenna(
     const int direction,
     const size_t channel,
     const std::string &name) {
-    std::lock_guard<std::mutex> lock(_mutex);
+    RFICLock lock(this);
     if (direction == SOAPY_SDR_RX)
         _rx_stream.antenna[channel] = name;
     if (direction == SOAPY_SDR_TX)
         _tx_stream.antenna[channel] = name;
+    channel_applied(direction, channel, RF_ANTENNA);
 }
 
 std::string SoapyLiteXM2SDR::getAntenna(
     const int direction,
     const size_t channel) const {
+    RFICLock lock(this);
     if (direction == SOAPY_SDR_RX)
         return _rx_stream.antenna[channel];
     return _tx_stream.antenna[channel];
@@ -519,7 +810,7 @@ bool SoapyLiteXM2SDR::hasGainMode(
 void SoapyLiteXM2SDR::setGainMode(const int direction, const size_t channel,
     const bool automatic)
 {
-    std::lock_guard<std::mutex> lock(_mutex);
+    RFICLock lock(this);
     /* N/A. */
     if (direction == SOAPY_SDR_TX)
         return;
@@ -528,6 +819,7 @@ void SoapyLiteXM2SDR::setGainMode(const int direction, const size_t channel,
     _rx_stream.gainMode[channel] = automatic;
     ad9361_set_rx_gain_control_mode(ad9361_phy, channel,
         (automatic ? RF_GAIN_SLOWATTACK_AGC : RF_GAIN_MGC));
+    channel_applied(direction, channel, RF_GAINMODE);
 }
 
 bool SoapyLiteXM2SDR::getGainMode(const int direction, const size_t channel) const
@@ -535,6 +827,7 @@ bool SoapyLiteXM2SDR::getGainMode(const int direction, const size_t channel) con
     if (direction == SOAPY_SDR_TX)
         return false;
     if (direction == SOAPY_SDR_RX) {
+        RFICLock lock(this);
         uint8_t gc_mode;
         ad9361_get_rx_gain_control_mode(ad9361_phy, channel, &gc_mode);
         return (gc_mode != RF_GAIN_MGC);
@@ -546,7 +839,7 @@ void SoapyLiteXM2SDR::setGain(
     int direction,
     size_t channel,
     const double value) {
-    std::lock_guard<std::mutex> lock(_mutex);
+    RFICLock lock(this);
     SoapySDR::logf(SOAPY_SDR_DEBUG,
         "SoapyLiteXM2SDR::setGain(%s, ch%d, %f dB)",
         dir2Str(direction),
@@ -562,6 +855,7 @@ void SoapyLiteXM2SDR::setGain(
         _rx_stream.gain[channel] = value;
         ad9361_set_rx_rf_gain(ad9361_phy, channel, value);
     }
+    channel_applied(direction, channel, RF_GAIN);
 }
 
 void SoapyLiteXM2SDR::setGain(
@@ -582,6 +876,7 @@ double SoapyLiteXM2SDR::getGain(
     const int direction,
     const size_t channel) const
 {
+    RFICLock lock(this);
     int32_t gain = 0;
     if (direction == SOAPY_SDR_TX) {
         ad9361_get_tx_attenuation(ad9361_phy, channel, (uint32_t *) &gain);
@@ -640,7 +935,7 @@ void SoapyLiteXM2SDR::setFrequency(
     const std::string &name,
     const double frequency,
     const SoapySDR::Kwargs &/*args*/) {
-    std::unique_lock<std::mutex> lock(_mutex);
+    RFICLock lock(this);
 
     SoapySDR::logf(SOAPY_SDR_DEBUG,
         "SoapyLiteXM2SDR::setFrequency(%s, ch%d, %s, %f MHz)",
@@ -661,12 +956,15 @@ void SoapyLiteXM2SDR::setFrequency(
 
     if (direction == SOAPY_SDR_RX)
         ad9361_set_rx_lo_freq(ad9361_phy, lo_freq);
+
+    channel_applied(direction, -1, RF_FREQUENCY);
 }
 
 double SoapyLiteXM2SDR::getFrequency(
     const int direction,
     const size_t /*channel*/,
     const std::string &/*name*/) const {
+    RFICLock lock(this);
 
     uint64_t lo_freq = 0;
 
@@ -701,6 +999,101 @@ SoapySDR::RangeList SoapyLiteXM2SDR::getFrequencyRange(
     return(SoapySDR::RangeList(1, SoapySDR::Range(0, 0)));
 }
 
+/***************************************************************************************************
+ *                                   Frequency Hopping API
+ **************************************************************************************************/
+
+/* Fastlock hopping: the synthesizer setup of up to 8 frequencies per direction (VCO calibration
+ * results included) is stored in the AD9361 fastlock profiles; a hop recalls a profile with a few
+ * SPI writes and no VCO calibration. Profiles are common to both channels of a direction. */
+
+#define HOP_MAX_PROFILES 8
+
+void SoapyLiteXM2SDR::setHopFrequencies(
+    const int direction,
+    const std::vector<double> &frequencies) {
+    RFICLock lock(this);
+
+    if (frequencies.size() > HOP_MAX_PROFILES)
+        throw std::runtime_error("setHopFrequencies(): up to " + std::to_string(HOP_MAX_PROFILES) + " frequencies");
+
+    /* Tune to each frequency (with VCO calibration) and store the synthesizer setup. */
+    for (size_t i = 0; i < frequencies.size(); i++) {
+        uint64_t lo_freq = static_cast<uint64_t>(frequencies[i]);
+        int32_t ret;
+        if (direction == SOAPY_SDR_TX) {
+            ad9361_set_tx_lo_freq(ad9361_phy, lo_freq);
+            ret = ad9361_tx_fastlock_store(ad9361_phy, i);
+        } else {
+            ad9361_set_rx_lo_freq(ad9361_phy, lo_freq);
+            ret = ad9361_rx_fastlock_store(ad9361_phy, i);
+        }
+        if (ret < 0)
+            throw std::runtime_error("setHopFrequencies(): fastlock profile store failed");
+    }
+    _hopFrequencies[direction] = frequencies;
+    _hopProfile[direction]     = -1;
+
+    /* Back to the current frequency (out of fastlock mode). */
+    uint64_t lo_freq = static_cast<uint64_t>(
+        (direction == SOAPY_SDR_TX) ? _tx_stream.frequency : _rx_stream.frequency);
+    if (direction == SOAPY_SDR_TX)
+        ad9361_set_tx_lo_freq(ad9361_phy, lo_freq);
+    else
+        ad9361_set_rx_lo_freq(ad9361_phy, lo_freq);
+
+    SoapySDR::logf(SOAPY_SDR_INFO, "%s: %zu fastlock hop profiles stored",
+        dir2Str(direction), frequencies.size());
+}
+
+/* Check that a fastlock profile is stored (called with the RFIC lock held). */
+void SoapyLiteXM2SDR::hopCheck(
+    const int direction,
+    const size_t profile) {
+    if (profile >= _hopFrequencies[direction].size())
+        throw std::runtime_error("writeSetting(HOP): profile " + std::to_string(profile) +
+            " not stored (" + std::to_string(_hopFrequencies[direction].size()) +
+            " HOP_FREQUENCIES profiles)");
+}
+
+void SoapyLiteXM2SDR::hop(
+    const int direction,
+    const size_t profile) {
+    /* Reject a profile not stored before waiting for the command time. */
+    {
+        RFICLock lock(this);
+        hopCheck(direction, profile);
+    }
+
+    /* Timed hop: wait for the command time (without holding the RFIC lock). */
+    long long time_ns = _commandTime.load();
+    if (time_ns > 0)
+        waitHardwareTime(time_ns);
+
+    RFICLock lock(this);
+
+    /* Profiles can have been replaced meanwhile. */
+    hopCheck(direction, profile);
+
+    int32_t ret;
+    if (direction == SOAPY_SDR_TX)
+        ret = ad9361_tx_fastlock_recall(ad9361_phy, profile);
+    else
+        ret = ad9361_rx_fastlock_recall(ad9361_phy, profile);
+    if (ret < 0)
+        throw std::runtime_error("hop(): fastlock profile recall failed");
+
+    double frequency = _hopFrequencies[direction][profile];
+    _hopProfile[direction] = profile;
+    for (size_t channel = 0; channel < 2; channel++)
+        _cachedFreqValues[direction][channel]["RF"] = frequency;
+    if (direction == SOAPY_SDR_TX)
+        _tx_stream.frequency = frequency;
+    else
+        _rx_stream.frequency = frequency;
+    channel_applied(direction, -1, RF_FREQUENCY);
+}
+
 /***************************************************************************************************
  *                                        Sample Rate API
  **************************************************************************************************/
@@ -713,12 +1106,14 @@ void SoapyLiteXM2SDR::setSampleMode() {
         _bytesPerSample  = 1;
         _bytesPerComplex = 2;
         _samplesScaling  = 128.0; /* Normalize 8-bit ADC values to [-1.0, 1.0]. */
+        std::lock_guard<std::mutex> lock(_csr_mutex);
         litex_m2sdr_writel(_fd, CSR_AD9361_BITMODE_ADDR, 1);
     /* 16-bit mode */
     } else {
         _bytesPerSample  = 2;
         _bytesPerComplex = 4;
         _samplesScaling  = 2048.0; /* Normalize 12-bit ADC values to [-1.0, 1.0]. */
+        std::lock_guard<std::mutex> lock(_csr_mutex);
         litex_m2sdr_writel(_fd, CSR_AD9361_BITMODE_ADDR, 0);
     }
 }
@@ -727,7 +1122,7 @@ void SoapyLiteXM2SDR::setSampleRate(
     const int direction,
     const size_t channel,
     const double rate) {
-    std::lock_guard<std::mutex> lock(_mutex);
+    RFICLock lock(this);
     std::string dirName ((direction == SOAPY_SDR_RX) ? "Rx" : "Tx");
 
     /* Check if the requested sample rate is below 0.55 Msps and throw an exception if so */
@@ -740,6 +1135,7 @@ void SoapyLiteXM2SDR::setSampleRate(
         dirName,
         channel,
         rate / 1e6);
+    auto start = std::chrono::steady_clock::now();
     uint32_t sample_rate = static_cast<uint32_t>(rate);
     _rateMult = 1.0;
 
@@ -759,7 +1155,7 @@ void SoapyLiteXM2SDR::setSampleRate(
 
     /* Check and set FIR decimation/interpolation if actual rate is below 2.5 Msps */
     double actual_rate = rate / _rateMult;
-    if (actual_rate < 2500000.0) {
+    if (actual_rate < 2500000.0 && !_firDec4) {
         SoapySDR::logf(SOAPY_SDR_INFO, "Setting FIR decimation/interpolation to 4 for rate %f < 2.5 Msps", actual_rate);
         ad9361_phy->rx_fir_dec    = 4;
         ad9361_phy->tx_fir_int    = 4;
@@ -773,6 +1169,17 @@ void SoapyLiteXM2SDR::setSampleRate(
         ad9361_set_tx_fir_config(ad9361_phy, tx_fir_cfg);
         ad9361_set_rx_fir_en_dis(ad9361_phy, 1);
         ad9361_set_tx_fir_en_dis(ad9361_phy, 1);
+        _firDec4 = true;
+    } else if (actual_rate >= 2500000.0 && _firDec4) {
+        /* Back to the initial configuration: FIRs bypassed, loaded with decimation/interpolation 1. */
+        SoapySDR::logf(SOAPY_SDR_INFO, "Disabling FIR decimation/interpolation for rate %f >= 2.5 Msps", actual_rate);
+        ad9361_phy->rx_fir_dec    = 1;
+        ad9361_phy->tx_fir_int    = 1;
+        ad9361_set_rx_fir_en_dis(ad9361_phy, 0);
+        ad9361_set_tx_fir_en_dis(ad9361_phy, 0);
+        ad9361_set_rx_fir_config(ad9361_phy, rx_fir_config);
+        ad9361_set_tx_fir_config(ad9361_phy, tx_fir_config);
+        _firDec4 = false;
     }
 
     /* Set the sample rate for the TX and configure the hardware accordingly. */
@@ -793,13 +1200,20 @@ void SoapyLiteXM2SDR::setSampleRate(
         ad9361_enable_oversampling(ad9361_phy);
     }
 
-     /* Finally, update the sample mode (bit depth) based on the new configuration. */
+     /* Finally, update the sample mode (bit depth) based on the new configuration (picked up by the
+        streams on their next activateStream). */
     setSampleMode();
+
+    channel_applied(direction, -1, RF_SAMPLERATE);
+
+    SoapySDR::logf(SOAPY_SDR_DEBUG, "setSampleRate(%s, %g MHz) in %.3f ms", dirName.c_str(), rate / 1e6,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 }
 
 double SoapyLiteXM2SDR::getSampleRate(
     const int direction,
     const size_t) const {
+    RFICLock lock(this);
 
     uint32_t sample_rate = 0;
 
@@ -873,7 +1287,7 @@ void SoapyLiteXM2SDR::setBandwidth(
     const double bw) {
     if (bw == 0.0)
         return;
-    std::lock_guard<std::mutex> lock(_mutex);
+    RFICLock lock(this);
 
     uint32_t bwi = static_cast<uint32_t>(bw);
 
@@ -885,11 +1299,13 @@ void SoapyLiteXM2SDR::setBandwidth(
         _rx_stream.bandwidth = bw;
         ad9361_set_rx_rf_bandwidth(ad9361_phy, bwi);
     }
+    channel_applied(direction, -1, RF_BANDWIDTH);
 }
 
 double SoapyLiteXM2SDR::getBandwidth(
     const int direction,
     const size_t /*channel*/) const {
+    RFICLock lock(this);
 
     uint32_t bw = 0;
 
@@ -914,6 +1330,62 @@ SoapySDR::RangeList SoapyLiteXM2SDR::getBandwidthRange(
  *                                   Clocking API
  **************************************************************************************************/
 
+std::vector<std::string> SoapyLiteXM2SDR::listClockSources(void) const {
+    std::vector<std::string> sources;
+    sources.push_back("internal");
+#if USE_LITEPCIE && defined(CSR_SI5351_BASE)
+    sources.push_back("external");
+#endif
+    return sources;
+}
+
+std::string SoapyLiteXM2SDR::getClockSource(void) const {
+#if USE_LITEPCIE && defined(CSR_SI5351_BASE)
+    std::lock_guard<std::mutex> lock(_csr_mutex);
+    /* SI5351C Version is only selected for the external 10MHz reference. */
+    uint32_t control = litex_m2sdr_readl(_fd, CSR_SI5351_CONTROL_ADDR);
+    if (control & (1 << CSR_SI5351_CONTROL_VERSION_OFFSET))
+        return "external";
+#endif
+    return "internal";
+}
+
+void SoapyLiteXM2SDR::setClockSource(const std::string &source) {
+    RFICLock lock(this);
+    SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyLiteXM2SDR::setClockSource(%s)", source.c_str());
+
+    if (source != "internal" && source != "external")
+        throw std::runtime_error("SoapyLiteXM2SDR: invalid clock source " + source);
+    if (source == getClockSource())
+        return;
+#if USE_LITEPCIE && defined(CSR_SI5351_BASE)
+    /* SI5351 reconfiguration (I2C transactions done in the kernel: fast enough at runtime, only
+     * the registers that differ are written and the PLLs only reset when affected). */
+    int writes;
+    if (source == "internal") {
+        {
+            std::lock_guard<std::mutex> csr_lock(_csr_mutex);
+            litex_m2sdr_writel(_fd, CSR_SI5351_CONTROL_ADDR,
+                SI5351B_VERSION * (1 << CSR_SI5351_CONTROL_VERSION_OFFSET));
+        }
+        writes = m2sdr_si5351_i2c_config(_fd, SI5351_I2C_ADDR, si5351_xo_config,
+            sizeof(si5351_xo_config)/sizeof(si5351_xo_config[0]));
+    } else {
+        {
+            std::lock_guard<std::mutex> csr_lock(_csr_mutex);
+            litex_m2sdr_writel(_fd, CSR_SI5351_CONTROL_ADDR,
+                SI5351C_VERSION               * (1 << CSR_SI5351_CONTROL_VERSION_OFFSET) |
+                SI5351C_10MHZ_CLK_IN_FROM_UFL * (1 << CSR_SI5351_CONTROL_CLK_IN_SRC_OFFSET));
+        }
+        writes = m2sdr_si5351_i2c_config(_fd, SI5351_I2C_ADDR, si5351_clkin_10m_config,
+            sizeof(si5351_clkin_10m_config)/sizeof(si5351_clkin_10m_config[0]));
+    }
+    SoapySDR::logf(SOAPY_SDR_DEBUG, "SI5351: %d registers updated", writes);
+#else
+    throw std::runtime_error("SoapyLiteXM2SDR: clock source " + source + " not supported");
+#endif
+}
+
 /***************************************************************************************************
  *                                    Time API
  **************************************************************************************************/
@@ -924,11 +1396,17 @@ bool SoapyLiteXM2SDR::hasHardwareTime(const std::string &) const {
 
 long long SoapyLiteXM2SDR::getHardwareTime(const std::string &) const
 {
-    uint32_t control_reg = 0;
+    std::lock_guard<std::mutex> lock(_csr_mutex);
     int64_t time_ns = 0;
 
+#if USE_LITEPCIE
+    /* Latch/read the 64-bit Time (ns) in a single register batch. */
+    time_ns = static_cast<int64_t>(m2sdr_time_read(_fd));
+#elif USE_LITEETH
+    uint32_t control_reg = 0;
+
     /* Latch the 64-bit Time (ns) by pulsing READ bit of Control Register. */
-    control_reg = litex_m2sdr_readl(_fd, CSR_TIME_GEN_CONTROL_ADDR);
+    control_reg  = (1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET);
     control_reg |= (1 << CSR_TIME_GEN_CONTROL_READ_OFFSET);
     litex_m2sdr_writel(_fd, CSR_TIME_GEN_CONTROL_ADDR, control_reg);
     control_reg = (1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET);
@@ -937,6 +1415,7 @@ long long SoapyLiteXM2SDR::getHardwareTime(const std::string &) const
     /* Read the upper/lower 32 bits of the 64-bit Time (ns). */
     time_ns |= (static_cast<int64_t>(litex_m2sdr_readl(_fd, CSR_TIME_GEN_READ_TIME_ADDR + 0)) << 32);
     time_ns |= (static_cast<int64_t>(litex_m2sdr_readl(_fd, CSR_TIME_GEN_READ_TIME_ADDR + 4)) <<  0);
+#endif
 
     /* Debug log the hardware time in nanoseconds. */
     SoapySDR::logf(SOAPY_SDR_DEBUG, "Hardware time (ns): %lld", (long long)time_ns);
@@ -946,6 +1425,12 @@ long long SoapyLiteXM2SDR::getHardwareTime(const std::string &) const
 
 void SoapyLiteXM2SDR::setHardwareTime(const long long timeNs, const std::string &)
 {
+    std::lock_guard<std::mutex> lock(_csr_mutex);
+
+#if USE_LITEPCIE
+    /* Write the 64-bit Time (ns) through the driver (serialized with the PTP Hardware Clock). */
+    m2sdr_time_write(_fd, static_cast<uint64_t>(timeNs));
+#elif USE_LITEETH
     uint32_t control_reg = 0;
 
     /* Write the 64-bit Time (ns). */
@@ -953,16 +1438,334 @@ void SoapyLiteXM2SDR::setHardwareTime(const long long timeNs, const std::string
     litex_m2sdr_writel(_fd, CSR_TIME_GEN_WRITE_TIME_ADDR + 4, static_cast<uint32_t>((timeNs >>  0) & 0xffffffff));
 
     /* Pulse the WRITE bit Control Register. */
-    control_reg = litex_m2sdr_readl(_fd, CSR_TIME_GEN_CONTROL_ADDR);
+    control_reg  = (1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET);
     control_reg |= (1 << CSR_TIME_GEN_CONTROL_WRITE_OFFSET);
     litex_m2sdr_writel(_fd, CSR_TIME_GEN_CONTROL_ADDR, control_reg);
     control_reg = (1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET);
     litex_m2sdr_writel(_fd, CSR_TIME_GEN_CONTROL_ADDR, control_reg);
+#endif
 
     /* Optional debug log. */
     SoapySDR::logf(SOAPY_SDR_DEBUG, "Hardware time set to (ns): %lld", (long long)timeNs);
 }
 
+/* Timed commands (fastlock hops): executed when the Hardware Time reaches timeNs (0: immediate).
+ * The gateware has no timed SPI path, the command is issued by the host at that time. */
+void SoapyLiteXM2SDR::setCommandTime(const long long timeNs, const std::string &)
+{
+    _commandTime.store(timeNs);
+}
+
+/* Wait for the Hardware Time: sleep until 1ms before, then poll the time. */
+void SoapyLiteXM2SDR::waitHardwareTime(const long long timeNs) const
+{
+    for (;;) {
+        long long remaining = timeNs - getHardwareTime("");
+        if (remaining <= 0)
+            break;
+        if (remaining > 1000000)
+            std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - 1000000));
+    }
+}
+
+/***************************************************************************************************
+ *                                    Settings API
+ **************************************************************************************************/
+
+/* Comma separated frequency lists (Hz). */
+static std::vector<double> parseFrequencies(const std::string &value) {
+    std::vector<double> frequencies;
+    std::stringstream ss(value);
+    std::string token;
+    while (std::getline(ss, token, ','))
+        if (!token.empty())
+            frequencies.push_back(std::stod(token));
+    return frequencies;
+}
+
+/* Fastlock profile index (0 to HOP_MAX_PROFILES - 1, decimal digits only). */
+static size_t parseHopProfile(const std::string &value) {
+    unsigned long profile = HOP_MAX_PROFILES;
+    if (!value.empty() && value.find_first_not_of("0123456789") == std::string::npos) {
+        try {
+            profile = std::stoul(value);
+        } catch (const std::out_of_range &) {
+            /* Too large: rejected below. */
+        }
+    }
+    if (profile >= HOP_MAX_PROFILES)
+        throw std::runtime_error("writeSetting(HOP): invalid profile \"" + value + "\" (0 to " +
+            std::to_string(HOP_MAX_PROFILES - 1) + ")");
+    return profile;
+}
+
+static std::string formatFrequencies(const std::vector<double> &frequencies) {
+    std::string value;
+    for (double frequency : frequencies)
+        value += (value.empty() ? "" : ",") + std::to_string(static_cast<uint64_t>(frequency));
+    return value;
+}
+
+SoapySDR::ArgInfoList SoapyLiteXM2SDR::getSettingInfo(
+    const int direction,
+    const size_t /*channel*/) const {
+    SoapySDR::ArgInfoList infos;
+    SoapySDR::ArgInfo info;
+
+    info.key         = "HOP_FREQUENCIES";
+    info.value       = "";
+    info.name        = "Hop Frequencies";
+    info.description = "Comma separated list of up to 8 frequencies (Hz) stored in fastlock profiles.";
+    info.type        = SoapySDR::ArgInfo::STRING;
+    infos.push_back(info);
+
+    info.key         = "HOP";
+    info.value       = "-1";
+    info.name        = "Hop";
+    info.description = "Hop to a fastlock profile (index in HOP_FREQUENCIES), at the command time if set.";
+    info.type        = SoapySDR::ArgInfo::INT;
+    infos.push_back(info);
+
+    info.key         = "ASYNC_FREQUENCY";
+    info.value       = "0";
+    info.name        = "Asynchronous Frequency";
+    info.description = "Retune (Hz) from the control thread without blocking, at the command time if set.";
+    info.type        = SoapySDR::ArgInfo::FLOAT;
+    infos.push_back(info);
+
+    info.key         = "ASYNC_GAIN";
+    info.value       = "0";
+    info.name        = "Asynchronous Gain";
+    info.description = "Set the gain (dB) from the control thread without blocking, at the command time if set.";
+    info.type        = SoapySDR::ArgInfo::FLOAT;
+    infos.push_back(info);
+
+    info.key         = "ASYNC_PENDING";
+    info.value       = "0";
+    info.name        = "Asynchronous Pending";
+    info.description = "Number of asynchronous commands not executed yet (read-only).";
+    info.type        = SoapySDR::ArgInfo::INT;
+    infos.push_back(info);
+
+    if (direction == SOAPY_SDR_RX) {
+        info.key         = "SCAN_FREQUENCIES";
+        info.value       = "";
+        info.name        = "Scan Frequencies";
+        info.description = "Comma separated list of the scan LO frequencies (Hz).";
+        info.type        = SoapySDR::ArgInfo::STRING;
+        infos.push_back(info);
+
+        info.key         = "SCAN_DWELL";
+        info.value       = "0.001";
+        info.name        = "Scan Dwell";
+        info.description = "Duration of the block of samples returned for each LO (s).";
+        info.type        = SoapySDR::ArgInfo::FLOAT;
+        infos.push_back(info);
+
+        info.key         = "SCAN_SETTLE";
+        info.value       = "0.0001";
+        info.name        = "Scan Settle";
+        info.description = "Duration of the samples discarded after each retune (s).";
+        info.type        = SoapySDR::ArgInfo::FLOAT;
+        infos.push_back(info);
+
+        info.key         = "SCAN";
+        info.value       = "false";
+        info.name        = "Scan";
+        info.description = "Enable the scan engine on the RX stream (readStream returns the scan blocks).";
+        info.type        = SoapySDR::ArgInfo::BOOL;
+        infos.push_back(info);
+
+        info.key         = "SCAN_FREQUENCY";
+        info.value       = "0";
+        info.name        = "Scan Frequency";
+        info.description = "LO frequency of the last scan samples returned (read-only).";
+        info.type        = SoapySDR::ArgInfo::FLOAT;
+        infos.push_back(info);
+    }
+
+    return infos;
+}
+
+void SoapyLiteXM2SDR::writeSetting(
+    const int direction,
+    const size_t channel,
+    const std::string &key,
+    const std::string &value) {
+    if (key == "HOP_FREQUENCIES") {
+        setHopFrequencies(direction, parseFrequencies(value));
+    } else if (key == "HOP") {
+        hop(direction, parseHopProfile(value));
+    } else if (key == "ASYNC_FREQUENCY") {
+        setFrequencyAsync(direction, channel, std::stod(value), _commandTime.load());
+    } else if (key == "ASYNC_GAIN") {
+        setGainAsync(direction, channel, std::stod(value), _commandTime.load());
+    } else if (direction == SOAPY_SDR_RX && key.compare(0, 4, "SCAN") == 0) {
+        bool enable = (key == "SCAN") && (value == "true" || value == "1");
+        if (_scanEnabled && !(key == "SCAN" && !enable))
+            throw std::runtime_error("writeSetting(" + key + ") not allowed while scanning");
+        if (key == "SCAN_FREQUENCIES") {
+            _scan.frequencies = parseFrequencies(value);
+        } else if (key == "SCAN_DWELL") {
+            _scan.dwell = std::stod(value);
+        } else if (key == "SCAN_SETTLE") {
+            _scan.settle = std::stod(value);
+        } else if (key == "SCAN") {
+            if (enable) {
+#if USE_LITEETH
+                throw std::runtime_error("writeSetting(SCAN): not supported over Ethernet");
+#endif
+                if (_scan.frequencies.empty())
+                    throw std::runtime_error("writeSetting(SCAN): no SCAN_FREQUENCIES");
+                /* Store the scan LOs in the fastlock profiles when they fit. */
+                if (_scan.frequencies.size() <= HOP_MAX_PROFILES &&
+                    _hopFrequencies[SOAPY_SDR_RX] != _scan.frequencies)
+                    setHopFrequencies(SOAPY_SDR_RX, _scan.frequencies);
+            }
+            _scanEnabled = enable;
+        } else {
+            throw std::runtime_error("writeSetting(" + key + ") unknown setting");
+        }
+    } else {
+        throw std::runtime_error("writeSetting(" + key + ") unknown setting");
+    }
+}
+
+std::string SoapyLiteXM2SDR::readSetting(
+    const int direction,
+    const size_t /*channel*/,
+    const std::string &key) const {
+    RFICLock lock(this);
+
+    if (key == "HOP_FREQUENCIES")
+        return formatFrequencies(_hopFrequencies[direction]);
+    if (key == "HOP")
+        return std::to_string(_hopProfile[direction]);
+    if (key == "ASYNC_PENDING") {
+        std::lock_guard<std::mutex> control_lock(_controlMutex);
+        return std::to_string(_controlQueue.size());
+    }
+    if (direction == SOAPY_SDR_RX) {
+        if (key == "SCAN_FREQUENCIES")
+            return formatFrequencies(_scan.frequencies);
+        if (key == "SCAN_DWELL")
+            return std::to_string(_scan.dwell);
+        if (key == "SCAN_SETTLE")
+            return std::to_string(_scan.settle);
+        if (key == "SCAN")
+            return _scanEnabled ? "true" : "false";
+        if (key == "SCAN_FREQUENCY")
+            return std::to_string(static_cast<uint64_t>(_scanFrequency.load()));
+    }
+    throw std::runtime_error("readSetting(" + key + ") unknown setting");
+}
+
+/***************************************************************************************************
+ *                                 Asynchronous Control API
+ **************************************************************************************************/
+
+/* Retunes/gain changes executed by a driver-owned control thread, in order, at their Hardware Time
+ * (host-timed, as the hops). Immediate commands still queued are coalesced with the new ones of
+ * the same type/channel: control loops issuing many small updates only apply the latest one. */
+
+std::future<void> SoapyLiteXM2SDR::controlQueue(
+    ControlType type,
+    const int direction,
+    const size_t channel,
+    const double value,
+    const long long timeNs) {
+    std::promise<void> done;
+    std::future<void> future = done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(_controlMutex);
+
+        if (!_controlThread.joinable())
+            _controlThread = std::thread(&SoapyLiteXM2SDR::controlThread, this);
+
+        /* Coalesce with a queued immediate command (after the last timed one). */
+        if (timeNs == 0) {
+            for (auto it = _controlQueue.rbegin(); it != _controlQueue.rend() && it->timeNs == 0; it++) {
+                if (it->type == type && it->direction == direction && it->channel == channel) {
+                    it->value = value;
+                    it->done.push_back(std::move(done));
+                    return future;
+                }
+            }
+        }
+
+        ControlCommand command;
+        command.type      = type;
+        command.direction = direction;
+        command.channel   = channel;
+        command.value     = value;
+        command.timeNs    = timeNs;
+        command.done.push_back(std::move(done));
+        _controlQueue.push_back(std::move(command));
+    }
+    _controlCond.notify_one();
+    return future;
+}
+
+void SoapyLiteXM2SDR::controlThread(void) {
+    std::unique_lock<std::mutex> lock(_controlMutex);
+    for (;;) {
+        _controlCond.wait(lock, [this] { return _controlStop || !_controlQueue.empty(); });
+        if (_controlStop)
+            break;
+
+        /* Timed command: sleep (interruptible) until 1ms before its time. */
+        long long timeNs = _controlQueue.front().timeNs;
+        if (timeNs > 0) {
+            long long remaining = timeNs - getHardwareTime("");
+            if (remaining > 1000000) {
+                _controlCond.wait_for(lock, std::chrono::nanoseconds(remaining - 1000000),
+                    [this] { return _controlStop; });
+                continue;
+            }
+        }
+
+        ControlCommand command = std::move(_controlQueue.front());
+        _controlQueue.pop_front();
+        lock.unlock();
+
+        try {
+            if (command.timeNs > 0)
+                waitHardwareTime(command.timeNs);
+            if (command.type == CONTROL_FREQUENCY)
+                setFrequency(command.direction, command.channel, command.value, SoapySDR::Kwargs());
+            else if (command.type == CONTROL_SCAN_FREQUENCY)
+                scanRetune(command.value);
+            else
+                setGain(command.direction, command.channel, command.value);
+            for (auto &done : command.done)
+                done.set_value();
+        } catch (const std::exception &e) {
+            SoapySDR::logf(SOAPY_SDR_ERROR, "Asynchronous %s %s failed: %s", dir2Str(command.direction),
+                (command.type == CONTROL_GAIN) ? "gain change" : "retune", e.what());
+            for (auto &done : command.done)
+                done.set_exception(std::current_exception());
+        }
+
+        lock.lock();
+    }
+}
+
+std::future<void> SoapyLiteXM2SDR::setFrequencyAsync(
+    const int direction,
+    const size_t channel,
+    const double frequency,
+    const long long timeNs) {
+    return controlQueue(CONTROL_FREQUENCY, direction, channel, frequency, timeNs);
+}
+
+std::future<void> SoapyLiteXM2SDR::setGainAsync(
+    const int direction,
+    const size_t channel,
+    const double value,
+    const long long timeNs) {
+    return controlQueue(CONTROL_GAIN, direction, channel, value, timeNs);
+}
+
 /***************************************************************************************************
  *                                    Sensors API
  **************************************************************************************************/
@@ -1057,6 +1860,7 @@ std::string SoapyLiteXM2SDR::readSensor(
          /* FPGA Sensors */
 #ifdef CSR_XADC_BASE
         if (deviceStr == "fpga") {
+            std::lock_guard<std::mutex> lock(_csr_mutex);
             /* Temp. */
             if (sensorStr == "temp") {
                 sensorValue = std::to_string(
@@ -1087,6 +1891,7 @@ std::string SoapyLiteXM2SDR::readSensor(
         if (deviceStr == "ad9361") {
             /* Temp. */
             if (sensorStr == "temp") {
+                RFICLock lock(this);
                 sensorValue = std::to_string(ad9361_get_temp(ad9361_phy)/1000); /* FIXME/CHECKME*/
             } else {
                 throw std::runtime_error("SoapyLiteXM2SDR::getSensorInfo(" + key + ") unknown sensor");
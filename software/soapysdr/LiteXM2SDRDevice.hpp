@@ -8,11 +8,17 @@
 
 
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <deque>
+#include <condition_variable>
 #include <cstring>
 #include <cstdlib>
 #include <stdexcept>
 #include <iostream>
 #include <memory>
+#include <array>
 
 #include "liblitepcie.h"
 #include "etherbone.h"
@@ -55,6 +61,8 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
     *                                 Channel configuration
     ***********************************************************************************************/
     void channel_configure(const int direction, const size_t channel);
+    void channel_applied(const int direction, const int channel, const uint32_t settings);
+    void channel_invalidate(void);
 
     /***********************************************************************************************
     *                              Identification API
@@ -265,6 +273,17 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
 
     std::map<int, std::map<size_t, std::map<std::string, double>>> _cachedFreqValues;
 
+    /***********************************************************************************************
+    *                                   Frequency Hopping API
+    ***********************************************************************************************/
+    void setHopFrequencies(const int direction, const std::vector<double> &frequencies);
+    void hop(const int direction, const size_t profile);
+    void hopCheck(const int direction, const size_t profile);
+
+    /* Fastlock profiles (frequencies) of each direction, current profile (-1: none). */
+    std::vector<double> _hopFrequencies[2];
+    int _hopProfile[2] = {-1, -1};
+
     /***********************************************************************************************
     *                                    Sample Rate  API
     ***********************************************************************************************/
@@ -306,6 +325,11 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
     /***********************************************************************************************
     *                                    Clocking API
     ***********************************************************************************************/
+    std::vector<std::string> listClockSources(void) const override;
+
+    void setClockSource(const std::string &source) override;
+
+    std::string getClockSource(void) const override;
 
     /***********************************************************************************************
     *                                     Time API
@@ -313,6 +337,44 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
     bool hasHardwareTime(const std::string &) const override;
     long long getHardwareTime(const std::string &) const override;
     void setHardwareTime(const long long timeNs, const std::string &);
+    void setCommandTime(const long long timeNs, const std::string &what = "") override;
+    void waitHardwareTime(const long long timeNs) const;
+
+    std::atomic<long long> _commandTime{0}; /* Hardware Time of the timed commands (0: immediate). */
+
+    /***********************************************************************************************
+    *                                    Settings API
+    ***********************************************************************************************/
+    SoapySDR::ArgInfoList getSettingInfo(
+        const int direction,
+        const size_t channel) const override;
+
+    void writeSetting(
+        const int direction,
+        const size_t channel,
+        const std::string &key,
+        const std::string &value) override;
+
+    std::string readSetting(
+        const int direction,
+        const size_t channel,
+        const std::string &key) const override;
+
+    /***********************************************************************************************
+    *                                 Asynchronous Control API
+    ***********************************************************************************************/
+    /* Queued to the control thread, executed at timeNs (Hardware Time, 0: immediate). */
+    std::future<void> setFrequencyAsync(
+        const int direction,
+        const size_t channel,
+        const double frequency,
+        const long long timeNs = 0);
+
+    std::future<void> setGainAsync(
+        const int direction,
+        const size_t channel,
+        const double value,
+        const long long timeNs = 0);
 
     /***********************************************************************************************
     *                                    Sensor API
@@ -328,24 +390,43 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
  *                                        PRIVATE
  **************************************************************************************************/
   private:
-    SoapySDR::Stream *const TX_STREAM = (SoapySDR::Stream *)0x1;
-    SoapySDR::Stream *const RX_STREAM = (SoapySDR::Stream *)0x2;
-
     struct litepcie_ioctl_mmap_dma_info _dma_mmap_info;
     void *_dma_buf;
 
-    size_t _rx_buf_size;
-    size_t _tx_buf_size;
-    size_t _rx_buf_count;
-    size_t _tx_buf_count;
     LiteXM2SDRUPDRx *_rx_udp_receiver;
 
+    /* RF settings of a channel (dirty tracking: set but not applied to the AD9361 yet). */
+    enum : uint32_t {
+        RF_SAMPLERATE = (1 << 0),
+        RF_ANTENNA    = (1 << 1),
+        RF_FREQUENCY  = (1 << 2),
+        RF_BANDWIDTH  = (1 << 3),
+        RF_GAINMODE   = (1 << 4),
+        RF_GAIN       = (1 << 5),
+        RF_IQBALANCE  = (1 << 6),
+        RF_ALL        = (1 << 7) - 1,
+    };
+
+    /* Sample format of a stream: snapshot of the device sample mode/channels taken on setupStream and
+     * activateStream, the only format state read by the streaming calls. */
+    struct SampleFormat {
+        uint32_t nChannels       = 2;
+        uint32_t bytesPerSample  = 2;
+        uint32_t bytesPerComplex = 4;
+        float    samplesScaling  = 2048.0;
+    };
+
     struct Stream {
-        Stream() : opened(false), remainderHandle(-1), remainderSamps(0),
-                   remainderOffset(0), remainderBuff(nullptr) {}
+        Stream() : opened(false), fd(FD_INIT), dma_channel(0), buf(nullptr),
+                   buf_size(0), buf_count(0), remainderHandle(-1), remainderSamps(0),
+                   remainderOffset(0), remainderBuff(nullptr), rf_dirty{RF_ALL, RF_ALL} {}
 
         bool opened;
+        litex_m2sdr_device_desc_t fd; /* Devnode of the DMA channel (_fd for DMA channel 0). */
+        size_t dma_channel;
         void *buf;
+        size_t buf_size;              /* Payload size of a DMA buffer (DMA header excluded). */
+        size_t buf_count;
         struct pollfd fds;
         int64_t hw_count, sw_count, user_count;
 
@@ -358,25 +439,31 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
 #if USE_LITEPCIE
         struct litepcie_dma_ctrl dma;
 #endif
+        uint32_t rf_dirty[2]; /* RF settings to apply on activateStream, per channel. */
+        SampleFormat fmt;
     };
 
     struct RXStream: Stream {
         double gain[2];
         bool gainMode[2];
         double iqbalance[2];
-        double samplerate;
+        std::atomic<double> samplerate;
         double bandwidth;
         double frequency;
         std::string antenna[2];
 
         bool overflow;
         bool burst_end;
+#if USE_LITEPCIE
+        struct m2sdr_shm_client *shm_client = nullptr; /* Remote mode: RX buffers from m2sdr_server. */
+        uint64_t shm_overflows = 0;
+#endif
     };
 
     struct TXStream: Stream {
         double gain[2];
         double iqbalance[2];
-        double samplerate;
+        std::atomic<double> samplerate; /* Also read by writeStream (TX DMA header time). */
         double bandwidth;
         double frequency;
         std::string antenna[2];
@@ -387,34 +474,121 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
         int32_t burst_samps;
     };
 
+    /* Streams on DMA channel 0: also hold the RF configuration of the device. */
     RXStream _rx_stream;
     TXStream _tx_stream;
 
+    /* Additional streams on the other DMA channels (sharing the RF configuration), indexed by DMA
+     * channel (slot 0 unused): owned and modified under _stream_mutex, published atomically once
+     * set up so the streaming calls look them up without lock. */
+    std::array<std::atomic<RXStream *>, DMA_CHANNELS> _rx_dma_streams{};
+    std::array<std::atomic<TXStream *>, DMA_CHANNELS> _tx_dma_streams{};
+
+    /* Scan engine: RX stream (DMA channel 0) delivering blocks of samples over a list of LOs. */
+    struct Scan {
+        std::vector<double> frequencies;
+        double dwell  = 1e-3;          /* Samples delivered per LO (s). */
+        double settle = 100e-6;        /* Samples discarded after each retune (s). */
+
+        bool running     = false;
+        size_t index     = 0;          /* LO of the current block. */
+        bool block_tuned = false;      /* LO of the current block tuned (block positions valid). */
+        bool next_tuned  = false;      /* Next LO already tuned (current block captured). */
+        std::future<void> retune;      /* Retune requested to the control thread. */
+        int64_t block_start = 0;       /* Sample positions (from the DMA buffer counts). */
+        int64_t block_end   = 0;
+        int64_t next_start  = 0;
+        int64_t read_pos    = 0;
+        int64_t handle = -1;           /* Acquired DMA buffer. */
+        const int8_t *buff = nullptr;
+        long long buff_time = -1;      /* Hardware Time of the DMA buffer first sample (-1: none). */
+    };
+    Scan _scan;
+
+    /* Control thread: asynchronous retunes/gain changes (and the scan engine retunes). */
+    enum ControlType {
+        CONTROL_FREQUENCY,
+        CONTROL_GAIN,
+        CONTROL_SCAN_FREQUENCY,
+    };
+    struct ControlCommand {
+        ControlType type;
+        int direction;
+        size_t channel;
+        double value;
+        long long timeNs;
+        std::vector<std::promise<void>> done; /* Also completes the coalesced commands. */
+    };
+    std::future<void> controlQueue(ControlType type, const int direction, const size_t channel,
+        const double value, const long long timeNs);
+    void controlThread(void);
+
+    std::deque<ControlCommand> _controlQueue;
+    mutable std::mutex _controlMutex;
+    std::condition_variable _controlCond;
+    std::thread _controlThread;
+    bool _controlStop = false;
+    std::atomic<bool> _scanEnabled{false};
+    std::atomic<double> _scanFrequency{0.0}; /* LO of the last samples returned. */
+
+    int readScan(
+        RXStream *rx,
+        SoapySDR::Stream *stream,
+        void *const *buffs,
+        const size_t numElems,
+        int &flags,
+        long long &timeNs,
+        const long timeoutUs);
+    void scanStop(SoapySDR::Stream *stream);
+    void scanRetune(const double frequency);
+    void scanRequest(const size_t index);
+    bool scanTuned(RXStream *rx, const int64_t spb, int64_t &start, const long timeoutUs);
+    int64_t scanHwCount(RXStream *rx);
+    long long scanBufferTime(RXStream *rx, const int64_t handle, const int64_t spb, const long long buffTime);
+    void scanTimestamps(RXStream *rx, const bool enable);
+    std::string _dma_path_prefix;
+    size_t      _dma_path_index;
+
+    /* Remote mode: RX DMA owned by m2sdr_server, shared with other processes. */
+    bool _remote;
+
+    RXStream *findRXStream(SoapySDR::Stream *stream) const;
+    TXStream *findTXStream(SoapySDR::Stream *stream) const;
+#if USE_LITEPCIE
+    size_t findFreeDMAChannel(const int direction) const;
+    int openDMAChannel(const size_t dma_channel) const;
+#endif
+
     void interleaveCF32(
+        const SampleFormat &fmt,
         const void *src,
         void *dst,
         uint32_t len,
         size_t offset);
 
     void deinterleaveCF32(
+        const SampleFormat &fmt,
         const void *src,
         void *dst,
         uint32_t len,
         size_t offset);
 
     void interleaveCS16(
+        const SampleFormat &fmt,
         const void *src,
         void *dst,
         uint32_t len,
         size_t offset);
 
     void deinterleaveCS16(
+        const SampleFormat &fmt,
         const void *src,
         void *dst,
         uint32_t len,
         size_t offset);
 
     void interleave(
+        const SampleFormat &fmt,
         const void *src,
         void *dst,
         uint32_t len,
@@ -422,6 +596,7 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
         size_t offset);
 
     void deinterleave(
+        const SampleFormat &fmt,
         const void *src,
         void *dst,
         uint32_t len,
@@ -429,16 +604,23 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
         size_t offset);
 
     void setSampleMode();
+    void snapshotSampleFormat(Stream *stream);
 
     const char *dir2Str(const int direction) const {
         return (direction == SOAPY_SDR_RX) ? "RX" : "TX";
     }
 
     litex_m2sdr_device_desc_t _fd;
-    struct ad9361_rf_phy *ad9361_phy;
+    struct ad9361_rf_phy *ad9361_phy = nullptr;
+    uint8_t _spi_id;
+    std::unique_ptr<struct ad9361_cal_cache> _calCache;
+    std::string _calCachePath;
+    std::unique_ptr<struct ad9361_rate_cache> _rateCache;
 
     uint32_t _bitMode           = 16;
     uint32_t _oversampling      = 0;
+    bool     _firDec4           = false; /* FIRs loaded with decimation/interpolation 4 */
+    /* Device sample mode (_nChannels: _stream_mutex, others: _rfic_mutex), see SampleFormat. */
     uint32_t _nChannels         = 2;
     uint32_t _samplesPerComplex = 2;
     uint32_t _bytesPerSample    = 2;
@@ -446,6 +628,27 @@ class DLL_EXPORT SoapyLiteXM2SDR : public SoapySDR::Device {
     float    _samplesScaling    = 2047.0;
     float    _rateMult          = 1;
 
-    // register protection
-    std::mutex _mutex;
+    /* Locking (taken in this order, never from the streaming calls: readStream/writeStream and
+     * the direct buffer API only use the per-stream state, including the sample format snapshot,
+     * and DMA file descriptors):
+     * - _stream_mutex: streams setup/teardown.
+     * - _rfic_mutex:   AD9361 driver state and RF configuration (a retune can take ms).
+     * - _csr_mutex:    CSR accesses sequences (one SPI transfer, Time latch...), short. */
+    std::mutex _stream_mutex;
+    mutable std::mutex _rfic_mutex;
+    mutable std::mutex _csr_mutex;
+
+    /* _rfic_mutex lock, also scoping the AD9361 SPI register cache: the AD9361 can be reconfigured
+     * by other processes (m2sdr_rf, m2sdr_util...) between two calls, so the cached registers are
+     * only trusted while the lock is held. */
+    class RFICLock {
+    public:
+        explicit RFICLock(const SoapyLiteXM2SDR *dev);
+        ~RFICLock(void);
+        RFICLock(const RFICLock &) = delete;
+        RFICLock &operator=(const RFICLock &) = delete;
+    private:
+        std::lock_guard<std::mutex> _lock;
+        struct spi_device *_spi;
+    };
 };
@@ -35,6 +35,22 @@ std::string readFPGAData(
     return data;
 }
 
+#if USE_LITEPCIE
+/* Identifier/DNA are cached by the driver at probe: one ioctl instead of 258 CSR reads. */
+std::string getLiteXM2SDRIdentification(litex_m2sdr_device_desc_t fd) {
+    struct litepcie_ioctl_info info;
+    litepcie_get_info(fd, &info);
+    return std::string(info.identifier, LITEX_IDENTIFIER_SIZE);
+}
+
+std::string getLiteXM2SDRSerial(litex_m2sdr_device_desc_t fd) {
+    struct litepcie_ioctl_info info;
+    litepcie_get_info(fd, &info);
+    char serial[32];
+    snprintf(serial, sizeof(serial), "%x%08x", (unsigned int)(info.dna >> 32), (unsigned int)(info.dna & 0xffffffff));
+    return std::string(serial);
+}
+#elif USE_LITEETH
 std::string getLiteXM2SDRIdentification(litex_m2sdr_device_desc_t fd) {
     return readFPGAData(fd, CSR_IDENTIFIER_MEM_BASE, LITEX_IDENTIFIER_SIZE);
 }
@@ -46,6 +62,7 @@ std::string getLiteXM2SDRSerial(litex_m2sdr_device_desc_t fd) {
     snprintf(serial, sizeof(serial), "%x%08x", high, low);
     return std::string(serial);
 }
+#endif
 
 std::string generateDeviceLabel(
     const SoapySDR::Kwargs &dev,
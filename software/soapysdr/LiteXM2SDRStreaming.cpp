@@ -9,14 +9,22 @@
  * http://www.apache.org/licenses/LICENSE-2.0
  */
 
+#include <algorithm>
 #include <chrono>
 #include <cassert>
 #include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 
 #include "ad9361/ad9361.h"
 #include "ad9361/ad9361_api.h"
 
+#include "soc.h"
+
+#include "libm2sdr.h"
+
 #include "LiteXM2SDRDevice.hpp"
 
 /* RX DMA Header */
@@ -33,110 +41,238 @@ static constexpr size_t TX_DMA_HEADER_SIZE = 16;
 static constexpr size_t TX_DMA_HEADER_SIZE = 0;
 #endif
 
+/* Find the RX stream associated with a stream handle (nullptr if not an RX stream). */
+SoapyLiteXM2SDR::RXStream *SoapyLiteXM2SDR::findRXStream(SoapySDR::Stream *stream) const {
+    if ((void *)stream == (void *)&_rx_stream)
+        return const_cast<RXStream *>(&_rx_stream);
+    for (auto &slot : _rx_dma_streams) {
+        RXStream *rx = slot.load(std::memory_order_acquire);
+        if (rx && (void *)stream == (void *)rx)
+            return rx;
+    }
+    return nullptr;
+}
+
+/* Find the TX stream associated with a stream handle (nullptr if not a TX stream). */
+SoapyLiteXM2SDR::TXStream *SoapyLiteXM2SDR::findTXStream(SoapySDR::Stream *stream) const {
+    if ((void *)stream == (void *)&_tx_stream)
+        return const_cast<TXStream *>(&_tx_stream);
+    for (auto &slot : _tx_dma_streams) {
+        TXStream *tx = slot.load(std::memory_order_acquire);
+        if (tx && (void *)stream == (void *)tx)
+            return tx;
+    }
+    return nullptr;
+}
+
+#if USE_LITEPCIE
+/* Find a free DMA channel for an additional stream (DMA channel 0 is used by the first streams). */
+size_t SoapyLiteXM2SDR::findFreeDMAChannel(const int direction) const {
+    for (size_t dma_channel = 1; dma_channel < DMA_CHANNELS; dma_channel++) {
+        bool used = (direction == SOAPY_SDR_RX) ?
+            (_rx_dma_streams[dma_channel].load() != nullptr) :
+            (_tx_dma_streams[dma_channel].load() != nullptr);
+        if (!used)
+            return dma_channel;
+    }
+    throw std::runtime_error(std::string(dir2Str(direction)) +
+        " stream already opened on all DMA channels (" + std::to_string(DMA_CHANNELS) + ").");
+}
+
+/* Open the devnode of a DMA channel (one /dev/m2sdrX minor per DMA channel). */
+int SoapyLiteXM2SDR::openDMAChannel(const size_t dma_channel) const {
+    std::string path = _dma_path_prefix + std::to_string(_dma_path_index + dma_channel);
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("SoapyLiteXM2SDR: failed to open DMA channel devnode " + path);
+    return fd;
+}
+#endif
+
+/* Snapshot the device sample mode in the stream (called with _stream_mutex and _rfic_mutex held). */
+void SoapyLiteXM2SDR::snapshotSampleFormat(Stream *stream) {
+    stream->fmt.nChannels       = _nChannels;
+    stream->fmt.bytesPerSample  = _bytesPerSample;
+    stream->fmt.bytesPerComplex = _bytesPerComplex;
+    stream->fmt.samplesScaling  = _samplesScaling;
+}
+
 /* Setup and configure a stream for RX or TX. */
 SoapySDR::Stream *SoapyLiteXM2SDR::setupStream(
     const int direction,
     const std::string &format,
     const std::vector<size_t> &channels,
     const SoapySDR::Kwargs &/*args*/) {
-    std::lock_guard<std::mutex> lock(_mutex);
+    std::lock_guard<std::mutex> lock(_stream_mutex);
+
+    /* Default to channel 0 if none are provided. */
+    std::vector<size_t> stream_channels = channels;
+    if (stream_channels.empty())
+        stream_channels = {0};
 
     if (direction == SOAPY_SDR_RX) {
+        RXStream *rx = &_rx_stream;
+        std::unique_ptr<RXStream> dma_stream;
+
+        /* First RX stream uses DMA channel 0, additional ones use the next free DMA channels. */
         if (_rx_stream.opened) {
+#if USE_LITEPCIE
+            if (_remote)
+                throw std::runtime_error("RX stream already opened.");
+            /* Additional streams share the PHY: channels mode can't change. */
+            if (stream_channels.size() != _nChannels)
+                throw std::runtime_error("Additional RX stream must use the same number of channels.");
+            dma_stream.reset(new RXStream());
+            dma_stream->dma_channel = findFreeDMAChannel(SOAPY_SDR_RX);
+            dma_stream->fd          = openDMAChannel(dma_stream->dma_channel);
+            rx = dma_stream.get();
+#else
             throw std::runtime_error("RX stream already opened.");
+#endif
+        } else {
+            rx->fd          = _fd;
+            rx->dma_channel = 0;
         }
 
         /* Configure the file descriptor watcher. */
 #if USE_LITEPCIE
-        _rx_stream.fds.fd     = _fd;
-        _rx_stream.dma.fds.fd = _fd;
+        rx->fds.fd     = rx->fd;
+        rx->dma.fds.fd = rx->fd;
 #endif
-        _rx_stream.fds.events = POLLIN;
+        rx->fds.events = POLLIN;
 
 #if USE_LITEPCIE
-        /* Initialize RX DMA Writer */
-        _rx_stream.dma.shared_fd  = 1;
-        _rx_stream.dma.use_reader = 0;
-        _rx_stream.dma.use_writer = 1;
-        _rx_stream.dma.loopback   = 0;
-        _rx_stream.dma.zero_copy  = 1;
-        if (litepcie_dma_init(&_rx_stream.dma, "", _rx_stream.dma.zero_copy) < 0)
-            throw std::runtime_error("DMA Writer/RX not available (litepcie_dma_init failed).");
-
-        /* Get Buffer and Parameters from RX DMA Writer */
-        _rx_stream.buf = _rx_stream.dma.buf_rd;
-        _rx_buf_size   = _rx_stream.dma.mmap_dma_info.dma_rx_buf_size - RX_DMA_HEADER_SIZE;
-        _rx_buf_count  = _rx_stream.dma.mmap_dma_info.dma_rx_buf_count;
+        if (_remote) {
+            /* Attach to m2sdr_server: RX DMA buffers are mapped read-only, the DMA is not locked. */
+            rx->shm_client = m2sdr_shm_client_open(_dma_path_index);
+            if (!rx->shm_client)
+                throw std::runtime_error("m2sdr_server not available (m2sdr_shm_client_open failed).");
+            rx->buf       = rx->shm_client->buf;
+            rx->buf_size  = rx->shm_client->buf_size - RX_DMA_HEADER_SIZE;
+            rx->buf_count = rx->shm_client->buf_count;
+        } else {
+            /* Initialize RX DMA Writer */
+            rx->dma.shared_fd  = 1;
+            rx->dma.use_reader = 0;
+            rx->dma.use_writer = 1;
+            rx->dma.loopback   = 0;
+            rx->dma.zero_copy  = 1;
+            if (litepcie_dma_init(&rx->dma, "", rx->dma.zero_copy) < 0) {
+                if (rx != &_rx_stream)
+                    close(rx->fd);
+                throw std::runtime_error("DMA Writer/RX not available (litepcie_dma_init failed).");
+            }
 
-        /* Ensure the DMA is disabled initially to avoid counters being in a bad state. */
-        litepcie_dma_writer(_fd, 0, &_rx_stream.hw_count, &_rx_stream.sw_count);
+            /* Get Buffer and Parameters from RX DMA Writer */
+            rx->buf       = rx->dma.buf_rd;
+            rx->buf_size  = rx->dma.mmap_dma_info.dma_rx_buf_size - RX_DMA_HEADER_SIZE;
+            rx->buf_count = rx->dma.mmap_dma_info.dma_rx_buf_count;
+
+            /* Ensure the DMA is disabled initially to avoid counters being in a bad state. */
+            litepcie_dma_writer(rx->fd, 0, &rx->hw_count, &rx->sw_count);
+        }
 
 #elif USE_LITEETH
-        _rx_buf_size = _rx_udp_receiver->buffer_size();
-        _rx_buf_count = _rx_udp_receiver->buffer_count();
-        _rx_stream.buf = malloc(_rx_buf_size * _rx_buf_count);
-        if (!_rx_stream.buf)
+        rx->buf_size  = _rx_udp_receiver->buffer_size();
+        rx->buf_count = _rx_udp_receiver->buffer_count();
+        rx->buf = malloc(rx->buf_size * rx->buf_count);
+        if (!rx->buf)
             throw std::runtime_error("Malloc failed.");
 #endif
 
-        _rx_stream.opened = true;
-        _rx_stream.format = format;
+        rx->opened   = true;
+        rx->format   = format;
+        rx->channels = stream_channels;
 
-        /* Default to channel 0 if none are provided. */
-        if (channels.empty()) {
-            _rx_stream.channels = {0};
-        } else {
-            _rx_stream.channels = channels;
+        /* Additional streams don't reconfigure the PHY. */
+        if (rx != &_rx_stream) {
+            {
+                RFICLock rfic_lock(this);
+                snapshotSampleFormat(rx);
+            }
+            _rx_dma_streams[rx->dma_channel].store(dma_stream.release(), std::memory_order_release);
+            return reinterpret_cast<SoapySDR::Stream *>(rx);
         }
+
         _nChannels = _rx_stream.channels.size();
     } else if (direction == SOAPY_SDR_TX) {
+        TXStream *tx = &_tx_stream;
+        std::unique_ptr<TXStream> dma_stream;
+
+        /* First TX stream uses DMA channel 0, additional ones use the next free DMA channels. */
         if (_tx_stream.opened) {
+#if USE_LITEPCIE
+            /* Additional streams share the PHY: channels mode can't change. */
+            if (stream_channels.size() != _nChannels)
+                throw std::runtime_error("Additional TX stream must use the same number of channels.");
+            dma_stream.reset(new TXStream());
+            dma_stream->dma_channel = findFreeDMAChannel(SOAPY_SDR_TX);
+            dma_stream->fd          = openDMAChannel(dma_stream->dma_channel);
+            tx = dma_stream.get();
+#else
             throw std::runtime_error("TX stream already opened.");
+#endif
+        } else {
+            tx->fd          = _fd;
+            tx->dma_channel = 0;
         }
 
         /* Configure the file descriptor watcher. */
 
 #if USE_LITEPCIE
-        _tx_stream.fds.fd     = _fd;
-        _tx_stream.dma.fds.fd = _fd;
+        tx->fds.fd     = tx->fd;
+        tx->dma.fds.fd = tx->fd;
 #endif
-        _tx_stream.fds.events = POLLOUT;
+        tx->fds.events = POLLOUT;
 
 #if USE_LITEPCIE
         /* Initialize TX DMA Reader */
-        _tx_stream.dma.shared_fd  = 1;
-        _tx_stream.dma.use_reader = 1;
-        _tx_stream.dma.use_writer = 0;
-        _tx_stream.dma.loopback   = 0;
-        _tx_stream.dma.zero_copy  = 1;
-        if (litepcie_dma_init(&_tx_stream.dma, "", _tx_stream.dma.zero_copy) < 0)
+        tx->dma.shared_fd  = 1;
+        tx->dma.use_reader = 1;
+        tx->dma.use_writer = 0;
+        tx->dma.loopback   = 0;
+        tx->dma.zero_copy  = 1;
+        if (litepcie_dma_init(&tx->dma, "", tx->dma.zero_copy) < 0) {
+            if (tx != &_tx_stream)
+                close(tx->fd);
             throw std::runtime_error("DMA Reader/TX not available (litepcie_dma_init failed).");
+        }
 
         /* Get Buffer and Parameters from TX DMA Reader */
-        _tx_stream.buf = _tx_stream.dma.buf_wr;
-        _tx_buf_size   = _tx_stream.dma.mmap_dma_info.dma_tx_buf_size - TX_DMA_HEADER_SIZE;
-        _tx_buf_count  = _tx_stream.dma.mmap_dma_info.dma_tx_buf_count;
+        tx->buf       = tx->dma.buf_wr;
+        tx->buf_size  = tx->dma.mmap_dma_info.dma_tx_buf_size - TX_DMA_HEADER_SIZE;
+        tx->buf_count = tx->dma.mmap_dma_info.dma_tx_buf_count;
 
         /* Ensure the DMA is disabled initially to avoid counters being in a bad state. */
-        litepcie_dma_reader(_fd, 0, &_tx_stream.hw_count, &_tx_stream.sw_count);
+        litepcie_dma_reader(tx->fd, 0, &tx->hw_count, &tx->sw_count);
 #endif
 
-        _tx_stream.opened = true;
-        _tx_stream.format = format;
+        tx->opened   = true;
+        tx->format   = format;
+        tx->channels = stream_channels;
 
-        /* Default to channel 0 if none are provided. */
-        if (channels.empty()) {
-            _tx_stream.channels = {0};
-        } else {
-            _tx_stream.channels = channels;
+        /* Additional streams don't reconfigure the PHY. */
+        if (tx != &_tx_stream) {
+            {
+                RFICLock rfic_lock(this);
+                snapshotSampleFormat(tx);
+            }
+            _tx_dma_streams[tx->dma_channel].store(dma_stream.release(), std::memory_order_release);
+            return reinterpret_cast<SoapySDR::Stream *>(tx);
         }
+
         _nChannels = _tx_stream.channels.size();
     } else {
         throw std::runtime_error("Invalid direction.");
     }
 
+    RFICLock rfic_lock(this);
+
     /* Configure 2T2R/1T1R mode (PHY) */
-    litex_m2sdr_writel(_fd, CSR_AD9361_PHY_CONTROL_ADDR, _nChannels == 1 ? 1 : 0);
+    {
+        std::lock_guard<std::mutex> csr_lock(_csr_mutex);
+        litex_m2sdr_writel(_fd, CSR_AD9361_PHY_CONTROL_ADDR, _nChannels == 1 ? 1 : 0);
+    }
 
     /* AD9361 Channel en/dis */
     ad9361_phy->pdata->rx2tx2 = (_nChannels == 2);
@@ -160,23 +296,62 @@ SoapySDR::Stream *SoapyLiteXM2SDR::setupStream(
 
     ad9361_set_no_ch_mode(ad9361_phy, _nChannels);
 
-    return direction == SOAPY_SDR_RX ? RX_STREAM : TX_STREAM;
+    /* The AD9361 has been reset: RF settings will be re-applied on activateStream. */
+    channel_invalidate();
+
+    if (direction == SOAPY_SDR_RX)
+        snapshotSampleFormat(&_rx_stream);
+    else
+        snapshotSampleFormat(&_tx_stream);
+
+    return direction == SOAPY_SDR_RX ?
+        reinterpret_cast<SoapySDR::Stream *>(&_rx_stream) :
+        reinterpret_cast<SoapySDR::Stream *>(&_tx_stream);
 }
 
 /* Close the specified stream and release associated resources. */
 void SoapyLiteXM2SDR::closeStream(SoapySDR::Stream *stream) {
-    std::lock_guard<std::mutex> lock(_mutex);
+    std::lock_guard<std::mutex> lock(_stream_mutex);
 
-    if (stream == RX_STREAM) {
+    RXStream *rx = findRXStream(stream);
+    TXStream *tx = findTXStream(stream);
+
+    if (rx) {
 #if USE_LITEPCIE
-        litepcie_dma_cleanup(&_rx_stream.dma);
+        if (rx->shm_client) {
+            m2sdr_shm_client_close(rx->shm_client);
+            rx->shm_client = nullptr;
+        } else {
+            litepcie_dma_cleanup(&rx->dma);
+        }
 #elif USE_LITEETH
-        free(_rx_stream.buf);
+        free(rx->buf);
+#endif
+        rx->opened = false;
+        if (rx == &_rx_stream) {
+            _scan.handle  = -1;
+            _scan.running = false;
+        }
+#if USE_LITEPCIE
+        /* Additional streams: close DMA channel devnode and release stream. */
+        if (rx != &_rx_stream) {
+            close(rx->fd);
+            _rx_dma_streams[rx->dma_channel].store(nullptr, std::memory_order_release);
+            delete rx;
+        }
 #endif
-        _rx_stream.opened = false;
-    } else if (stream == TX_STREAM) {
+    } else if (tx) {
 #if USE_LITEPCIE
-        litepcie_dma_cleanup(&_tx_stream.dma);
+        litepcie_dma_cleanup(&tx->dma);
+#endif
+        tx->opened = false;
+#if USE_LITEPCIE
+        /* Additional streams: close DMA channel devnode and release stream. */
+        if (tx != &_tx_stream) {
+            close(tx->fd);
+            _tx_dma_streams[tx->dma_channel].store(nullptr, std::memory_order_release);
+            delete tx;
+        }
 #endif
     }
 }
@@ -188,31 +363,52 @@ int SoapyLiteXM2SDR::activateStream(
     const long long /*timeNs*/,
     const size_t /*numElems*/) {
 
+    RXStream *rx = findRXStream(stream);
+    TXStream *tx = findTXStream(stream);
+
+    /* Pick up the current sample mode (it changes with the sample rate: 8-bit at 122.88 MSPS). */
+    if (rx || tx) {
+        std::lock_guard<std::mutex> lock(_stream_mutex);
+        RFICLock rfic_lock(this);
+        snapshotSampleFormat(rx ? static_cast<Stream *>(rx) : static_cast<Stream *>(tx));
+    }
+
     /* RX */
-    if (stream == RX_STREAM) {
-        for (size_t i = 0; i < _rx_stream.channels.size(); i++)
-            channel_configure(SOAPY_SDR_RX, _rx_stream.channels[i]);
+    if (rx) {
+        for (size_t i = 0; i < rx->channels.size(); i++)
+            channel_configure(SOAPY_SDR_RX, rx->channels[i]);
 #if USE_LITEPCIE
         /* Crossbar Demux: Select PCIe streaming */
-        litex_m2sdr_writel(_fd, CSR_CROSSBAR_DEMUX_SEL_ADDR, 0);
-        /* Configure the DMA engine for RX, but don't enable it yet. */
-        litepcie_dma_writer(_fd, 0, &_rx_stream.hw_count, &_rx_stream.sw_count);
+        if (rx->dma_channel == 0) {
+            std::lock_guard<std::mutex> lock(_csr_mutex);
+            litex_m2sdr_writel(_fd, CSR_CROSSBAR_DEMUX_SEL_ADDR, 0);
+        }
+        /* Configure the DMA engine for RX, but don't enable it yet (remote: m2sdr_server owns it). */
+        if (rx->shm_client) {
+            m2sdr_shm_client_flush(rx->shm_client);
+            rx->shm_overflows = m2sdr_shm_client_overflows(rx->shm_client);
+        } else {
+            litepcie_dma_writer(rx->fd, 0, &rx->hw_count, &rx->sw_count);
+        }
 #elif USE_LITEETH
         /* Crossbar Demux: Select Ethernet streaming */
-        litex_m2sdr_writel(_fd, CSR_CROSSBAR_DEMUX_SEL_ADDR, 1);
+        {
+            std::lock_guard<std::mutex> lock(_csr_mutex);
+            litex_m2sdr_writel(_fd, CSR_CROSSBAR_DEMUX_SEL_ADDR, 1);
+        }
         _rx_udp_receiver->start();
 #endif
-        _rx_stream.user_count = 0;
-        _rx_stream.burst_end = false;
+        rx->user_count = 0;
+        rx->burst_end = false;
 
     /* TX */
-    } else if (stream == TX_STREAM) {
+    } else if (tx) {
 #if USE_LITEPCIE
-        for (size_t i = 0; i < _tx_stream.channels.size(); i++)
-            channel_configure(SOAPY_SDR_TX, _tx_stream.channels[i]);
+        for (size_t i = 0; i < tx->channels.size(); i++)
+            channel_configure(SOAPY_SDR_TX, tx->channels[i]);
         /* Configure the DMA engine for TX, but don't enable it yet. */
-        litepcie_dma_reader(_fd, 0, &_tx_stream.hw_count, &_tx_stream.sw_count);
-        _tx_stream.user_count = 0;
+        litepcie_dma_reader(tx->fd, 0, &tx->hw_count, &tx->sw_count);
+        tx->user_count = 0;
 #endif
     }
 
@@ -224,21 +420,31 @@ int SoapyLiteXM2SDR::deactivateStream(
     SoapySDR::Stream *stream,
     const int /*flags*/,
     const long long /*timeNs*/) {
-    if (stream == RX_STREAM) {
+    RXStream *rx = findRXStream(stream);
+    TXStream *tx = findTXStream(stream);
+
+    if (rx) {
         /* Disable the DMA engine for RX. */
 #if USE_LITEPCIE
-        litepcie_dma_writer(_fd, 0, &_rx_stream.hw_count, &_rx_stream.sw_count);
+        if (!rx->shm_client)
+            litepcie_dma_writer(rx->fd, 0, &rx->hw_count, &rx->sw_count);
 #elif USE_LITEETH
         _rx_udp_receiver->stop();
 #endif
         /* set burst_end: if readStream is called after this point SOAPY_SDR_END_BURST
          * will be set
          */
-        _rx_stream.burst_end = true;
-    } else if (stream == TX_STREAM) {
+        rx->burst_end = true;
+
+        /* Restart the scan on the next activation (DMA buffer counts reset). */
+        if (rx == &_rx_stream) {
+            _scan.handle  = -1;
+            _scan.running = false;
+        }
+    } else if (tx) {
 #if USE_LITEPCIE
         /* Disable the DMA engine for TX. */
-        litepcie_dma_reader(_fd, 0, &_tx_stream.hw_count, &_tx_stream.sw_count);
+        litepcie_dma_reader(tx->fd, 0, &tx->hw_count, &tx->sw_count);
 #endif
     }
     return 0;
@@ -250,11 +456,14 @@ int SoapyLiteXM2SDR::deactivateStream(
 
 /* Retrieve the maximum transmission unit (MTU) for a stream. */
 size_t SoapyLiteXM2SDR::getStreamMTU(SoapySDR::Stream *stream) const {
-    if (stream == RX_STREAM) {
+    const RXStream *rx = findRXStream(stream);
+    const TXStream *tx = findTXStream(stream);
+
+    if (rx) {
         /* Each sample is 2 * Complex{Int16}. */
-        return _rx_buf_size / (_nChannels * _bytesPerComplex);
-    } else if (stream == TX_STREAM) {
-        return _tx_buf_size / (_nChannels * _bytesPerComplex);
+        return rx->buf_size / (rx->fmt.nChannels * rx->fmt.bytesPerComplex);
+    } else if (tx) {
+        return tx->buf_size / (tx->fmt.nChannels * tx->fmt.bytesPerComplex);
     } else {
         throw std::runtime_error("SoapySDR::getStreamMTU(): Invalid stream.");
     }
@@ -262,10 +471,13 @@ size_t SoapyLiteXM2SDR::getStreamMTU(SoapySDR::Stream *stream) const {
 
 /* Retrieve the number of direct access buffers available for a stream. */
 size_t SoapyLiteXM2SDR::getNumDirectAccessBuffers(SoapySDR::Stream *stream) {
-    if (stream == RX_STREAM) {
-        return _rx_buf_count;
-    } else if (stream == TX_STREAM) {
-        return _dma_mmap_info.dma_tx_buf_count;
+    const RXStream *rx = findRXStream(stream);
+    const TXStream *tx = findTXStream(stream);
+
+    if (rx) {
+        return rx->buf_count;
+    } else if (tx) {
+        return tx->buf_count;
     } else {
         throw std::runtime_error("SoapySDR::getNumDirectAccessBuffers(): Invalid stream.");
     }
@@ -276,16 +488,18 @@ int SoapyLiteXM2SDR::getDirectAccessBufferAddrs(
     SoapySDR::Stream *stream,
     const size_t handle,
     void **buffs) {
-    if (stream == RX_STREAM) {
-        buffs[0] = (char *)_rx_stream.buf + handle * _dma_mmap_info.dma_rx_buf_size + RX_DMA_HEADER_SIZE;
-    } else if (stream == TX_STREAM) {
-        buffs[0] = (char *)_tx_stream.buf + handle * _dma_mmap_info.dma_tx_buf_size + TX_DMA_HEADER_SIZE;
+    const RXStream *rx = findRXStream(stream);
+    const TXStream *tx = findTXStream(stream);
+
+    if (rx) {
+        buffs[0] = (char *)rx->buf + handle * (rx->buf_size + RX_DMA_HEADER_SIZE) + RX_DMA_HEADER_SIZE;
+    } else if (tx) {
+        buffs[0] = (char *)tx->buf + handle * (tx->buf_size + TX_DMA_HEADER_SIZE) + TX_DMA_HEADER_SIZE;
     } else {
         throw std::runtime_error("SoapySDR::getDirectAccessBufferAddrs(): Invalid stream.");
     }
     return 0;
 }
-
 /***************************************************************************************************
  * DMA Buffer Management
  *
@@ -317,17 +531,18 @@ int SoapyLiteXM2SDR::acquireReadBuffer(
     size_t &handle,
     const void **buffs,
     int &flags,
-#if USE_LITEPCIE && defined(_RX_DMA_HEADER_TEST)
+#if USE_LITEPCIE
      long long &timeNs,
 #else
      long long &/*timeNs*/,
 #endif
     const long timeoutUs) {
-    if (stream != RX_STREAM) {
+    RXStream *rx = findRXStream(stream);
+    if (!rx) {
         return SOAPY_SDR_STREAM_ERROR;
     }
 
-    if (_rx_stream.burst_end)
+    if (rx->burst_end)
         flags |= SOAPY_SDR_END_BURST;
 
 #if USE_LITEETH
@@ -344,26 +559,50 @@ int SoapyLiteXM2SDR::acquireReadBuffer(
         return SOAPY_SDR_OVERFLOW;
     }
 #endif
-    buffs[0] = (char *)_rx_stream.buf;
+    buffs[0] = (char *)rx->buf;
     int pos = 0;
-    char *ptr = (char *)_rx_stream.buf;
+    char *ptr = (char *)rx->buf;
     std::vector<char> vc = _rx_udp_receiver->get_data();
-    memcpy(ptr, vc.data(), _rx_buf_size);
-    pos += _rx_buf_size;
+    memcpy(ptr, vc.data(), rx->buf_size);
+    pos += rx->buf_size;
 
     handle = pos;
     return getStreamMTU(stream);
 
 #elif USE_LITEPCIE
 
+    /* Remote mode: get the buffers from m2sdr_server. */
+    if (rx->shm_client) {
+        int64_t time_ns;
+        if (!m2sdr_shm_client_acquire(rx->shm_client, &time_ns, timeoutUs / 1000))
+            return SOAPY_SDR_TIMEOUT;
+
+        /* Report the buffers lost by this client (the other clients are not affected). */
+        uint64_t overflows = m2sdr_shm_client_overflows(rx->shm_client);
+        if (overflows != rx->shm_overflows) {
+            rx->shm_overflows = overflows;
+            handle = -1;
+            flags |= SOAPY_SDR_END_ABRUPT;
+            return SOAPY_SDR_OVERFLOW;
+        }
+
+        if (time_ns) {
+            timeNs = time_ns;
+            flags |= SOAPY_SDR_HAS_TIME;
+        }
+        handle = rx->shm_client->cursor;
+        getDirectAccessBufferAddrs(stream, handle % rx->buf_count, (void **)buffs);
+        return getStreamMTU(stream);
+    }
+
     /* Check if there are buffers available. */
-    int buffers_available = _rx_stream.hw_count - _rx_stream.user_count;
+    int buffers_available = rx->hw_count - rx->user_count;
     assert(buffers_available >= 0);
 
     /* If not, check with the DMA engine. */
     if (buffers_available == 0 || DETECT_EVERY_OVERFLOW) {
-        litepcie_dma_writer(_fd, 1, &_rx_stream.hw_count, &_rx_stream.sw_count);
-        buffers_available = _rx_stream.hw_count - _rx_stream.user_count;
+        litepcie_dma_writer(rx->fd, 1, &rx->hw_count, &rx->sw_count);
+        buffers_available = rx->hw_count - rx->user_count;
     }
 
     /* If no buffers available, wait for new buffers to arrive. */
@@ -371,7 +610,7 @@ int SoapyLiteXM2SDR::acquireReadBuffer(
         if (timeoutUs == 0) {
             return SOAPY_SDR_TIMEOUT;
         }
-        int ret = poll(&_rx_stream.fds, 1, timeoutUs / 1000);
+        int ret = poll(&rx->fds, 1, timeoutUs / 1000);
         if (ret < 0) {
             throw std::runtime_error("SoapyLiteXM2SDR::acquireReadBuffer(): Poll failed, " +
                                      std::string(strerror(errno)) + ".");
@@ -380,33 +619,33 @@ int SoapyLiteXM2SDR::acquireReadBuffer(
         }
 
         /* Get new DMA counters. */
-        litepcie_dma_writer(_fd, 1, &_rx_stream.hw_count, &_rx_stream.sw_count);
-        buffers_available = _rx_stream.hw_count - _rx_stream.user_count;
+        litepcie_dma_writer(rx->fd, 1, &rx->hw_count, &rx->sw_count);
+        buffers_available = rx->hw_count - rx->user_count;
         assert(buffers_available > 0);
     }
 
     /* Detect overflows of the underlying circular buffer. */
-    if ((_rx_stream.hw_count - _rx_stream.sw_count) >
-        ((int64_t)_dma_mmap_info.dma_rx_buf_count / 2)) {
+    if ((rx->hw_count - rx->sw_count) >
+        ((int64_t)rx->buf_count / 2)) {
         /* Drain all buffers to get out of the overflow quicker. */
         struct litepcie_ioctl_mmap_dma_update mmap_dma_update;
-        mmap_dma_update.sw_count = _rx_stream.hw_count;
-        checked_ioctl(_fd, LITEPCIE_IOCTL_MMAP_DMA_WRITER_UPDATE, &mmap_dma_update);
-        _rx_stream.user_count = _rx_stream.hw_count;
-        _rx_stream.sw_count = _rx_stream.hw_count;
+        mmap_dma_update.sw_count = rx->hw_count;
+        checked_ioctl(rx->fd, LITEPCIE_IOCTL_MMAP_DMA_WRITER_UPDATE, &mmap_dma_update);
+        rx->user_count = rx->hw_count;
+        rx->sw_count = rx->hw_count;
         handle = -1;
 
         flags |= SOAPY_SDR_END_ABRUPT;
         return SOAPY_SDR_OVERFLOW;
     } else {
         /* Get the buffer. */
-        int buf_offset = _rx_stream.user_count % _dma_mmap_info.dma_rx_buf_count;
+        int buf_offset = rx->user_count % rx->buf_count;
 
         /* Extract Sync Word and Timestamp from the DMA header */
 #if defined(_RX_DMA_HEADER_TEST)
         {
             /* Header is at the beginning of the DMA buffer */
-            const uint8_t *header_ptr = reinterpret_cast<const uint8_t *>(_rx_stream.buf) + buf_offset * _dma_mmap_info.dma_rx_buf_size;
+            const uint8_t *header_ptr = reinterpret_cast<const uint8_t *>(rx->buf) + buf_offset * (rx->buf_size + RX_DMA_HEADER_SIZE);
 
             /* Extract sync word from bytes 0 to 8 of the Header */
             uint64_t header = *reinterpret_cast<const uint64_t*>(header_ptr);
@@ -434,8 +673,8 @@ int SoapyLiteXM2SDR::acquireReadBuffer(
         getDirectAccessBufferAddrs(stream, buf_offset, (void **)buffs);
 
         /* Update the DMA counters. */
-        handle = _rx_stream.user_count;
-        _rx_stream.user_count++;
+        handle = rx->user_count;
+        rx->user_count++;
 
         return getStreamMTU(stream);
     }
@@ -444,15 +683,25 @@ int SoapyLiteXM2SDR::acquireReadBuffer(
 
 /* Release a read buffer after use. */
 void SoapyLiteXM2SDR::releaseReadBuffer(
-    SoapySDR::Stream */*stream*/,
+    SoapySDR::Stream *stream,
     size_t handle) {
     assert(handle != (size_t)-1 && "Attempt to release an invalid buffer (e.g., from an overflow).");
 
 #if USE_LITEPCIE
+    RXStream *rx = findRXStream(stream);
+    if (!rx)
+        return;
+
+    /* Remote mode: release the buffer to m2sdr_server (overflows reported on next acquire). */
+    if (rx->shm_client) {
+        m2sdr_shm_client_release(rx->shm_client);
+        return;
+    }
+
     /* Update the DMA counters. */
     struct litepcie_ioctl_mmap_dma_update mmap_dma_update;
     mmap_dma_update.sw_count = handle + 1;
-    checked_ioctl(_fd, LITEPCIE_IOCTL_MMAP_DMA_WRITER_UPDATE, &mmap_dma_update);
+    checked_ioctl(rx->fd, LITEPCIE_IOCTL_MMAP_DMA_WRITER_UPDATE, &mmap_dma_update);
 #endif
 }
 
@@ -462,27 +711,28 @@ int SoapyLiteXM2SDR::acquireWriteBuffer(
     size_t &handle,
     void **buffs,
     const long timeoutUs) {
-    if (stream != TX_STREAM) {
+    TXStream *tx = findTXStream(stream);
+    if (!tx) {
         return SOAPY_SDR_STREAM_ERROR;
     }
 
 #if USE_LITEPCIE
     /* Check if there are buffers available. */
-    int buffers_pending = _tx_stream.user_count - _tx_stream.hw_count;
-    assert(buffers_pending <= (int)_dma_mmap_info.dma_tx_buf_count);
+    int buffers_pending = tx->user_count - tx->hw_count;
+    assert(buffers_pending <= (int)tx->buf_count);
 
     /* If not, check with the DMA engine. */
-    if (buffers_pending == ((int64_t)_dma_mmap_info.dma_tx_buf_count) || DETECT_EVERY_UNDERFLOW) {
-        litepcie_dma_reader(_fd, 1, &_tx_stream.hw_count, &_tx_stream.sw_count);
-        buffers_pending = _tx_stream.user_count - _tx_stream.hw_count;
+    if (buffers_pending == ((int64_t)tx->buf_count) || DETECT_EVERY_UNDERFLOW) {
+        litepcie_dma_reader(tx->fd, 1, &tx->hw_count, &tx->sw_count);
+        buffers_pending = tx->user_count - tx->hw_count;
     }
 
     /* If no buffers available, wait for new buffers to become available. */
-    if (buffers_pending == ((int64_t)_dma_mmap_info.dma_tx_buf_count)) {
+    if (buffers_pending == ((int64_t)tx->buf_count)) {
         if (timeoutUs == 0) {
             return SOAPY_SDR_TIMEOUT;
         }
-        int ret = poll(&_tx_stream.fds, 1, timeoutUs / 1000);
+        int ret = poll(&tx->fds, 1, timeoutUs / 1000);
         if (ret < 0) {
             throw std::runtime_error("SoapyLiteXM2SDR::acquireWriteBuffer(): Poll failed, " +
                                      std::string(strerror(errno)) + ".");
@@ -491,31 +741,31 @@ int SoapyLiteXM2SDR::acquireWriteBuffer(
         }
 
         /* Get new DMA counters. */
-        litepcie_dma_reader(_fd, 1, &_tx_stream.hw_count, &_tx_stream.sw_count);
-        buffers_pending = _tx_stream.user_count - _tx_stream.hw_count;
-        assert(buffers_pending < ((int64_t)_dma_mmap_info.dma_tx_buf_count));
+        litepcie_dma_reader(tx->fd, 1, &tx->hw_count, &tx->sw_count);
+        buffers_pending = tx->user_count - tx->hw_count;
+        assert(buffers_pending < ((int64_t)tx->buf_count));
     }
 
     /* Get the buffer. */
-    int buf_offset = _tx_stream.user_count % _dma_mmap_info.dma_tx_buf_count;
+    int buf_offset = tx->user_count % tx->buf_count;
     getDirectAccessBufferAddrs(stream, buf_offset, buffs);
 
     /* Update the DMA counters. */
-    handle = _tx_stream.user_count;
-    _tx_stream.user_count++;
+    handle = tx->user_count;
+    tx->user_count++;
 
     /* Write Sync Word and Timestamp to DMA header */
 #if defined(_TX_DMA_HEADER_TEST)
     {
         /* Header is at the beginning of the DMA buffer */
-        uint8_t *tx_buffer = reinterpret_cast<uint8_t*>(_tx_stream.buf) + (buf_offset * _dma_mmap_info.dma_tx_buf_size);
+        uint8_t *tx_buffer = reinterpret_cast<uint8_t*>(tx->buf) + (buf_offset * (tx->buf_size + TX_DMA_HEADER_SIZE));
 
         /* Extract Sync Word to bytes 0 to 8 of the Header */
         uint64_t header = DMA_HEADER_SYNC_WORD;
         *reinterpret_cast<uint64_t*>(tx_buffer) = header;
 
         /* Compute the number of samples per DMA buffer. */
-        uint32_t samples_per_buffer = _dma_mmap_info.dma_tx_buf_size / (_nChannels * _bytesPerComplex);
+        uint32_t samples_per_buffer = tx->buf_size / (tx->fmt.nChannels * tx->fmt.bytesPerComplex);
 
         /* Compute time increment (in nanoseconds) for this buffer */
         uint64_t time_increment = static_cast<uint64_t>((samples_per_buffer / _tx_stream.samplerate) * 1e9);
@@ -543,7 +793,7 @@ int SoapyLiteXM2SDR::acquireWriteBuffer(
 
 /* Release a write buffer after use. */
 void SoapyLiteXM2SDR::releaseWriteBuffer(
-    SoapySDR::Stream */*stream*/,
+    SoapySDR::Stream *stream,
     size_t handle,
     const size_t /*numElems*/,
     int &/*flags*/,
@@ -551,146 +801,155 @@ void SoapyLiteXM2SDR::releaseWriteBuffer(
     /* XXX: Inspect user-provided numElems and flags, and act upon them? */
 
 #if USE_LITEPCIE
+    TXStream *tx = findTXStream(stream);
+    if (!tx)
+        return;
+
     /* Update the DMA counters so that the engine can submit this buffer. */
     struct litepcie_ioctl_mmap_dma_update mmap_dma_update;
     mmap_dma_update.sw_count = handle + 1;
-    checked_ioctl(_fd, LITEPCIE_IOCTL_MMAP_DMA_READER_UPDATE, &mmap_dma_update);
+    checked_ioctl(tx->fd, LITEPCIE_IOCTL_MMAP_DMA_READER_UPDATE, &mmap_dma_update);
 #endif
 }
 
 /* Interleave CF32 samples. */
 void SoapyLiteXM2SDR::interleaveCF32(
+    const SampleFormat &fmt,
     const void *src,
     void *dst,
     uint32_t len,
     size_t offset) {
     const float *samples_cf32 = reinterpret_cast<const float*>(src) + (offset * _samplesPerComplex);
 
-    if (_bytesPerSample == 2) {
+    if (fmt.bytesPerSample == 2) {
         int16_t *dst_int16 = reinterpret_cast<int16_t*>(dst) + (offset * 2 * _samplesPerComplex);
         for (uint32_t i = 0; i < len; i++) {
-            dst_int16[0] = static_cast<int16_t>(samples_cf32[0] * _samplesScaling); /* I. */
-            dst_int16[1] = static_cast<int16_t>(samples_cf32[1] * _samplesScaling); /* Q. */
+            dst_int16[0] = static_cast<int16_t>(samples_cf32[0] * fmt.samplesScaling); /* I. */
+            dst_int16[1] = static_cast<int16_t>(samples_cf32[1] * fmt.samplesScaling); /* Q. */
             samples_cf32 += 2;
-            dst_int16 += _nChannels * _samplesPerComplex;
+            dst_int16 += fmt.nChannels * _samplesPerComplex;
         }
-    } else if (_bytesPerSample == 1) {
+    } else if (fmt.bytesPerSample == 1) {
         int8_t *dst_int8 = reinterpret_cast<int8_t*>(dst) + (offset * 2 * _samplesPerComplex);
         for (uint32_t i = 0; i < len; i++) {
-            dst_int8[0] = static_cast<int8_t>(samples_cf32[0] * (_samplesScaling)); /* I. */
-            dst_int8[1] = static_cast<int8_t>(samples_cf32[1] * (_samplesScaling)); /* Q. */
+            dst_int8[0] = static_cast<int8_t>(samples_cf32[0] * fmt.samplesScaling); /* I. */
+            dst_int8[1] = static_cast<int8_t>(samples_cf32[1] * fmt.samplesScaling); /* Q. */
             samples_cf32 += 2;
-            dst_int8 += _nChannels * _samplesPerComplex;
+            dst_int8 += fmt.nChannels * _samplesPerComplex;
         }
     } else {
-        SoapySDR_logf(SOAPY_SDR_ERROR, "Unsupported _bytesPerSample value: %u.", _bytesPerSample);
+        SoapySDR_logf(SOAPY_SDR_ERROR, "Unsupported bytesPerSample value: %u.", fmt.bytesPerSample);
     }
 }
 
 /* Deinterleave CF32 samples. */
 void SoapyLiteXM2SDR::deinterleaveCF32(
+    const SampleFormat &fmt,
     const void *src,
     void *dst,
     uint32_t len,
     size_t offset) {
     float *samples_cf32 = reinterpret_cast<float*>(dst) + (offset * _samplesPerComplex);
 
-    if (_bytesPerSample == 2) {
+    if (fmt.bytesPerSample == 2) {
         const int16_t *src_int16 = reinterpret_cast<const int16_t*>(src);
 
         for (uint32_t i = 0; i < len; i++) {
-            samples_cf32[0] = static_cast<float>(src_int16[0]) / _samplesScaling; /* I. */
-            samples_cf32[1] = static_cast<float>(src_int16[1]) / _samplesScaling; /* Q. */
+            samples_cf32[0] = static_cast<float>(src_int16[0]) / fmt.samplesScaling; /* I. */
+            samples_cf32[1] = static_cast<float>(src_int16[1]) / fmt.samplesScaling; /* Q. */
             samples_cf32 += 2;
-            src_int16 += _nChannels * _samplesPerComplex;
+            src_int16 += fmt.nChannels * _samplesPerComplex;
         }
-    } else if (_bytesPerSample == 1) {
+    } else if (fmt.bytesPerSample == 1) {
         const int8_t *src_int8 = reinterpret_cast<const int8_t*>(src);
 
         for (uint32_t i = 0; i < len; i++) {
-            samples_cf32[0] = static_cast<float>(src_int8[0]) / _samplesScaling; /* I. */
-            samples_cf32[1] = static_cast<float>(src_int8[1]) / _samplesScaling; /* Q. */
+            samples_cf32[0] = static_cast<float>(src_int8[0]) / fmt.samplesScaling; /* I. */
+            samples_cf32[1] = static_cast<float>(src_int8[1]) / fmt.samplesScaling; /* Q. */
             samples_cf32 += 2;
-            src_int8 += _nChannels * _samplesPerComplex;
+            src_int8 += fmt.nChannels * _samplesPerComplex;
         }
     } else {
-        SoapySDR_logf(SOAPY_SDR_ERROR, "Unsupported _bytesPerSample value: %u.", _bytesPerSample);
+        SoapySDR_logf(SOAPY_SDR_ERROR, "Unsupported bytesPerSample value: %u.", fmt.bytesPerSample);
     }
 }
 
 /* Interleave CS16 samples */
 void SoapyLiteXM2SDR::interleaveCS16(
+    const SampleFormat &fmt,
     const void *src,
     void *dst,
     uint32_t len,
     size_t offset) {
     const int16_t *samples_cs16 = reinterpret_cast<const int16_t*>(src) + (offset * _samplesPerComplex);
 
-    if (_bytesPerSample == 2) {
+    if (fmt.bytesPerSample == 2) {
         int16_t *dst_int16 = reinterpret_cast<int16_t*>(dst) + (offset * 2 * _samplesPerComplex);
 
         for (uint32_t i = 0; i < len; i++) {
             dst_int16[0] = samples_cs16[0]; /* I. */
             dst_int16[1] = samples_cs16[1]; /* Q. */
             samples_cs16 += 2;
-            dst_int16 += _nChannels * _samplesPerComplex;
+            dst_int16 += fmt.nChannels * _samplesPerComplex;
         }
-    } else if (_bytesPerSample == 1) {
+    } else if (fmt.bytesPerSample == 1) {
         int8_t *dst_int8 = reinterpret_cast<int8_t*>(dst) + (offset * 2 * _samplesPerComplex);
 
         for (uint32_t i = 0; i < len; i++) {
             dst_int8[0] = samples_cs16[0]; /* I. */
             dst_int8[1] = samples_cs16[1]; /* Q. */
             samples_cs16 += 2;
-            dst_int8 += _nChannels * _samplesPerComplex;
+            dst_int8 += fmt.nChannels * _samplesPerComplex;
         }
     } else {
-        SoapySDR_logf(SOAPY_SDR_ERROR, "Unsupported _bytesPerSample value: %u.", _bytesPerSample);
+        SoapySDR_logf(SOAPY_SDR_ERROR, "Unsupported bytesPerSample value: %u.", fmt.bytesPerSample);
     }
 }
 
 /* Deinterleave CS16 samples */
 void SoapyLiteXM2SDR::deinterleaveCS16(
+    const SampleFormat &fmt,
     const void *src,
     void *dst,
     uint32_t len,
     size_t offset) {
     int16_t *samples_cs16 = reinterpret_cast<int16_t*>(dst) + (offset * _samplesPerComplex);
 
-    if (_bytesPerSample == 2) {
+    if (fmt.bytesPerSample == 2) {
         const int16_t *src_int16 = reinterpret_cast<const int16_t*>(src);
 
         for (uint32_t i = 0; i < len; i++) {
             samples_cs16[0] = src_int16[0]; /* I. */
             samples_cs16[1] = src_int16[1]; /* Q. */
             samples_cs16 += 2;
-            src_int16 += _nChannels * _samplesPerComplex;
+            src_int16 += fmt.nChannels * _samplesPerComplex;
         }
-    } else if (_bytesPerSample == 1) {
+    } else if (fmt.bytesPerSample == 1) {
         const int8_t *src_int8 = reinterpret_cast<const int8_t*>(src);
 
         for (uint32_t i = 0; i < len; i++) {
             samples_cs16[0] = static_cast<int16_t>(src_int8[0]); /* I. */
             samples_cs16[1] = static_cast<int16_t>(src_int8[1]); /* Q. */
             samples_cs16 += 2;
-            src_int8 += _nChannels * _samplesPerComplex;
+            src_int8 += fmt.nChannels * _samplesPerComplex;
         }
     } else {
-        printf("Unsupported _bytesPerSample value: %u\n", _bytesPerSample);
+        printf("Unsupported bytesPerSample value: %u\n", fmt.bytesPerSample);
     }
 }
 
 /* Interleave samples */
 void SoapyLiteXM2SDR::interleave(
+    const SampleFormat &fmt,
     const void *src,
     void *dst,
     uint32_t len,
     const std::string &format,
     size_t offset) {
     if (format == SOAPY_SDR_CF32) {
-        interleaveCF32(src, dst, len, offset);
+        interleaveCF32(fmt, src, dst, len, offset);
     } else if (format == SOAPY_SDR_CS16) {
-        interleaveCS16(src, dst, len, offset);
+        interleaveCS16(fmt, src, dst, len, offset);
     } else {
         SoapySDR_logf(SOAPY_SDR_ERROR, "Unsupported format: %s.", format.c_str());
     }
@@ -698,20 +957,257 @@ void SoapyLiteXM2SDR::interleave(
 
 /* Deinterleave samples */
 void SoapyLiteXM2SDR::deinterleave(
+    const SampleFormat &fmt,
     const void *src,
     void *dst,
     uint32_t len,
     const std::string &format,
     size_t offset) {
     if (format == SOAPY_SDR_CF32) {
-        deinterleaveCF32(src, dst, len, offset);
+        deinterleaveCF32(fmt, src, dst, len, offset);
     } else if (format == SOAPY_SDR_CS16) {
-        deinterleaveCS16(src, dst, len, offset);
+        deinterleaveCS16(fmt, src, dst, len, offset);
     } else {
         SoapySDR_logf(SOAPY_SDR_ERROR, "Unsupported format: %s.", format.c_str());
     }
 }
 
+/*******************************************************************
+ * Scan engine
+ ******************************************************************/
+
+/* The scan engine runs in the reading thread: each readStream call returns samples of one block
+ * (dwell samples captured at one LO, flagged SOAPY_SDR_END_BURST at the end of the block). The
+ * retunes are executed by the control thread (readStream never takes the RFIC lock), readStream
+ * only polls their completion. Sample positions are tracked from the DMA buffer counts: after a
+ * retune completes, the DMA buffer in progress is discarded with the settle samples. The next LO is
+ * tuned as soon as the current block has been captured (before it is read), LOs stored in the
+ * fastlock profiles are recalled. Sample times come from the DMA buffer timestamps (FPGA time
+ * latched by the driver on the DMA MSIs), the reading thread does no CSR access. */
+
+/* Tune a LO of the scan (control thread, skipped when queued before the scan was disabled). */
+void SoapyLiteXM2SDR::scanRetune(const double frequency) {
+    RFICLock lock(this);
+    if (!_scanEnabled)
+        return;
+    auto &hops = _hopFrequencies[SOAPY_SDR_RX];
+    auto it = std::find(hops.begin(), hops.end(), frequency);
+    if (it != hops.end()) {
+        _hopProfile[SOAPY_SDR_RX] = it - hops.begin();
+        ad9361_rx_fastlock_recall(ad9361_phy, _hopProfile[SOAPY_SDR_RX]);
+    } else {
+        _hopProfile[SOAPY_SDR_RX] = -1;
+        ad9361_set_rx_lo_freq(ad9361_phy, static_cast<uint64_t>(frequency));
+    }
+    for (size_t channel = 0; channel < 2; channel++)
+        _cachedFreqValues[SOAPY_SDR_RX][channel]["RF"] = frequency;
+    _rx_stream.frequency = frequency;
+    channel_applied(SOAPY_SDR_RX, -1, RF_FREQUENCY);
+}
+
+#if USE_LITEPCIE
+/* DMA buffers captured (absolute count). */
+int64_t SoapyLiteXM2SDR::scanHwCount(RXStream *rx) {
+    if (rx->shm_client)
+        return __atomic_load_n(&rx->shm_client->shm->hw_count, __ATOMIC_ACQUIRE);
+    litepcie_dma_writer(rx->fd, 1, &rx->hw_count, &rx->sw_count);
+    return rx->hw_count;
+}
+
+/* Request the retune of a LO of the scan to the control thread. */
+void SoapyLiteXM2SDR::scanRequest(const size_t index) {
+    _scan.retune = controlQueue(CONTROL_SCAN_FREQUENCY, SOAPY_SDR_RX, 0, _scan.frequencies[index], 0);
+}
+
+/* Consume the completion of the requested retune (waiting up to timeoutUs) and return the
+ * position of the first settled sample. */
+bool SoapyLiteXM2SDR::scanTuned(RXStream *rx, const int64_t spb, int64_t &start, const long timeoutUs) {
+    if (!_scan.retune.valid() ||
+        _scan.retune.wait_for(std::chrono::microseconds(timeoutUs)) != std::future_status::ready)
+        return false;
+    try {
+        _scan.retune.get();
+    } catch (const std::exception &e) {
+        SoapySDR::logf(SOAPY_SDR_ERROR, "Scan retune failed: %s", e.what());
+    }
+
+    /* The DMA buffer in progress can hold samples of the previous LO: start after it and the
+     * settle samples. */
+    int64_t settle = static_cast<int64_t>(_scan.settle * _rx_stream.samplerate);
+    start = (scanHwCount(rx) + 1) * spb + settle;
+    return true;
+}
+
+/* Hardware Time of the first sample of DMA buffer handle (-1: unknown). buffTime is the time
+ * returned by acquireReadBuffer (-1: none). */
+long long SoapyLiteXM2SDR::scanBufferTime(RXStream *rx, const int64_t handle, const int64_t spb,
+    const long long buffTime) {
+    const double rate = _rx_stream.samplerate;
+
+    /* Remote mode: m2sdr_server publishes the time at the end of each buffer. */
+    if (rx->shm_client)
+        return (buffTime >= 0) ? buffTime - static_cast<long long>(spb * 1e9 / rate) : -1;
+
+    /* DMA header timestamp. */
+    if (buffTime >= 0)
+        return buffTime;
+
+    /* DMA MSI timestamps: anchor on the latest record, period from the oldest one (the record of
+     * count n is latched at the end of buffer n - 1). */
+    struct litepcie_ioctl_dma_timestamps m;
+    m.writer = 1;
+    if (ioctl(rx->fd, LITEPCIE_IOCTL_DMA_TIMESTAMPS, &m) != 0 || m.count == 0)
+        return -1;
+    const struct litepcie_dma_timestamp &oldest = m.ts[0];
+    const struct litepcie_dma_timestamp &latest = m.ts[m.count - 1];
+    if (!oldest.fpga_time || !latest.fpga_time)
+        return -1;
+    double period = spb * 1e9 / rate;
+    if (latest.hw_count > oldest.hw_count)
+        period = static_cast<double>(latest.fpga_time - oldest.fpga_time) /
+            (latest.hw_count - oldest.hw_count);
+    return latest.fpga_time + static_cast<long long>((handle - latest.hw_count) * period);
+}
+
+/* Release the buffer held by the scan engine. */
+void SoapyLiteXM2SDR::scanStop(SoapySDR::Stream *stream) {
+    if (_scan.handle >= 0)
+        this->releaseReadBuffer(stream, _scan.handle);
+    _scan.handle  = -1;
+    _scan.running = false;
+    scanTimestamps(findRXStream(stream), false);
+}
+
+/* Latch the FPGA time on the DMA MSIs while scanning (local mode, ignored by older drivers). */
+void SoapyLiteXM2SDR::scanTimestamps(RXStream *rx, const bool enable) {
+    if (!rx || rx->shm_client)
+        return;
+    struct litepcie_ioctl_dma_timestamps_enable m;
+    m.enable = enable ? 1 : 0;
+    ioctl(rx->fd, LITEPCIE_IOCTL_DMA_TIMESTAMPS_ENABLE, &m);
+}
+#endif
+
+int SoapyLiteXM2SDR::readScan(
+    RXStream *rx,
+    SoapySDR::Stream *stream,
+    void *const *buffs,
+    const size_t numElems,
+    int &flags,
+    long long &timeNs,
+    const long timeoutUs) {
+#if USE_LITEPCIE
+    const int64_t spb  = getStreamMTU(stream);
+    const double  rate = _rx_stream.samplerate;
+    const int64_t dwell = std::max<int64_t>(1, static_cast<int64_t>(_scan.dwell * rate));
+
+    /* Start: release the buffer of the regular reads, tune the first LO. */
+    if (!_scan.running) {
+        if (rx->remainderHandle >= 0) {
+            this->releaseReadBuffer(stream, rx->remainderHandle);
+            rx->remainderHandle = -1;
+            rx->remainderSamps  = 0;
+            rx->remainderOffset = 0;
+        }
+        _scan.running     = true;
+        _scan.index       = 0;
+        _scan.block_tuned = false;
+        _scan.next_tuned  = false;
+        scanTimestamps(rx, true);
+        scanRequest(_scan.index);
+    }
+
+    /* Block of the current LO starts once tuned. */
+    if (!_scan.block_tuned) {
+        if (!scanTuned(rx, spb, _scan.block_start, timeoutUs))
+            return SOAPY_SDR_TIMEOUT;
+        _scan.block_tuned = true;
+        _scan.block_end   = _scan.block_start + dwell;
+        _scan.read_pos    = _scan.block_start;
+    }
+
+    /* Tune the next LO as soon as the current block has been captured. */
+    if (!_scan.next_tuned) {
+        if (_scan.retune.valid())
+            _scan.next_tuned = scanTuned(rx, spb, _scan.next_start, 0);
+        else if (scanHwCount(rx) * spb >= _scan.block_end)
+            scanRequest((_scan.index + 1) % _scan.frequencies.size());
+    }
+
+    /* Next block. */
+    if (_scan.read_pos >= _scan.block_end) {
+        if (!_scan.next_tuned && !scanTuned(rx, spb, _scan.next_start, timeoutUs))
+            return SOAPY_SDR_TIMEOUT;
+        _scan.index       = (_scan.index + 1) % _scan.frequencies.size();
+        _scan.block_start = _scan.next_start;
+        _scan.block_end   = _scan.block_start + dwell;
+        _scan.read_pos    = _scan.block_start;
+        _scan.next_tuned  = false;
+    }
+
+    /* Acquire the DMA buffer holding the read position (discarding the previous ones). */
+    const int64_t b = _scan.read_pos / spb;
+    while (_scan.handle != b) {
+        if (_scan.handle >= 0)
+            this->releaseReadBuffer(stream, _scan.handle);
+        _scan.handle = -1;
+
+        size_t handle;
+        int buff_flags = 0;
+        long long buff_time = 0;
+        int ret = this->acquireReadBuffer(stream, handle, (const void **)&_scan.buff, buff_flags,
+            buff_time, timeoutUs);
+        if (ret < 0 && ret != SOAPY_SDR_OVERFLOW)
+            return ret;
+        if (ret == SOAPY_SDR_OVERFLOW || static_cast<int64_t>(handle) > b) {
+            /* Samples of the block lost: restart the block (same LO, the pending retune of the
+             * next LO if any is superseded). */
+            if (ret != SOAPY_SDR_OVERFLOW)
+                this->releaseReadBuffer(stream, handle);
+            _scan.block_tuned = false;
+            _scan.next_tuned  = false;
+            scanRequest(_scan.index);
+            flags |= SOAPY_SDR_END_ABRUPT;
+            return SOAPY_SDR_OVERFLOW;
+        }
+        _scan.handle    = handle;
+        _scan.buff_time = scanBufferTime(rx, b, spb, (buff_flags & SOAPY_SDR_HAS_TIME) ? buff_time : -1);
+    }
+
+    /* Return the samples of the block in this buffer. */
+    const int64_t offset = _scan.read_pos - b * spb;
+    const size_t n = std::min<int64_t>({static_cast<int64_t>(numElems), _scan.block_end - _scan.read_pos,
+        spb - offset});
+    for (size_t i = 0; i < rx->channels.size(); i++) {
+        const uint32_t chan = rx->channels[i];
+        this->deinterleave(
+            rx->fmt,
+            _scan.buff + (offset * rx->fmt.nChannels + chan) * rx->fmt.bytesPerComplex,
+            buffs[i],
+            n,
+            rx->format,
+            0
+        );
+    }
+
+    /* Hardware Time of the first sample (when the DMA buffer timestamp is available). */
+    if (_scan.buff_time >= 0) {
+        timeNs = _scan.buff_time + static_cast<long long>(offset * 1e9 / rate);
+        flags |= SOAPY_SDR_HAS_TIME;
+    }
+
+    _scanFrequency  = _scan.frequencies[_scan.index];
+    _scan.read_pos += n;
+    if (_scan.read_pos == _scan.block_end)
+        flags |= SOAPY_SDR_END_BURST;
+
+    return n;
+#else
+    (void)rx; (void)stream; (void)buffs; (void)numElems; (void)flags; (void)timeNs; (void)timeoutUs;
+    return SOAPY_SDR_NOT_SUPPORTED;
+#endif
+}
+
 /* Read from the RX stream. */
 int SoapyLiteXM2SDR::readStream(
     SoapySDR::Stream *stream,
@@ -720,42 +1216,54 @@ int SoapyLiteXM2SDR::readStream(
     int &flags,
     long long &timeNs,
     const long timeoutUs) {
-    if (stream != RX_STREAM) {
+    RXStream *rx = findRXStream(stream);
+    if (!rx) {
         return SOAPY_SDR_NOT_SUPPORTED;
     }
 
+    /* Scan engine (RX stream on DMA channel 0). */
+    if (rx == &_rx_stream) {
+        if (_scanEnabled)
+            return readScan(rx, stream, buffs, numElems, flags, timeNs, timeoutUs);
+#if USE_LITEPCIE
+        if (_scan.running)
+            scanStop(stream);
+#endif
+    }
+
     /* Determine the number of samples to return, respecting the MTU. */
     size_t returnedElems = std::min(numElems, this->getStreamMTU(stream));
 
     size_t samp_avail = 0;
 
     /* If there's a remainder buffer from a previous read, process that first. */
-    if (_rx_stream.remainderHandle >= 0) {
-        const size_t n = std::min(_rx_stream.remainderSamps, returnedElems);
-        const uint32_t remainderOffset = _rx_stream.remainderOffset *  _nChannels *_bytesPerComplex;
+    if (rx->remainderHandle >= 0) {
+        const size_t n = std::min(rx->remainderSamps, returnedElems);
+        const uint32_t remainderOffset = rx->remainderOffset * rx->fmt.nChannels * rx->fmt.bytesPerComplex;
 
         if (n < returnedElems) {
             samp_avail = n;
         }
 
         /* Read out channels from the remainder buffer. */
-        for (size_t i = 0; i < _rx_stream.channels.size(); i++) {
-            const uint32_t chan = _rx_stream.channels[i];
+        for (size_t i = 0; i < rx->channels.size(); i++) {
+            const uint32_t chan = rx->channels[i];
             this->deinterleave(
-                _rx_stream.remainderBuff + (remainderOffset + chan * _bytesPerComplex),
+                rx->fmt,
+                rx->remainderBuff + (remainderOffset + chan * rx->fmt.bytesPerComplex),
                 buffs[i],
                 n,
-                _rx_stream.format,
+                rx->format,
                 0
             );
         }
-        _rx_stream.remainderSamps -= n;
-        _rx_stream.remainderOffset += n;
+        rx->remainderSamps -= n;
+        rx->remainderOffset += n;
 
-        if (_rx_stream.remainderSamps == 0) {
-            this->releaseReadBuffer(stream, _rx_stream.remainderHandle);
-            _rx_stream.remainderHandle = -1;
-            _rx_stream.remainderOffset = 0;
+        if (rx->remainderSamps == 0) {
+            this->releaseReadBuffer(stream, rx->remainderHandle);
+            rx->remainderHandle = -1;
+            rx->remainderOffset = 0;
         }
 
         if (n == returnedElems) {
@@ -768,7 +1276,7 @@ int SoapyLiteXM2SDR::readStream(
     int ret = this->acquireReadBuffer(
         stream,
         handle,
-        (const void **)&_rx_stream.remainderBuff,
+        (const void **)&rx->remainderBuff,
         flags,
         timeNs,
         timeoutUs);
@@ -780,29 +1288,30 @@ int SoapyLiteXM2SDR::readStream(
         return ret;
     }
 
-    _rx_stream.remainderHandle = handle;
-    _rx_stream.remainderSamps = ret;
+    rx->remainderHandle = handle;
+    rx->remainderSamps = ret;
 
-    const size_t n = std::min((returnedElems - samp_avail), _rx_stream.remainderSamps);
+    const size_t n = std::min((returnedElems - samp_avail), rx->remainderSamps);
 
     /* Read out channels from the new buffer. */
-    for (size_t i = 0; i < _rx_stream.channels.size(); i++) {
-        const uint32_t chan = _rx_stream.channels[i];
+    for (size_t i = 0; i < rx->channels.size(); i++) {
+        const uint32_t chan = rx->channels[i];
         this->deinterleave(
-            _rx_stream.remainderBuff + (chan * _bytesPerComplex),
+            rx->fmt,
+            rx->remainderBuff + (chan * rx->fmt.bytesPerComplex),
             buffs[i],
             n,
-            _rx_stream.format,
+            rx->format,
             samp_avail
         );
     }
-    _rx_stream.remainderSamps -= n;
-    _rx_stream.remainderOffset += n;
+    rx->remainderSamps -= n;
+    rx->remainderOffset += n;
 
-    if (_rx_stream.remainderSamps == 0) {
-        this->releaseReadBuffer(stream, _rx_stream.remainderHandle);
-        _rx_stream.remainderHandle = -1;
-        _rx_stream.remainderOffset = 0;
+    if (rx->remainderSamps == 0) {
+        this->releaseReadBuffer(stream, rx->remainderHandle);
+        rx->remainderHandle = -1;
+        rx->remainderOffset = 0;
     }
 
     return returnedElems;
@@ -816,7 +1325,8 @@ int SoapyLiteXM2SDR::writeStream(
     int &flags,
     const long long timeNs,
     const long timeoutUs) {
-    if (stream != TX_STREAM) {
+    TXStream *tx = findTXStream(stream);
+    if (!tx) {
         return SOAPY_SDR_NOT_SUPPORTED;
     }
 
@@ -826,31 +1336,32 @@ int SoapyLiteXM2SDR::writeStream(
     size_t samp_avail = 0;
 
     /* If there's a remainder buffer from a previous write, process that first. */
-    if (_tx_stream.remainderHandle >= 0) {
-        const size_t n = std::min(_tx_stream.remainderSamps, returnedElems);
-        const uint32_t remainderOffset = _tx_stream.remainderOffset * _nChannels * _bytesPerComplex;
+    if (tx->remainderHandle >= 0) {
+        const size_t n = std::min(tx->remainderSamps, returnedElems);
+        const uint32_t remainderOffset = tx->remainderOffset * tx->fmt.nChannels * tx->fmt.bytesPerComplex;
 
         if (n < returnedElems) {
             samp_avail = n;
         }
 
         /* Write out channels to the remainder buffer. */
-        for (size_t i = 0; i < _tx_stream.channels.size(); i++) {
+        for (size_t i = 0; i < tx->channels.size(); i++) {
             this->interleave(
+                tx->fmt,
                 buffs[i],
-                _tx_stream.remainderBuff + remainderOffset + (_tx_stream.channels[i] * _bytesPerComplex),
+                tx->remainderBuff + remainderOffset + (tx->channels[i] * tx->fmt.bytesPerComplex),
                 n,
-                _tx_stream.format,
+                tx->format,
                 0
             );
         }
-        _tx_stream.remainderSamps -= n;
-        _tx_stream.remainderOffset += n;
+        tx->remainderSamps -= n;
+        tx->remainderOffset += n;
 
-        if (_tx_stream.remainderSamps == 0) {
-            this->releaseWriteBuffer(stream, _tx_stream.remainderHandle, _tx_stream.remainderOffset, flags, timeNs);
-            _tx_stream.remainderHandle = -1;
-            _tx_stream.remainderOffset = 0;
+        if (tx->remainderSamps == 0) {
+            this->releaseWriteBuffer(stream, tx->remainderHandle, tx->remainderOffset, flags, timeNs);
+            tx->remainderHandle = -1;
+            tx->remainderOffset = 0;
         }
 
         if (n == returnedElems) {
@@ -864,7 +1375,7 @@ int SoapyLiteXM2SDR::writeStream(
     int ret = this->acquireWriteBuffer(
         stream,
         handle,
-        (void **)&_tx_stream.remainderBuff,
+        (void **)&tx->remainderBuff,
         timeoutUs);
     if (ret < 0) {
         if ((ret == SOAPY_SDR_TIMEOUT) && (samp_avail > 0)) {
@@ -873,28 +1384,29 @@ int SoapyLiteXM2SDR::writeStream(
         return ret;
     }
 
-    _tx_stream.remainderHandle = handle;
-    _tx_stream.remainderSamps = ret;
+    tx->remainderHandle = handle;
+    tx->remainderSamps = ret;
 
-    const size_t n = std::min((returnedElems - samp_avail), _tx_stream.remainderSamps);
+    const size_t n = std::min((returnedElems - samp_avail), tx->remainderSamps);
 
     /* Write out channels to the new buffer. */
-    for (size_t i = 0; i < _tx_stream.channels.size(); i++) {
+    for (size_t i = 0; i < tx->channels.size(); i++) {
         this->interleave(
+            tx->fmt,
             buffs[i],
-            _tx_stream.remainderBuff + (_tx_stream.channels[i] * _bytesPerComplex),
+            tx->remainderBuff + (tx->channels[i] * tx->fmt.bytesPerComplex),
             n,
-            _tx_stream.format,
+            tx->format,
             samp_avail
         );
     }
-    _tx_stream.remainderSamps -= n;
-    _tx_stream.remainderOffset += n;
+    tx->remainderSamps -= n;
+    tx->remainderOffset += n;
 
-    if (_tx_stream.remainderSamps == 0) {
-        this->releaseWriteBuffer(stream, _tx_stream.remainderHandle, _tx_stream.remainderOffset, flags, timeNs);
-        _tx_stream.remainderHandle = -1;
-        _tx_stream.remainderOffset = 0;
+    if (tx->remainderSamps == 0) {
+        this->releaseWriteBuffer(stream, tx->remainderHandle, tx->remainderOffset, flags, timeNs);
+        tx->remainderHandle = -1;
+        tx->remainderOffset = 0;
     }
 
     return returnedElems;
@@ -909,7 +1421,8 @@ int SoapyLiteXM2SDR::readStreamStatus(
     const long timeoutUs){
 
     /* For now we only suport TX stream. */
-    if(stream != TX_STREAM){
+    TXStream *tx = findTXStream(stream);
+    if(!tx){
         return SOAPY_SDR_NOT_SUPPORTED;
     }
 
@@ -919,8 +1432,8 @@ int SoapyLiteXM2SDR::readStreamStatus(
 
     /* Poll for status events until the timeout expires. */
     while (true) {
-        if(_tx_stream.underflow){
-            _tx_stream.underflow=false;
+        if(tx->underflow){
+            tx->underflow=false;
             SoapySDR::log(SOAPY_SDR_SSI, "U");
             return SOAPY_SDR_UNDERFLOW;
         }
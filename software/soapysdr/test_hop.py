@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+
+#
+# This file is part of LiteX-M2SDR.
+#
+# Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+# SPDX-License-Identifier: BSD-2-Clause
+
+"""
+test_hop.py - Compare fastlock hops and regular retunes using the LiteXM2SDR SoapySDR driver.
+
+This script stores a list of frequencies in the AD9361 fastlock profiles, then measures the
+duration of the hops between them and of regular retunes (setFrequency) on the same frequencies.
+With --timed, hops are scheduled at Hardware Time instants (setCommandTime) and the script reports
+the lateness of each hop.
+
+Usage Example:
+    ./test_hop.py --freq 2.41e9 --step 5e6 --hops 8 --count 100 --timed
+"""
+
+import time
+import argparse
+import numpy as np
+
+import SoapySDR
+from SoapySDR import SOAPY_SDR_RX
+
+# Main ---------------------------------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(
+        description     = "Compare fastlock hops and regular retunes using the LiteXM2SDR SoapySDR driver.",
+        formatter_class = argparse.ArgumentDefaultsHelpFormatter,
+    )
+    # RF configuration options.
+    parser.add_argument("--freq",   type=float, default=2.41e9, help="RX first hop frequency in Hz")
+    parser.add_argument("--step",   type=float, default=5e6,    help="RX hop frequency step in Hz")
+    parser.add_argument("--hops",   type=int,   default=8,      help="Number of hop frequencies (max 8)")
+
+    # Additional options.
+    parser.add_argument("--count",  type=int,   default=100,    help="Number of hops/retunes")
+    parser.add_argument("--timed",  action="store_true",        help="Schedule the hops at Hardware Time instants")
+    parser.add_argument("--period", type=float, default=1e-3,   help="Timed hops period in seconds")
+
+    args = parser.parse_args()
+
+    # Open the LiteXM2SDR device using the SoapySDR driver.
+    sdr = SoapySDR.Device({"driver": "LiteXM2SDR"})
+
+    # Store the hop frequencies.
+    freqs = [args.freq + i * args.step for i in range(args.hops)]
+    sdr.writeSetting(SOAPY_SDR_RX, 0, "HOP_FREQUENCIES", ",".join(f"{f:.0f}" for f in freqs))
+    print(f"Hop frequencies: {sdr.readSetting(SOAPY_SDR_RX, 0, 'HOP_FREQUENCIES')}")
+
+    # Regular retunes.
+    retunes = []
+    for n in range(args.count):
+        t0 = time.perf_counter()
+        sdr.setFrequency(SOAPY_SDR_RX, 0, freqs[n % args.hops])
+        retunes.append(time.perf_counter() - t0)
+
+    # Fastlock hops.
+    hops = []
+    late = []
+    if args.timed:
+        t_hop = sdr.getHardwareTime() + int(100e-3 * 1e9)
+    for n in range(args.count):
+        if args.timed:
+            t_hop += int(args.period * 1e9)
+            sdr.setCommandTime(t_hop)
+        t0 = time.perf_counter()
+        sdr.writeSetting(SOAPY_SDR_RX, 0, "HOP", str(n % args.hops))
+        hops.append(time.perf_counter() - t0)
+        if args.timed:
+            late.append(sdr.getHardwareTime() - t_hop)
+    sdr.setCommandTime(0)
+
+    # Results.
+    print(f"Retunes:         avg {np.mean(retunes)*1e3:.3f} ms, max {np.max(retunes)*1e3:.3f} ms")
+    if args.timed:
+        print(f"Hop lateness:    avg {np.mean(late)/1e3:.1f} us, max {np.max(late)/1e3:.1f} us")
+    else:
+        print(f"Hops:            avg {np.mean(hops)*1e3:.3f} ms, max {np.max(hops)*1e3:.3f} ms")
+    print(f"Current profile: {sdr.readSetting(SOAPY_SDR_RX, 0, 'HOP')}")
+
+if __name__ == "__main__":
+    main()
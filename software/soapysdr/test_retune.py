@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+
+#
+# This file is part of LiteX-M2SDR.
+#
+# Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+# SPDX-License-Identifier: BSD-2-Clause
+
+"""
+test_retune.py - Measure RX streaming stalls while retuning using the LiteXM2SDR SoapySDR driver.
+
+This script receives I/Q samples in a streaming thread while a control thread retunes the RX
+frequency (and optionally the RX gain) in a loop. It reports the retune durations and the max gap
+between two consecutive readStream returns (streaming-thread stall), which should stay in the
+range of a DMA buffer duration whatever the retune duration. With --async, the retunes are queued
+to the driver control thread and the reported durations are those of the non-blocking calls.
+
+Usage Example:
+    ./test_retune.py --samplerate 4e6 --freq 2.4e9 --step 10e6 --steps 10 --gain --secs 10
+"""
+
+import time
+import argparse
+import threading
+import numpy as np
+
+import SoapySDR
+from SoapySDR import SOAPY_SDR_RX, SOAPY_SDR_CF32, SOAPY_SDR_TIMEOUT, SOAPY_SDR_OVERFLOW
+
+# Constants ----------------------------------------------------------------------------------------
+
+DMA_BUFFER_SIZE   = 8192
+PPS_STARTUP_DELAY = 1.0  # Allow up to 1 second for the internal PPS delay before streaming starts
+
+# Streaming Thread ---------------------------------------------------------------------------------
+
+class StreamStats:
+    def __init__(self):
+        self.samples   = 0
+        self.overflows = 0
+        self.max_gap   = 0.0
+        self.gaps      = []
+
+def stream_thread(sdr, rx_stream, stats, stop):
+    buf  = np.empty(DMA_BUFFER_SIZE // 4, dtype=np.complex64)
+    last = None
+    while not stop.is_set():
+        sr  = sdr.readStream(rx_stream, [buf], len(buf), timeoutUs=100000)
+        now = time.perf_counter()
+        if sr.ret == SOAPY_SDR_TIMEOUT:
+            continue
+        if sr.ret == SOAPY_SDR_OVERFLOW:
+            stats.overflows += 1
+            continue
+        if sr.ret < 0:
+            continue
+        stats.samples += sr.ret
+        if last is not None:
+            gap = now - last
+            stats.gaps.append(gap)
+            stats.max_gap = max(stats.max_gap, gap)
+        last = now
+
+# Main ---------------------------------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(
+        description     = "Measure RX streaming stalls while retuning using the LiteXM2SDR SoapySDR driver.",
+        formatter_class = argparse.ArgumentDefaultsHelpFormatter,
+    )
+    # RF configuration options.
+    parser.add_argument("--samplerate", type=float, default=4e6,    help="RX Sample rate in Hz")
+    parser.add_argument("--freq",       type=float, default=2.4e9,  help="RX start frequency in Hz")
+    parser.add_argument("--step",       type=float, default=10e6,   help="RX frequency step in Hz")
+    parser.add_argument("--steps",      type=int,   default=10,     help="Number of frequency steps")
+    parser.add_argument("--gain",       action="store_true",        help="Also change the RX gain on each retune")
+    parser.add_argument("--async",      action="store_true",        help="Use the asynchronous (non-blocking) retune/gain settings", dest="use_async")
+    parser.add_argument("--channel",    type=int,   choices=[0, 1], default=0, help="RX channel index (0 or 1)")
+
+    # Additional options.
+    parser.add_argument("--secs",       type=float, default=10.0,   help="Test duration in seconds")
+
+    args = parser.parse_args()
+
+    # Open the LiteXM2SDR device using the SoapySDR driver.
+    sdr = SoapySDR.Device({"driver": "LiteXM2SDR"})
+
+    # Basic RF configuration using the selected channel.
+    sdr.setSampleRate(SOAPY_SDR_RX, args.channel, args.samplerate)
+    sdr.setFrequency( SOAPY_SDR_RX, args.channel, args.freq)
+
+    # Create and activate RX stream on the specified channel.
+    rx_stream = sdr.setupStream(SOAPY_SDR_RX, SOAPY_SDR_CF32, [args.channel])
+    sdr.activateStream(rx_stream)
+    time.sleep(PPS_STARTUP_DELAY)
+
+    # Start streaming thread.
+    stats  = StreamStats()
+    stop   = threading.Event()
+    thread = threading.Thread(target=stream_thread, args=(sdr, rx_stream, stats, stop))
+    thread.start()
+
+    # Retune in a loop from the control thread.
+    print(f"Retuning for {args.secs} seconds ({args.steps} steps of {args.step/1e6:.3f} MHz)...")
+    retunes   = []
+    t_start   = time.time()
+    n         = 0
+    while time.time() - t_start < args.secs:
+        freq = args.freq + (n % args.steps) * args.step
+        t0 = time.perf_counter()
+        if args.use_async:
+            sdr.writeSetting(SOAPY_SDR_RX, args.channel, "ASYNC_FREQUENCY", str(freq))
+            if args.gain:
+                sdr.writeSetting(SOAPY_SDR_RX, args.channel, "ASYNC_GAIN", str((n % 2) * 20.0))
+        else:
+            sdr.setFrequency(SOAPY_SDR_RX, args.channel, freq)
+            if args.gain:
+                sdr.setGain(SOAPY_SDR_RX, args.channel, (n % 2) * 20.0)
+        retunes.append(time.perf_counter() - t0)
+        n += 1
+        if args.use_async:
+            time.sleep(1e-3)
+
+    # Stop streaming thread.
+    stop.set()
+    thread.join()
+    sdr.deactivateStream(rx_stream)
+    sdr.closeStream(rx_stream)
+
+    # Results.
+    buffer_duration = (DMA_BUFFER_SIZE // 4) / args.samplerate
+    print(f"Retunes:         {len(retunes)} (avg {np.mean(retunes)*1e3:.3f} ms, max {np.max(retunes)*1e3:.3f} ms)")
+    print(f"Samples:         {stats.samples} ({stats.overflows} overflows)")
+    if stats.gaps:
+        print(f"Read gap:        avg {np.mean(stats.gaps)*1e3:.3f} ms, p99 {np.percentile(stats.gaps, 99)*1e3:.3f} ms")
+    print(f"Max stall:       {stats.max_gap*1e3:.3f} ms (buffer duration: {buffer_duration*1e3:.3f} ms)")
+
+if __name__ == "__main__":
+    main()
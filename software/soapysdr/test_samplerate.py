@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+
+#
+# This file is part of LiteX-M2SDR.
+#
+# Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+# SPDX-License-Identifier: BSD-2-Clause
+
+"""
+test_samplerate.py - Measure sample rate switch times using the LiteXM2SDR SoapySDR driver.
+
+This script alternates between a list of sample rates (RX and TX) and reports the switch times for
+each rate: the first switch to a rate computes the clock chain and runs the calibrations, the next
+ones can be served by the rate cache (rate_cache=1 device arg). With --rate-cache, the script fails
+when the repeated switches to a rate are not faster than the first one.
+
+Usage Example:
+    ./test_samplerate.py --rates 30.72e6,61.44e6 --count 20 --rate-cache
+"""
+
+import sys
+import time
+import argparse
+import numpy as np
+
+import SoapySDR
+from SoapySDR import SOAPY_SDR_RX, SOAPY_SDR_TX
+
+# Main ---------------------------------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(
+        description     = "Measure sample rate switch times using the LiteXM2SDR SoapySDR driver.",
+        formatter_class = argparse.ArgumentDefaultsHelpFormatter,
+    )
+    parser.add_argument("--rates",      type=str, default="30.72e6,61.44e6", help="Comma separated sample rates in Hz")
+    parser.add_argument("--count",      type=int, default=20,                help="Number of switches per rate")
+    parser.add_argument("--rate-cache", action="store_true",                 help="Enable the driver rate cache")
+    args = parser.parse_args()
+
+    rates = [float(r) for r in args.rates.split(",")]
+    if args.count < 2:
+        parser.error("--count must be at least 2")
+
+    # Open the LiteXM2SDR device using the SoapySDR driver.
+    sdr = SoapySDR.Device({"driver": "LiteXM2SDR", "rate_cache": "1" if args.rate_cache else "0"})
+
+    # Alternate between the rates.
+    switches = {rate: [] for rate in rates}
+    for n in range(args.count * len(rates)):
+        rate = rates[n % len(rates)]
+        t0 = time.perf_counter()
+        sdr.setSampleRate(SOAPY_SDR_RX, 0, rate)
+        sdr.setSampleRate(SOAPY_SDR_TX, 0, rate)
+        switches[rate].append(time.perf_counter() - t0)
+
+    # Results.
+    failed = False
+    for rate, durations in switches.items():
+        print(f"{rate/1e6:8.3f} Msps: first {durations[0]*1e3:8.3f} ms, "
+              f"next avg {np.mean(durations[1:])*1e3:8.3f} ms, max {np.max(durations[1:])*1e3:8.3f} ms")
+        # Rate cache hits must be faster than the first (cold) switch.
+        if args.rate_cache and np.mean(durations[1:]) >= durations[0]:
+            print(f"{rate/1e6:8.3f} Msps: FAIL, repeated switches not faster than the first one")
+            failed = True
+    if failed:
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+
+#
+# This file is part of LiteX-M2SDR.
+#
+# Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+# SPDX-License-Identifier: BSD-2-Clause
+
+"""
+test_scan.py - Scan a list of LO frequencies using the LiteXM2SDR SoapySDR driver scan engine.
+
+This script configures the driver scan engine (LO list, dwell and settle durations), reads the
+scan blocks from the RX stream and prints the power of each block with its LO and Hardware Time.
+
+Usage Example:
+    ./test_scan.py --samplerate 30.72e6 --start 2.40e9 --stop 2.48e9 --step 20e6 --dwell 1e-3 --sweeps 4
+"""
+
+import argparse
+import numpy as np
+
+import SoapySDR
+from SoapySDR import SOAPY_SDR_RX, SOAPY_SDR_CF32, SOAPY_SDR_TIMEOUT, SOAPY_SDR_OVERFLOW
+from SoapySDR import SOAPY_SDR_END_BURST, SOAPY_SDR_HAS_TIME
+
+# Main ---------------------------------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(
+        description     = "Scan a list of LO frequencies using the LiteXM2SDR SoapySDR driver scan engine.",
+        formatter_class = argparse.ArgumentDefaultsHelpFormatter,
+    )
+    # RF configuration options.
+    parser.add_argument("--samplerate", type=float, default=30.72e6, help="RX Sample rate in Hz")
+    parser.add_argument("--start",      type=float, default=2.40e9,  help="First LO frequency in Hz")
+    parser.add_argument("--stop",       type=float, default=2.48e9,  help="Last LO frequency in Hz")
+    parser.add_argument("--step",       type=float, default=20e6,    help="LO frequency step in Hz")
+    parser.add_argument("--gain",       type=float, default=20.0,    help="RX gain in dB")
+
+    # Scan options.
+    parser.add_argument("--dwell",      type=float, default=1e-3,    help="Dwell time per LO in seconds")
+    parser.add_argument("--settle",     type=float, default=100e-6,  help="Settle time after a retune in seconds")
+    parser.add_argument("--sweeps",     type=int,   default=4,       help="Number of sweeps")
+
+    args = parser.parse_args()
+
+    # Open the LiteXM2SDR device using the SoapySDR driver.
+    sdr = SoapySDR.Device({"driver": "LiteXM2SDR"})
+    sdr.setSampleRate(SOAPY_SDR_RX, 0, args.samplerate)
+    sdr.setGain(SOAPY_SDR_RX, 0, args.gain)
+
+    # Configure the scan engine.
+    freqs = np.arange(args.start, args.stop + args.step/2, args.step)
+    sdr.writeSetting(SOAPY_SDR_RX, 0, "SCAN_FREQUENCIES", ",".join(f"{f:.0f}" for f in freqs))
+    sdr.writeSetting(SOAPY_SDR_RX, 0, "SCAN_DWELL",       str(args.dwell))
+    sdr.writeSetting(SOAPY_SDR_RX, 0, "SCAN_SETTLE",      str(args.settle))
+    sdr.writeSetting(SOAPY_SDR_RX, 0, "SCAN",             "true")
+
+    rx_stream = sdr.setupStream(SOAPY_SDR_RX, SOAPY_SDR_CF32, [0])
+    sdr.activateStream(rx_stream)
+
+    # Read the scan blocks.
+    mtu    = sdr.getStreamMTU(rx_stream)
+    buf    = np.empty(mtu, dtype=np.complex64)
+    block  = []
+    t0     = None
+    blocks = 0
+    while blocks < args.sweeps * len(freqs):
+        sr = sdr.readStream(rx_stream, [buf], len(buf), timeoutUs=1000000)
+        if sr.ret == SOAPY_SDR_TIMEOUT:
+            continue
+        if sr.ret == SOAPY_SDR_OVERFLOW:
+            print("Overflow (block restarted)")
+            block, t0 = [], None
+            continue
+        if sr.ret < 0:
+            raise RuntimeError(f"readStream failed: {sr.ret}")
+        if t0 is None and (sr.flags & SOAPY_SDR_HAS_TIME):
+            t0 = sr.timeNs
+        block.append(buf[:sr.ret].copy())
+        if sr.flags & SOAPY_SDR_END_BURST:
+            samples = np.concatenate(block)
+            lo      = float(sdr.readSetting(SOAPY_SDR_RX, 0, "SCAN_FREQUENCY"))
+            power   = 10 * np.log10(np.mean(np.abs(samples)**2) + 1e-20)
+            time    = f"{t0/1e9:14.6f} s" if t0 is not None else "           n/a  "
+            print(f"LO {lo/1e6:10.3f} MHz, time {time}, {len(samples):7d} samples, {power:7.2f} dBFS")
+            block, t0 = [], None
+            blocks += 1
+
+    # Stop the scan.
+    sdr.deactivateStream(rx_stream)
+    sdr.closeStream(rx_stream)
+    sdr.writeSetting(SOAPY_SDR_RX, 0, "SCAN", "false")
+
+if __name__ == "__main__":
+    main()
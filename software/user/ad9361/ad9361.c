@@ -49,6 +49,7 @@
 #include "platform.h"
 #include "util.h"
 #include "config.h"
+#include "csr.h"
 
 #define diff_abs(x, y) ((x) > (y) ? (x - y) : (y - x))
 
@@ -684,7 +685,165 @@ const char *ad9361_ensm_states[] = {
 	"rx", "rx_flush", "fdd", "fdd_flush"
 };
 
-//#define USE_MBYTE_SPI
+/* Multi-byte SPI transfers (bursts of up to MAX_MBYTE_SPI registers, see m2sdr_ad9361_spi): only
+ * with gateware exposing the wide (80-bit) SPI core, single-register transfers otherwise. */
+#if defined(CSR_AD9361_SPI_MOSI_SIZE) && (CSR_AD9361_SPI_MOSI_SIZE > 1)
+#define USE_MBYTE_SPI
+#endif
+
+/* Write-through cache of the static/config registers: redundant reads are served from memory and
+ * writes of an unchanged value are skipped. The AD9361 is shared with the other processes (m2sdr_rf,
+ * m2sdr_util, SoapySDR...) so the cache is only used within a scope (one API call, see
+ * ad9361_spi_cache_begin/end) and invalidated when leaving it. */
+#define AD9361_SPI_CACHE
+
+/* Cacheable register ranges: only registers written by the driver and never updated by the chip.
+ * Status, calibration, RSSI, temperature, ENSM, table access/strobe registers, the synthesizers
+ * frequency words/VCO calibration and the data/clock delays (also written directly by m2sdr_rf)
+ * are always accessed over SPI. */
+static const uint16_t ad9361_spi_cache_ranges[][2] = {
+	{REG_TX_ENABLE_FILTER_CTRL,  REG_RFPLL_DIVIDERS},
+	{REG_CLOCK_ENABLE,           REG_BBPLL},
+	{REG_PARALLEL_PORT_CONF_1,   REG_PARALLEL_PORT_CONF_3},
+	{REG_DIGITAL_IO_CTRL,        REG_LVDS_INVERT_CTRL2},
+	{REG_FRACT_BB_FREQ_WORD_1,   REG_VCO_PROGRAM_2},
+	{REG_AGC_CONFIG_1,           REG_FAST_INCREMENT_TIME},
+	{REG_RX_PFD_CONFIG,          REG_RX_PFD_CONFIG},
+	{REG_RX_FORCE_ALC,           REG_RX_FORCE_ALC},
+	{REG_RX_VCO_OUTPUT,          REG_RX_CP_OFFSET},
+	{REG_RX_LOOP_FILTER_1,       REG_RX_LOOP_FILTER_3},
+	{REG_RX_VCO_BIAS_1,          REG_RX_VCO_BIAS_1 + 1},
+	{REG_RX_VCO_CAL_REF,         REG_RX_VCO_PD_OVERRIDES},
+	{REG_RX_VCO_LDO,             REG_RX_VCO_LDO},
+	{REG_RX_LOCK_DETECT_CONFIG,  REG_RX_LOCK_DETECT_CONFIG},
+	{REG_RX_DSM_SETUP_0,         REG_RX_DSM_SETUP_1},
+	{REG_RX_VCO_VARACTOR_CTRL_0, REG_RX_VCO_VARACTOR_CTRL_1},
+	{REG_TX_PFD_CONFIG,          REG_TX_PFD_CONFIG},
+	{REG_TX_FORCE_ALC,           REG_TX_FORCE_ALC},
+	{REG_TX_VCO_OUTPUT,          REG_TX_CP_OFFSET},
+	{REG_TX_LOOP_FILTER_1,       REG_TX_LOOP_FILTER_3},
+	{REG_TX_VCO_BIAS_1,          REG_TX_VCO_BIAS_2},
+	{REG_TX_VCO_CAL_REF,         REG_TX_VCO_PD_OVERRIDES},
+	{REG_TX_VCO_LDO,             REG_TX_VCO_LDO},
+	{REG_TX_LOCK_DETECT_CONFIG,  REG_TX_LOCK_DETECT_CONFIG},
+	{REG_TX_DSM_SETUP_0,         REG_TX_DSM_SETUP_1},
+	{REG_TX_VCO_VARACTOR_CTRL_0, REG_TX_VCO_VARACTOR_CTRL_1},
+};
+
+/**
+ * Check if a register can be served from the SPI register cache (static
+ * configuration register, also restored from the state snapshots).
+ * @param reg The register address.
+ * @return true if the register is cacheable.
+ */
+bool ad9361_spi_cacheable(uint32_t reg)
+{
+	uint32_t i;
+
+	for (i = 0; i < ARRAY_SIZE(ad9361_spi_cache_ranges); i++)
+		if (reg >= ad9361_spi_cache_ranges[i][0] &&
+		    reg <= ad9361_spi_cache_ranges[i][1])
+			return true;
+
+	return false;
+}
+
+#ifdef AD9361_SPI_CACHE
+
+/**
+ * Get registers from the SPI register cache (registers are accessed with
+ * decrementing addresses, as the SPI bursts).
+ * @param spi
+ * @param reg The first register address.
+ * @param buf The data buffer.
+ * @param num The number of registers.
+ * @return true if all the registers were found in the cache.
+ */
+static bool ad9361_spi_cache_get(struct spi_device *spi, uint32_t reg,
+				 uint8_t *buf, uint32_t num)
+{
+	uint32_t i, r;
+
+	if (!spi->cache_scope)
+		return false;
+
+	for (i = 0; i < num; i++) {
+		r = (reg - i) & 0x3FF;
+		if (!ad9361_spi_cacheable(r) ||
+		    !(spi->cache_valid[r / 8] & BIT(r % 8)))
+			return false;
+	}
+	for (i = 0; i < num; i++)
+		buf[i] = spi->cache[(reg - i) & 0x3FF];
+
+	return true;
+}
+
+/**
+ * Update the SPI register cache with registers read from/written to the device.
+ * @param spi
+ * @param reg The first register address.
+ * @param buf The data buffer.
+ * @param num The number of registers.
+ */
+static void ad9361_spi_cache_set(struct spi_device *spi, uint32_t reg,
+				 const uint8_t *buf, uint32_t num)
+{
+	uint32_t i, r;
+
+	if (!spi->cache_scope)
+		return;
+
+	for (i = 0; i < num; i++) {
+		r = (reg - i) & 0x3FF;
+		if (!ad9361_spi_cacheable(r))
+			continue;
+		spi->cache[r] = buf[i];
+		spi->cache_valid[r / 8] |= BIT(r % 8);
+	}
+}
+#endif
+
+/**
+ * Invalidate the SPI register cache (device reset).
+ * @param spi
+ */
+void ad9361_spi_cache_invalidate(struct spi_device *spi)
+{
+	memset(spi->cache_valid, 0, sizeof(spi->cache_valid));
+}
+
+/**
+ * Enter a SPI register cache scope: the cache is used until the matching
+ * ad9361_spi_cache_end (scopes can be nested).
+ * @param spi
+ */
+void ad9361_spi_cache_begin(struct spi_device *spi)
+{
+	spi->cache_scope++;
+}
+
+/**
+ * Leave a SPI register cache scope, the cache is invalidated when leaving the
+ * outermost one (the registers can be changed by another process afterwards).
+ * @param spi
+ */
+void ad9361_spi_cache_end(struct spi_device *spi)
+{
+	if (spi->cache_scope && !--spi->cache_scope)
+		ad9361_spi_cache_invalidate(spi);
+}
+
+/**
+ * Get the SPI access statistics (registers accesses requested by the driver,
+ * served from the cache and skipped, SPI transfers issued).
+ * @param spi
+ * @param stats The statistics.
+ */
+void ad9361_spi_get_stats(struct spi_device *spi, struct ad9361_spi_stats *stats)
+{
+	*stats = spi->stats;
+}
 
 /**
  * SPI multiple bytes register read.
@@ -695,7 +854,7 @@ const char *ad9361_ensm_states[] = {
  * @return 0 in case of success, negative error code otherwise.
  */
 #ifdef USE_MBYTE_SPI
-static int32_t ad9361_spi_readm(struct spi_device *spi, uint32_t reg,
+int32_t ad9361_spi_readm(struct spi_device *spi, uint32_t reg,
 	uint8_t *rbuf, uint32_t num)
 {
 	uint8_t buf[2];
@@ -705,15 +864,27 @@ static int32_t ad9361_spi_readm(struct spi_device *spi, uint32_t reg,
 	if (num > MAX_MBYTE_SPI)
 		return -EINVAL;
 
+	spi->stats.reads += num;
+#ifdef AD9361_SPI_CACHE
+	if (ad9361_spi_cache_get(spi, reg, rbuf, num)) {
+		spi->stats.reads_cached += num;
+		return 0;
+	}
+#endif
+
 	cmd = AD_READ | AD_CNT(num) | AD_ADDR(reg);
 	buf[0] = cmd >> 8;
 	buf[1] = cmd & 0xFF;
 
+	spi->stats.transfers++;
 	ret = spi_write_then_read(spi, &buf[0], 2, rbuf, num);
 	if (ret < 0) {
 		dev_err(&spi->dev, "Read Error %"PRId32, ret);
 		return ret;
 	}
+#ifdef AD9361_SPI_CACHE
+	ad9361_spi_cache_set(spi, reg, rbuf, num);
+#endif
 #ifdef _DEBUG
 	{
 		int32_t i;
@@ -751,16 +922,28 @@ int32_t ad9361_spi_read(struct spi_device *spi, uint32_t reg)
     uint8_t buf[2], rbuf[1];
     int32_t ret;
     uint16_t cmd;
+
+    spi->stats.reads++;
+#ifdef AD9361_SPI_CACHE
+    if (ad9361_spi_cache_get(spi, reg, rbuf, 1)) {
+        spi->stats.reads_cached++;
+        return rbuf[0];
+    }
+#endif
     
     cmd = AD_READ | AD_CNT(1) | AD_ADDR(reg);
     buf[0] = cmd >> 8;
     buf[1] = cmd & 0xFF;
     
+    spi->stats.transfers++;
     ret = spi_write_then_read(spi, &buf[0], 2, rbuf, 1);
     if (ret < 0) {
         dev_err(&spi->dev, "Read Error %d", ret);
         return ret;
     }
+#ifdef AD9361_SPI_CACHE
+    ad9361_spi_cache_set(spi, reg, rbuf, 1);
+#endif
     return rbuf[0];
 }
 
@@ -837,11 +1020,28 @@ int32_t ad9361_spi_write(struct spi_device *spi,
 	buf[1] = cmd & 0xFF;
 	buf[2] = val;
 
+	spi->stats.writes++;
+#ifdef AD9361_SPI_CACHE
+	{
+		uint8_t cached;
+		if (ad9361_spi_cache_get(spi, reg, &cached, 1) && (cached == buf[2])) {
+			spi->stats.writes_elided++;
+			return 0;
+		}
+	}
+#endif
+
+	spi->stats.transfers++;
 	ret = spi_write_then_read(spi, buf, 3, NULL, 0);
 	if (ret < 0) {
 		dev_err(&spi->dev, "Write Error %"PRId32, ret);
 		return ret;
 	}
+#ifdef AD9361_SPI_CACHE
+	ad9361_spi_cache_set(spi, reg, &buf[2], 1);
+	if ((reg == REG_SPI_CONF) && (val & SOFT_RESET))
+		ad9361_spi_cache_invalidate(spi);
+#endif
 
 #ifdef _DEBUG
 	dev_dbg(&spi->dev, "%s: reg 0x%"PRIX32" val 0x%X", __func__, reg, buf[2]);
@@ -919,11 +1119,26 @@ static int32_t ad9361_spi_writem(struct spi_device *spi,
 	for (i = 0; i < num; i++)
 		buf[2 + i] =  tbuf[i];
 #endif
+	spi->stats.writes += num;
+#ifdef AD9361_SPI_CACHE
+	{
+		uint8_t cached[MAX_MBYTE_SPI];
+		if (ad9361_spi_cache_get(spi, reg, cached, num) &&
+		    !memcmp(cached, &buf[2], num)) {
+			spi->stats.writes_elided += num;
+			return 0;
+		}
+	}
+#endif
+	spi->stats.transfers++;
 	ret = spi_write_then_read(spi, buf, num + 2, NULL, 0);
 	if (ret < 0) {
 		dev_err(&spi->dev, "Write Error %"PRId32, ret);
 		return ret;
 	}
+#ifdef AD9361_SPI_CACHE
+	ad9361_spi_cache_set(spi, reg, &buf[2], num);
+#endif
 
 #ifdef _DEBUG
 	{
@@ -1058,6 +1273,8 @@ int32_t ad9361_1rx1tx_channel_map(struct ad9361_rf_phy *phy, bool tx,
  */
 int32_t ad9361_reset(struct ad9361_rf_phy *phy)
 {
+	ad9361_spi_cache_invalidate(phy->spi);
+
 	if (gpio_is_valid(phy->pdata->gpio_resetb)) {
 		gpio_set_value(phy->pdata->gpio_resetb, 0);
 		mdelay(1);
@@ -1462,6 +1679,7 @@ static int32_t ad9361_load_gt(struct ad9361_rf_phy *phy, uint64_t freq,
 	uint8_t (*tab)[3];
 	uint32_t band, index_max, i, lna, lpf_tia_mask, set_gain;
 	int32_t ret, rx1_gain, rx2_gain;
+	uint8_t buf[4];
 
 	dev_dbg(&phy->spi->dev, "%s: frequency %"PRIu64, __func__, freq);
 
@@ -1522,13 +1740,12 @@ static int32_t ad9361_load_gt(struct ad9361_rf_phy *phy, uint64_t freq,
 	phy->tx_quad_lpf_tia_match = -EINVAL;
 
 	for (i = 0; i < index_max; i++) {
-		ad9361_spi_write(spi, REG_GAIN_TABLE_ADDRESS, i); /* Gain Table Index */
-		ad9361_spi_write(spi, REG_GAIN_TABLE_WRITE_DATA1,
-				 tab[i][0] | lna); /* Ext LNA, Int LNA, & Mixer Gain Word */
-		ad9361_spi_write(spi, REG_GAIN_TABLE_WRITE_DATA2,
-				 tab[i][1]); /* TIA & LPF Word */
-		ad9361_spi_write(spi, REG_GAIN_TABLE_WRITE_DATA3,
-				 tab[i][2]); /* DC Cal bit & Dig Gain Word */
+		/* Data3 to Gain Table Index in a single burst (address decremented) */
+		buf[0] = tab[i][2];       /* DC Cal bit & Dig Gain Word */
+		buf[1] = tab[i][1];       /* TIA & LPF Word */
+		buf[2] = tab[i][0] | lna; /* Ext LNA, Int LNA, & Mixer Gain Word */
+		buf[3] = i;               /* Gain Table Index */
+		ad9361_spi_writem(spi, REG_GAIN_TABLE_WRITE_DATA3, buf, 4);
 		ad9361_spi_write(spi, REG_GAIN_TABLE_CONFIG,
 				 START_GAIN_TABLE_CLOCK |
 				 WRITE_GAIN_TABLE |
@@ -4983,6 +5200,7 @@ int32_t ad9361_fastlock_load(struct ad9361_rf_phy *phy, bool tx,
 	phy->fastlock.entry[tx][profile].flags = FASTLOOK_INIT;
 	phy->fastlock.entry[tx][profile].alc_orig = values[15];
 	phy->fastlock.entry[tx][profile].alc_written = values[15];
+	phy->fastlock.entry[tx][profile].rate = 0;
 
 	return ret;
 }
@@ -5000,6 +5218,7 @@ int32_t ad9361_fastlock_store(struct ad9361_rf_phy *phy, bool tx,
 	struct spi_device *spi = phy->spi;
 	uint8_t val[16];
 	uint32_t offs = 0, x, y;
+	int32_t ret;
 
 	dev_dbg(&phy->spi->dev, "%s: %s Profile %"PRIu32":",
 		__func__, tx ? "TX" : "RX", profile);
@@ -5055,7 +5274,11 @@ int32_t ad9361_fastlock_store(struct ad9361_rf_phy *phy, bool tx,
 	y = ad9361_spi_readf(spi, REG_RX_FORCE_VCO_TUNE_1 + offs, FORCE_VCO_TUNE);
 	val[15] = (x << 1) | y;
 
-	return ad9361_fastlock_load(phy, tx, profile, val);
+	ret = ad9361_fastlock_load(phy, tx, profile, val);
+	phy->fastlock.entry[tx][profile].rate =
+		phy->clks[tx ? TX_RFPLL_INT : RX_RFPLL_INT]->rate;
+
+	return ret;
 }
 
 /**
@@ -5127,8 +5350,9 @@ static int32_t ad9361_fastlock_prepare(struct ad9361_rf_phy *phy, bool tx,
 int32_t ad9361_fastlock_recall(struct ad9361_rf_phy *phy, bool tx,
 			       uint32_t profile)
 {
-	uint32_t offs = 0;
+	uint32_t offs = 0, rate;
 	uint8_t curr, _new, orig, current_profile;
+	int32_t ret;
 
 	dev_dbg(&phy->spi->dev, "%s: %s Profile %"PRIu32":",
 		__func__, tx ? "TX" : "RX", profile);
@@ -5165,11 +5389,24 @@ int32_t ad9361_fastlock_recall(struct ad9361_rf_phy *phy, bool tx,
 	ad9361_fastlock_prepare(phy, tx, profile, true);
 	phy->fastlock.current_profile[tx] = profile + 1;
 
-	return ad9361_spi_write(phy->spi, REG_RX_FAST_LOCK_SETUP + offs,
-				RX_FAST_LOCK_PROFILE(profile) |
-				(phy->pdata->trx_fastlock_pinctrl_en[tx] ?
-				 RX_FAST_LOCK_PROFILE_PIN_SELECT : 0) |
-				RX_FAST_LOCK_MODE_ENABLE);
+	ret = ad9361_spi_write(phy->spi, REG_RX_FAST_LOCK_SETUP + offs,
+			       RX_FAST_LOCK_PROFILE(profile) |
+			       (phy->pdata->trx_fastlock_pinctrl_en[tx] ?
+				RX_FAST_LOCK_PROFILE_PIN_SELECT : 0) |
+			       RX_FAST_LOCK_MODE_ENABLE);
+
+	/* The synthesizer now runs the profile rate: update the cached clock
+	 * rates (unknown rate: the next set_rate reprograms the synthesizer). */
+	rate = phy->fastlock.entry[tx][profile].rate;
+	phy->clks[tx ? TX_RFPLL_INT : RX_RFPLL_INT]->rate = rate;
+	if (!(tx ? phy->pdata->use_ext_tx_lo : phy->pdata->use_ext_rx_lo))
+		phy->clks[tx ? TX_RFPLL : RX_RFPLL]->rate = rate;
+	if (tx)
+		phy->current_tx_lo_freq = rate;
+	else
+		phy->current_rx_lo_freq = rate;
+
+	return ret;
 }
 
 /**
@@ -5668,6 +5905,113 @@ int32_t ad9361_do_calib_run(struct ad9361_rf_phy *phy, uint32_t cal,
 	return ret;
 }
 
+/**
+ * Run the TX quadrature calibration, tracking disabled and ENSM in ALERT
+ * (by ad9361_do_calib_run or by the caller).
+ * @param phy The AD9361 state structure.
+ * @param alert Tracking already disabled and ENSM already in ALERT.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int32_t ad9361_tx_quad_calib_run(struct ad9361_rf_phy *phy, bool alert)
+{
+	if (alert)
+		return ad9361_tx_quad_calib(phy, phy->current_rx_bw_Hz / 2,
+					    phy->current_tx_bw_Hz / 2, -1);
+
+	return ad9361_do_calib_run(phy, TX_QUAD_CAL, -1);
+}
+
+/**
+ * Run the TX quadrature calibration after a TX LO change, or restore its
+ * results from the calibration cache when this LO band was already calibrated
+ * with the same RF bandwidths and TX sample rate, and in the same temperature
+ * bin.
+ * @param phy The AD9361 state structure.
+ * @param lo_freq The TX LO frequency [Hz].
+ * @param alert Tracking already disabled and ENSM already in ALERT.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int32_t ad9361_tx_quad_calib_cached(struct ad9361_rf_phy *phy,
+		uint64_t lo_freq, bool alert)
+{
+	struct ad9361_cal_cache *cache = phy->cal_cache;
+	struct ad9361_cal_entry *entry = NULL;
+	uint32_t tx_sampl_Hz;
+	int32_t temp_bin, ret;
+	uint32_t i;
+
+	if (!cache)
+		return ad9361_tx_quad_calib_run(phy, alert);
+
+	do_div(&lo_freq, phy->cal_threshold_freq);
+	temp_bin = ad9361_get_temp(phy) / AD9361_CAL_CACHE_TEMP_STEP;
+	tx_sampl_Hz = phy->clks[TX_SAMPL_CLK]->rate;
+
+	/* Entry of this LO band/bandwidths/rate (stale if from another temperature bin). */
+	for (i = 0; i < AD9361_CAL_CACHE_ENTRIES; i++) {
+		if (cache->entry[i].valid &&
+		    (cache->entry[i].band == lo_freq) &&
+		    (cache->entry[i].rx_bw_Hz == phy->current_rx_bw_Hz) &&
+		    (cache->entry[i].tx_bw_Hz == phy->current_tx_bw_Hz) &&
+		    (cache->entry[i].tx_sampl_Hz == tx_sampl_Hz)) {
+			entry = &cache->entry[i];
+			break;
+		}
+	}
+
+	if (entry && (entry->temp_bin == temp_bin)) {
+		cache->hits++;
+		for (i = 0; i < ARRAY_SIZE(entry->tx_quad); i++) {
+			ret = ad9361_spi_write(phy->spi, REG_TX1_OUT_1_PHASE_CORR + i,
+					       entry->tx_quad[i]);
+			if (ret < 0)
+				return ret;
+		}
+		return 0;
+	}
+
+	cache->misses++;
+	ret = ad9361_tx_quad_calib_run(phy, alert);
+	if (ret < 0)
+		return ret;
+
+	/* Store the results (replacing the stale entry of this band if any). */
+	if (!entry) {
+		entry = &cache->entry[cache->next];
+		cache->next = (cache->next + 1) % AD9361_CAL_CACHE_ENTRIES;
+	}
+	for (i = 0; i < ARRAY_SIZE(entry->tx_quad); i++) {
+		ret = ad9361_spi_read(phy->spi, REG_TX1_OUT_1_PHASE_CORR + i);
+		if (ret < 0) {
+			entry->valid = 0;
+			return ret;
+		}
+		entry->tx_quad[i] = ret;
+	}
+	entry->band = lo_freq;
+	entry->rx_bw_Hz = phy->current_rx_bw_Hz;
+	entry->tx_bw_Hz = phy->current_tx_bw_Hz;
+	entry->tx_sampl_Hz = tx_sampl_Hz;
+	entry->temp_bin = temp_bin;
+	entry->valid = 1;
+
+	return 0;
+}
+
+/**
+ * Restore the TX quadrature calibration results for the current TX LO, RF
+ * bandwidths and TX sample rate from the calibration cache, or run the
+ * calibration (used after a sample rate change, tracking disabled and ENSM
+ * in ALERT by the caller).
+ * @param phy The AD9361 state structure.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int32_t ad9361_tx_quad_calib_reload(struct ad9361_rf_phy *phy)
+{
+	return ad9361_tx_quad_calib_cached(phy,
+		ad9361_from_clk(clk_get_rate(phy, phy->ref_clk_scale[TX_RFPLL])), true);
+}
+
 /**
  * Set the RF bandwidth.
  * @param phy The AD9361 state structure.
@@ -5790,6 +6134,7 @@ int32_t ad9361_load_fir_filter_coef(struct ad9361_rf_phy *phy,
 {
 	struct spi_device *spi = phy->spi;
 	uint32_t val, offs = 0, fir_conf = 0, fir_enable = 0;
+	uint8_t buf[3];
 
 	dev_dbg(&phy->spi->dev, "%s: TAPS %"PRIu32", gain %"PRId32", dest %d",
 		__func__, ntaps, gain_dB, dest);
@@ -5832,11 +6177,11 @@ int32_t ad9361_load_fir_filter_coef(struct ad9361_rf_phy *phy,
 	ad9361_spi_write(spi, REG_TX_FILTER_CONF + offs, fir_conf);
 
 	for (val = 0; val < ntaps; val++) {
-		ad9361_spi_write(spi, REG_TX_FILTER_COEF_ADDR + offs, val);
-		ad9361_spi_write(spi, REG_TX_FILTER_COEF_WRITE_DATA_1 + offs,
-				 coef[val] & 0xFF);
-		ad9361_spi_write(spi, REG_TX_FILTER_COEF_WRITE_DATA_2 + offs,
-				 coef[val] >> 8);
+		/* Data2 to Coefficient Address in a single burst (address decremented) */
+		buf[0] = coef[val] >> 8;
+		buf[1] = coef[val] & 0xFF;
+		buf[2] = val;
+		ad9361_spi_writem(spi, REG_TX_FILTER_COEF_WRITE_DATA_2 + offs, buf, 3);
 		ad9361_spi_write(spi, REG_TX_FILTER_CONF + offs,
 				 fir_conf | FIR_WRITE);
 		ad9361_spi_write(spi, REG_TX_FILTER_COEF_READ_DATA_2 + offs, 0);
@@ -7085,7 +7430,7 @@ int32_t ad9361_rfpll_set_rate(struct refclk_scale *clk_priv, uint32_t rate)
 		if (phy->auto_cal_en && !phy->pdata->use_ext_tx_lo)
 			if ((diff_abs(phy->last_tx_quad_cal_freq, ad9361_from_clk(rate))) >
 			    phy->cal_threshold_freq) {
-				ret = ad9361_do_calib_run(phy, TX_QUAD_CAL, -1);
+				ret = ad9361_tx_quad_calib_cached(phy, ad9361_from_clk(rate), false);
 				if (ret < 0)
 					dev_err(&phy->spi->dev,
 						"%s: TX QUAD cal failed", __func__);
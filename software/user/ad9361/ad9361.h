@@ -3294,6 +3294,7 @@ struct ad9361_fastlock_entry {
 	uint8_t flags;
 	uint8_t alc_orig;
 	uint8_t alc_written;
+	uint32_t rate;	/* Synthesizer rate of the profile (clk units, 0: unknown) */
 };
 
 struct ad9361_fastlock {
@@ -3302,6 +3303,59 @@ struct ad9361_fastlock {
 	struct ad9361_fastlock_entry entry[2][8];
 };
 
+#define AD9361_CAL_CACHE_MAGIC		0x41444343	/* "ADCC" */
+#define AD9361_CAL_CACHE_VERSION	2
+#define AD9361_CAL_CACHE_ENTRIES	32
+#define AD9361_CAL_CACHE_TEMP_STEP	5000	/* Temperature bin (ad9361_get_temp units, ~5 degC) */
+
+struct ad9361_cal_entry {
+	uint32_t valid;
+	uint32_t band;		/* TX LO frequency / cal_threshold_freq */
+	uint32_t rx_bw_Hz;
+	uint32_t tx_bw_Hz;
+	uint32_t tx_sampl_Hz;	/* TX sample rate the results were calibrated at */
+	int32_t temp_bin;
+	uint8_t tx_quad[REG_TX2_OUT_2_OFFSET_Q - REG_TX1_OUT_1_PHASE_CORR + 1];
+};
+
+struct ad9361_cal_cache {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t next;		/* Next entry to replace */
+	uint32_t hits;
+	uint32_t misses;
+	struct ad9361_cal_entry entry[AD9361_CAL_CACHE_ENTRIES];
+};
+
+#define AD9361_RATE_CACHE_ENTRIES	8
+#define AD9361_RATE_IMAGE_REGS		128
+
+struct ad9361_rate_entry {
+	bool valid;
+	bool image_valid;
+	/* Key: requested rate and the configuration the clock chain depends on */
+	uint32_t sampling_freq_hz;
+	uint32_t rate_governor;
+	uint8_t rx_fir_dec;
+	uint8_t tx_fir_int;
+	bool bypass_rx_fir;
+	bool bypass_tx_fir;
+	uint32_t rx_bw_Hz;
+	uint32_t tx_bw_Hz;
+	/* Clock chain, BB filter calibration/ADC setup register image */
+	uint32_t rx_path_clks[6];
+	uint32_t tx_path_clks[6];
+	uint32_t rxbbf_div;
+	uint8_t image[AD9361_RATE_IMAGE_REGS];
+};
+
+struct ad9361_rate_cache {
+	uint32_t next;		/* Next entry to replace */
+	uint32_t hits;
+	uint32_t misses;
+	struct ad9361_rate_entry entry[AD9361_RATE_CACHE_ENTRIES];
+};
+
 enum dig_tune_flags {
 	BE_VERBOSE = 1,
 	BE_MOREVERBOSE = 2,
@@ -3354,6 +3408,8 @@ struct ad9361_rf_phy {
 	bool 			ensm_pin_ctl_en;
 
 	bool			auto_cal_en;
+	struct ad9361_cal_cache	*cal_cache;
+	struct ad9361_rate_cache	*rate_cache;
 	uint64_t			last_tx_quad_cal_freq;
 	uint32_t			last_tx_quad_cal_phase;
 	uint64_t		current_tx_lo_freq;
@@ -3420,6 +3476,14 @@ enum debugfs_cmd {
 	DBGFS_RXGAIN_2,
 };
 
+struct ad9361_spi_stats {
+	uint32_t		reads;			/* Register reads requested */
+	uint32_t		reads_cached;	/* ... served from the register cache */
+	uint32_t		writes;			/* Register writes requested */
+	uint32_t		writes_elided;	/* ... skipped (value already in the register) */
+	uint32_t		transfers;		/* SPI transfers issued (a burst is one transfer) */
+};
+
 /******************************************************************************/
 /************************ Functions Declarations ******************************/
 /******************************************************************************/
@@ -3428,6 +3492,11 @@ int32_t ad9361_spi_readm(struct spi_device *spi, uint32_t reg,
 int32_t ad9361_spi_read(struct spi_device *spi, uint32_t reg);
 int32_t ad9361_spi_write(struct spi_device *spi,
 			 uint32_t reg, uint32_t val);
+bool ad9361_spi_cacheable(uint32_t reg);
+void ad9361_spi_cache_invalidate(struct spi_device *spi);
+void ad9361_spi_cache_begin(struct spi_device *spi);
+void ad9361_spi_cache_end(struct spi_device *spi);
+void ad9361_spi_get_stats(struct spi_device *spi, struct ad9361_spi_stats *stats);
 int32_t ad9361_reset(struct ad9361_rf_phy *phy);
 int32_t register_clocks(struct ad9361_rf_phy *phy);
 int32_t ad9361_init_gain_tables(struct ad9361_rf_phy *phy);
@@ -3510,6 +3579,7 @@ int32_t ad9361_rf_port_setup(struct ad9361_rf_phy *phy, bool is_out,
 int32_t ad9361_mcs(struct ad9361_rf_phy *phy, int32_t step);
 int32_t ad9361_do_calib_run(struct ad9361_rf_phy *phy, uint32_t cal,
 			    int32_t arg);
+int32_t ad9361_tx_quad_calib_reload(struct ad9361_rf_phy *phy);
 int32_t ad9361_fastlock_store(struct ad9361_rf_phy *phy, bool tx,
 			      uint32_t profile);
 int32_t ad9361_fastlock_recall(struct ad9361_rf_phy *phy, bool tx,
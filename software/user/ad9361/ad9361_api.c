@@ -517,6 +517,9 @@ int32_t ad9361_init (struct ad9361_rf_phy **ad9361_phy,
 	phy->bist_tone_level_dB = 0;
 	phy->bist_tone_mask = 0;
 
+	/* Use the SPI register cache during the initialization. */
+	ad9361_spi_cache_begin(phy->spi);
+
 	if (do_init)
 		ad9361_reset(phy);
 
@@ -556,6 +559,8 @@ int32_t ad9361_init (struct ad9361_rf_phy **ad9361_phy,
 		goto out;
 #endif
 
+	ad9361_spi_cache_end(phy->spi);
+
 	printf("%s : AD936x Rev %d successfully initialized\n", __func__, (int)rev);
 
 	*ad9361_phy = phy;
@@ -576,6 +581,38 @@ out:
 	return -ENODEV;
 }
 
+/**
+ * Free the AD9361 driver state (allocated by ad9361_init), the device is left
+ * as configured.
+ * @param phy The AD9361 state structure.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int32_t ad9361_remove(struct ad9361_rf_phy *phy)
+{
+	int32_t i;
+
+	if (!phy)
+		return -EINVAL;
+
+	/* Clocks (only registered on a full initialization). */
+	for (i = 0; i < NUM_AD9361_CLKS; i++) {
+		free(phy->clks[i]);
+		free(phy->ref_clk_scale[i]);
+	}
+	free(phy->clk_data.clks);
+
+	free(phy->spi);
+#ifndef AXI_ADC_NOT_PRESENT
+	free(phy->adc_conv);
+	free(phy->adc_state);
+#endif
+	free(phy->clk_refin);
+	free(phy->pdata);
+	free(phy);
+
+	return 0;
+}
+
 /**
  * Set the Enable State Machine (ENSM) mode.
  * @param phy The AD9361 current state structure.
@@ -784,6 +821,181 @@ int32_t ad9361_get_rx_rf_bandwidth (struct ad9361_rf_phy *phy,
 	return 0;
 }
 
+/* Rate cache register image: BB filter calibrations and ADC setup (written by
+ * ad9361_update_rf_bandwidth). The TX quad calibration results depend on the
+ * TX LO: restored from the calibration cache (or calibrated) instead. */
+static const uint16_t ad9361_rate_image_ranges[][2] = {
+	{REG_TX_BBF_R1,            REG_TX_BBF_CP},
+	{REG_TX_BBF_R2B,           REG_TX_BBF_TUNE},
+	{REG_CONFIG0,              REG_CAPACITOR},
+	{REG_TX_BBF_TUNE_DIVIDER,  REG_TX_BBF_TUNE_MODE},
+	{REG_RX_TIA_CONFIG,        REG_RX2_BBF_R1A},
+	{REG_RX1_BBF_R5,           REG_RX_BBF_C3_LSB},
+	{REG_RX_BBF_TUNE_DIVIDE,   REG_RX_BBBW_KHZ},
+	{0x200,                    0x227},		/* ADC setup */
+};
+
+/**
+ * Read (or compare and write) the rate cache register image.
+ * @param phy The AD9361 current state structure.
+ * @param image The register image.
+ * @param write Write the image registers that differ from the device.
+ * @return The number of image registers (read) or of written registers,
+ *         negative error code otherwise.
+ */
+static int32_t ad9361_rate_image_access(struct ad9361_rf_phy *phy,
+					uint8_t *image, bool write)
+{
+	uint8_t buf[MAX_MBYTE_SPI];
+	uint32_t r, reg, num, i, n = 0;
+	int32_t ret, written = 0;
+
+	for (r = 0; r < ARRAY_SIZE(ad9361_rate_image_ranges); r++) {
+		for (reg = ad9361_rate_image_ranges[r][0];
+		     reg <= ad9361_rate_image_ranges[r][1]; reg += num) {
+			num = min_t(uint32_t, MAX_MBYTE_SPI,
+				    ad9361_rate_image_ranges[r][1] - reg + 1);
+			/* Bursts access decrementing addresses. */
+			ret = ad9361_spi_readm(phy->spi, reg + num - 1, buf, num);
+			if (ret < 0)
+				return ret;
+			if (n + num > AD9361_RATE_IMAGE_REGS)
+				return -EINVAL;
+			for (i = 0; i < num; i++, n++) {
+				if (!write) {
+					image[n] = buf[num - 1 - i];
+				} else if (image[n] != buf[num - 1 - i]) {
+					ret = ad9361_spi_write(phy->spi, reg + i, image[n]);
+					if (ret < 0)
+						return ret;
+					written++;
+				}
+			}
+		}
+	}
+
+	return write ? written : (int32_t)n;
+}
+
+/**
+ * Set the sampling frequency through the rate cache: the clock chain computed
+ * for a rate (and FIR/bandwidth configuration) is memoized, with the register
+ * image of the calibrations run after the rate change. Switching back to a
+ * cached rate only reprograms the clocks and the image registers that differ
+ * (no BB filter calibrations, TX quad calibration results restored from the
+ * calibration cache when enabled), and is a no-op when the rate is already
+ * set.
+ * @param phy The AD9361 current state structure.
+ * @param sampling_freq_hz The desired frequency (Hz).
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int32_t ad9361_set_sampling_freq_cached(struct ad9361_rf_phy *phy,
+					       uint32_t sampling_freq_hz)
+{
+	struct ad9361_rate_cache *cache = phy->rate_cache;
+	struct ad9361_rate_entry *entry = NULL;
+	uint8_t image[AD9361_RATE_IMAGE_REGS];
+	bool live;
+	int32_t ret, i, n;
+
+	for (i = 0; i < AD9361_RATE_CACHE_ENTRIES; i++) {
+		entry = &cache->entry[i];
+		if (entry->valid &&
+		    (entry->sampling_freq_hz == sampling_freq_hz) &&
+		    (entry->rate_governor == phy->rate_governor) &&
+		    (entry->rx_fir_dec == phy->rx_fir_dec) &&
+		    (entry->tx_fir_int == phy->tx_fir_int) &&
+		    (entry->bypass_rx_fir == phy->bypass_rx_fir) &&
+		    (entry->bypass_tx_fir == phy->bypass_tx_fir) &&
+		    (entry->rx_bw_Hz == phy->current_rx_bw_Hz) &&
+		    (entry->tx_bw_Hz == phy->current_tx_bw_Hz))
+			break;
+		entry = NULL;
+	}
+
+	if (entry) {
+		cache->hits++;
+	} else {
+		cache->misses++;
+		entry = &cache->entry[cache->next];
+		cache->next = (cache->next + 1) % AD9361_RATE_CACHE_ENTRIES;
+		entry->valid = false;
+		entry->image_valid = false;
+		ret = ad9361_calculate_rf_clock_chain(phy, sampling_freq_hz,
+						      phy->rate_governor,
+						      entry->rx_path_clks,
+						      entry->tx_path_clks);
+		if (ret < 0)
+			return ret;
+		entry->sampling_freq_hz = sampling_freq_hz;
+		entry->rate_governor = phy->rate_governor;
+		entry->rx_fir_dec = phy->rx_fir_dec;
+		entry->tx_fir_int = phy->tx_fir_int;
+		entry->bypass_rx_fir = phy->bypass_rx_fir;
+		entry->bypass_tx_fir = phy->bypass_tx_fir;
+		entry->rx_bw_Hz = phy->current_rx_bw_Hz;
+		entry->tx_bw_Hz = phy->current_tx_bw_Hz;
+		entry->valid = true;
+	}
+
+	/* Clock chain already set? */
+	live = phy->clks[BBPLL_CLK]->rate == entry->rx_path_clks[BBPLL_FREQ];
+	for (i = ADC_CLK, n = ADC_FREQ; i <= RX_SAMPL_CLK; i++, n++)
+		live &= phy->clks[i]->rate == entry->rx_path_clks[n];
+	for (i = DAC_CLK, n = ADC_FREQ; i <= TX_SAMPL_CLK; i++, n++)
+		live &= phy->clks[i]->rate == entry->tx_path_clks[n];
+
+	/* Same rate, calibration results still in place: nothing to do. */
+	if (live && entry->image_valid) {
+		ret = ad9361_rate_image_access(phy, image, false);
+		if (ret < 0)
+			return ret;
+		if (memcmp(image, entry->image, ret) == 0)
+			return 0;
+	}
+
+	if (!live) {
+		ret = ad9361_set_trx_clock_chain(phy, entry->rx_path_clks,
+						 entry->tx_path_clks);
+		if (ret < 0)
+			return ret;
+	}
+
+	/* Known rate: reload the calibration results, as ad9361_update_rf_bandwidth
+	 * with tracking disabled and the ENSM in ALERT. The TX quad calibration
+	 * depends on the rate: restored from the calibration cache or run. */
+	if (entry->image_valid) {
+		ret = ad9361_tracking_control(phy, false, false, false);
+		if (ret < 0)
+			return ret;
+		ad9361_ensm_force_state(phy, ENSM_STATE_ALERT);
+
+		phy->rxbbf_div = entry->rxbbf_div;
+		ret = ad9361_rate_image_access(phy, entry->image, true);
+		if (ret >= 0)
+			ret = ad9361_tx_quad_calib_reload(phy);
+
+		n = ad9361_tracking_control(phy, phy->bbdc_track_en,
+					    phy->rfdc_track_en, phy->quad_track_en);
+		ad9361_ensm_restore_prev_state(phy);
+
+		return (ret < 0) ? ret : (n < 0) ? n : 0;
+	}
+
+	/* New rate: calibrate and store the results. */
+	ret = ad9361_update_rf_bandwidth(phy, phy->current_rx_bw_Hz,
+					 phy->current_tx_bw_Hz);
+	if (ret < 0)
+		return ret;
+	ret = ad9361_rate_image_access(phy, entry->image, false);
+	if (ret < 0)
+		return ret;
+	entry->rxbbf_div = phy->rxbbf_div;
+	entry->image_valid = true;
+
+	return 0;
+}
+
 /**
  * Set the RX sampling frequency.
  * @param phy The AD9361 current state structure.
@@ -800,6 +1012,9 @@ int32_t ad9361_set_rx_sampling_freq (struct ad9361_rf_phy *phy,
 	int32_t ret;
 	uint32_t rx[6], tx[6];
 
+	if (phy->rate_cache)
+		return ad9361_set_sampling_freq_cached(phy, sampling_freq_hz);
+
 	ret = ad9361_calculate_rf_clock_chain(phy, sampling_freq_hz,
 					      phy->rate_governor, rx, tx);
 	if (ret < 0)
@@ -1440,6 +1655,9 @@ int32_t ad9361_set_tx_sampling_freq (struct ad9361_rf_phy *phy,
 	int32_t ret;
 	uint32_t rx[6], tx[6];
 
+	if (phy->rate_cache)
+		return ad9361_set_sampling_freq_cached(phy, sampling_freq_hz);
+
 	ret = ad9361_calculate_rf_clock_chain(phy, sampling_freq_hz,
 					      phy->rate_governor, rx, tx);
 	if (ret < 0)
@@ -2183,3 +2401,296 @@ int32_t ad9361_get_temperature(struct ad9361_rf_phy *phy,
 
 	return 0;
 }
+
+/* Snapshot registers checked on restore: clock chain, FIRs, parallel port and
+ * baseband filters configuration (changed by a sample rate/bandwidth change,
+ * reset by an AD9361 reset). The AD9361 must still run this configuration. */
+static const uint16_t ad9361_snapshot_check_ranges[][2] = {
+	{REG_TX_ENABLE_FILTER_CTRL,  REG_TX_ENABLE_FILTER_CTRL + 1},
+	{REG_CLOCK_ENABLE,           REG_BBPLL},
+	{REG_PARALLEL_PORT_CONF_1,   REG_PARALLEL_PORT_CONF_3},
+	{REG_FRACT_BB_FREQ_WORD_1,   REG_INTEGER_BB_FREQ_WORD},
+	{REG_TX_FILTER_CONF,         REG_TX_FILTER_CONF},
+	{REG_TX_BBF_TUNE_DIVIDER,    REG_TX_BBF_TUNE_MODE},
+	{REG_RX_FILTER_CONFIG,       REG_RX_FILTER_CONFIG},
+	{REG_RX_TIA_CONFIG,          REG_TIA2_C_MSB},
+	{REG_RX_BBF_TUNE_DIVIDE,     REG_RX_BBF_TUNE_CONFIG},
+};
+
+/* Snapshot registers reloaded on restore when they differ, in addition to the
+ * static configuration registers: TX attenuations and TX quadrature calibration
+ * results. */
+static const uint16_t ad9361_snapshot_reload_ranges[][2] = {
+	{REG_TX1_ATTEN_0,            REG_TX2_ATTEN_1},
+	{REG_TX1_OUT_1_PHASE_CORR,   REG_TX2_OUT_2_OFFSET_Q},
+};
+
+/**
+ * Check if a register is in register ranges.
+ * @param ranges The register ranges.
+ * @param num The number of ranges.
+ * @param reg The register address.
+ * @return true if the register is in the ranges.
+ */
+static bool ad9361_snapshot_in_ranges(const uint16_t ranges[][2], uint32_t num,
+				      uint32_t reg)
+{
+	uint32_t i;
+
+	for (i = 0; i < num; i++)
+		if (reg >= ranges[i][0] && reg <= ranges[i][1])
+			return true;
+
+	return false;
+}
+
+/**
+ * Check if a register is saved in the snapshots.
+ * @param reg The register address.
+ * @return true if the register is saved.
+ */
+static bool ad9361_snapshot_reg(uint32_t reg)
+{
+	return ad9361_spi_cacheable(reg) ||
+	       ad9361_snapshot_in_ranges(ad9361_snapshot_check_ranges,
+					 ARRAY_SIZE(ad9361_snapshot_check_ranges), reg) ||
+	       ad9361_snapshot_in_ranges(ad9361_snapshot_reload_ranges,
+					 ARRAY_SIZE(ad9361_snapshot_reload_ranges), reg);
+}
+
+/**
+ * Read the snapshot registers (consecutive registers in SPI bursts).
+ * @param spi
+ * @param regs The register image (AD9361_SNAPSHOT_REGS).
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int32_t ad9361_snapshot_read_regs(struct spi_device *spi, uint8_t *regs)
+{
+	uint8_t buf[MAX_MBYTE_SPI];
+	uint32_t reg, num, i;
+	int32_t ret;
+
+	for (reg = 0; reg < AD9361_SNAPSHOT_REGS; reg += num) {
+		num = 0;
+		while ((reg + num < AD9361_SNAPSHOT_REGS) && (num < MAX_MBYTE_SPI) &&
+		       ad9361_snapshot_reg(reg + num))
+			num++;
+		if (num == 0) {
+			num = 1;
+			continue;
+		}
+		/* Bursts access decrementing addresses. */
+		ret = ad9361_spi_readm(spi, reg + num - 1, buf, num);
+		if (ret < 0)
+			return ret;
+		for (i = 0; i < num; i++)
+			regs[reg + num - 1 - i] = buf[i];
+	}
+
+	return 0;
+}
+
+/**
+ * Save the AD9361 state in a snapshot: register image of the configuration
+ * and calibration results, driver state and clock rates. To be called after a
+ * full initialization.
+ * @param phy The AD9361 current state structure.
+ * @param key The profile key (identifies the initialization parameters).
+ * @param snap The snapshot.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int32_t ad9361_save_snapshot(struct ad9361_rf_phy *phy, uint64_t key,
+			     struct ad9361_snapshot *snap)
+{
+	int32_t ret;
+	int32_t i;
+
+	memset(snap, 0, sizeof(*snap));
+	snap->magic   = AD9361_SNAPSHOT_MAGIC;
+	snap->version = AD9361_SNAPSHOT_VERSION;
+	snap->size    = sizeof(*snap);
+	snap->key     = key;
+
+	ret = ad9361_spi_read(phy->spi, REG_PRODUCT_ID);
+	if (ret < 0)
+		return ret;
+	snap->product_id   = ret;
+	snap->ref_clk_rate = phy->clk_refin->rate;
+
+	for (i = 0; i < NUM_AD9361_CLKS; i++)
+		snap->clk_rate[i] = phy->clks[i]->rate;
+
+	/* Driver state (without the pointers to this instance). */
+	snap->phy = *phy;
+	snap->phy.spi = NULL;
+	snap->phy.clk_refin = NULL;
+	memset(snap->phy.clks, 0, sizeof(snap->phy.clks));
+	memset(snap->phy.ref_clk_scale, 0, sizeof(snap->phy.ref_clk_scale));
+	memset(&snap->phy.clk_data, 0, sizeof(snap->phy.clk_data));
+	snap->phy.ad9361_rfpll_ext_recalc_rate = NULL;
+	snap->phy.ad9361_rfpll_ext_round_rate = NULL;
+	snap->phy.ad9361_rfpll_ext_set_rate = NULL;
+	snap->phy.pdata = NULL;
+	snap->phy.gt_info = NULL;
+	snap->phy.adc_conv = NULL;
+	snap->phy.adc_state = NULL;
+	snap->phy.cal_cache = NULL;
+	snap->phy.rate_cache = NULL;
+	snap->pdata = *phy->pdata;
+
+	return ad9361_snapshot_read_regs(phy->spi, snap->regs);
+}
+
+/**
+ * Restore the AD9361 state from a snapshot (warm start), on a device attached
+ * without initialization (ad9361_init with do_init = 0). The device must still
+ * run the snapshot clock chain/filters configuration (no reset, same sample
+ * rate and bandwidth): the other registers that differ from the snapshot are
+ * reloaded and the LOs are retuned to the snapshot frequencies.
+ * @param phy The AD9361 current state structure.
+ * @param snap The snapshot.
+ * @return The number of reloaded registers in case of success, negative error
+ *         code otherwise (-ENODEV: the device does not match the snapshot, a
+ *         full initialization is required).
+ */
+int32_t ad9361_restore_snapshot(struct ad9361_rf_phy *phy,
+				const struct ad9361_snapshot *snap)
+{
+	struct ad9361_rf_phy state;
+	uint8_t regs[AD9361_SNAPSHOT_REGS];
+	int32_t reloaded = 0;
+	uint32_t reg;
+	int32_t ret;
+
+	if ((snap->magic != AD9361_SNAPSHOT_MAGIC) ||
+	    (snap->version != AD9361_SNAPSHOT_VERSION) ||
+	    (snap->size != sizeof(*snap)))
+		return -EINVAL;
+
+	/* Check the device identity. */
+	ret = ad9361_spi_read(phy->spi, REG_PRODUCT_ID);
+	if (ret < 0)
+		return ret;
+	if (((uint32_t)ret != snap->product_id) ||
+	    (phy->clk_refin->rate != snap->ref_clk_rate))
+		return -ENODEV;
+
+	/* Check the device still runs the snapshot configuration. */
+	ad9361_spi_cache_invalidate(phy->spi);
+	ret = ad9361_snapshot_read_regs(phy->spi, regs);
+	if (ret < 0)
+		return ret;
+	for (reg = 0; reg < AD9361_SNAPSHOT_REGS; reg++) {
+		if (ad9361_snapshot_in_ranges(ad9361_snapshot_check_ranges,
+					      ARRAY_SIZE(ad9361_snapshot_check_ranges), reg) &&
+		    (regs[reg] != snap->regs[reg])) {
+			printf("%s : Register 0x%03X differs from the snapshot\n",
+			       __func__, (unsigned int)reg);
+			return -ENODEV;
+		}
+	}
+	ret = ad9361_spi_read(phy->spi, REG_CH_1_OVERFLOW);
+	if (ret < 0)
+		return ret;
+	if (!(ret & BBPLL_LOCK))
+		return -ENODEV;
+
+	/* Reload the registers that differ. */
+	for (reg = 0; reg < AD9361_SNAPSHOT_REGS; reg++) {
+		if (!ad9361_snapshot_reg(reg) || (regs[reg] == snap->regs[reg]))
+			continue;
+		ret = ad9361_spi_write(phy->spi, reg, snap->regs[reg]);
+		if (ret < 0)
+			return ret;
+		reloaded++;
+	}
+
+	/* Restore the driver state (keeping the pointers of this instance). */
+	state = snap->phy;
+	state.id_no = phy->id_no;
+	state.spi = phy->spi;
+	state.clk_refin = phy->clk_refin;
+	memcpy(state.clks, phy->clks, sizeof(state.clks));
+	memcpy(state.ref_clk_scale, phy->ref_clk_scale, sizeof(state.ref_clk_scale));
+	state.clk_data = phy->clk_data;
+	state.ad9361_rfpll_ext_recalc_rate = phy->ad9361_rfpll_ext_recalc_rate;
+	state.ad9361_rfpll_ext_round_rate = phy->ad9361_rfpll_ext_round_rate;
+	state.ad9361_rfpll_ext_set_rate = phy->ad9361_rfpll_ext_set_rate;
+	state.pdata = phy->pdata;
+	state.gt_info = phy->gt_info;
+	state.adc_conv = phy->adc_conv;
+	state.adc_state = phy->adc_state;
+	state.cal_cache = phy->cal_cache;
+	state.rate_cache = phy->rate_cache;
+	*phy = state;
+	*phy->pdata = snap->pdata;
+
+	/* Register the clocks (rates recalculated from the device). */
+	ret = register_clocks(phy);
+	if (ret < 0)
+		return ret;
+	phy->clks[RX_RFPLL_DUMMY]->rate = snap->clk_rate[RX_RFPLL_DUMMY];
+	phy->clks[TX_RFPLL_DUMMY]->rate = snap->clk_rate[TX_RFPLL_DUMMY];
+
+	/* Retune the LOs (the gain table follows the RX LO). */
+	if (phy->clks[RX_RFPLL]->rate != snap->clk_rate[RX_RFPLL]) {
+		phy->current_table = -1;
+		ret = clk_set_rate(phy, phy->ref_clk_scale[RX_RFPLL],
+				   snap->clk_rate[RX_RFPLL]);
+		if (ret < 0)
+			return ret;
+	}
+	ret = clk_set_rate(phy, phy->ref_clk_scale[TX_RFPLL],
+			   snap->clk_rate[TX_RFPLL]);
+	if (ret < 0)
+		return ret;
+
+	/* Check the synthesizers lock. */
+	if ((!phy->pdata->use_ext_rx_lo &&
+	     !(ad9361_spi_read(phy->spi, REG_RX_CP_OVERRANGE_VCO_LOCK) & VCO_LOCK)) ||
+	    (!phy->pdata->use_ext_tx_lo &&
+	     !(ad9361_spi_read(phy->spi, REG_TX_CP_OVERRANGE_VCO_LOCK) & VCO_LOCK)))
+		return -ENODEV;
+
+	return reloaded;
+}
+
+/**
+ * Set the rate cache: memoized clock chains and calibration results of the
+ * last sampling frequencies (see ad9361_set_rx/tx_sampling_freq).
+ * @param phy The AD9361 current state structure.
+ * @param cache The rate cache (NULL: disabled), cleared.
+ * @return 0 in case of success.
+ */
+int32_t ad9361_set_rate_cache(struct ad9361_rf_phy *phy,
+			      struct ad9361_rate_cache *cache)
+{
+	if (cache)
+		memset(cache, 0, sizeof(*cache));
+	phy->rate_cache = cache;
+
+	return 0;
+}
+
+/**
+ * Set the calibration cache: the TX quadrature calibration results are stored
+ * per TX LO band, RF bandwidths and temperature bin, and restored instead of
+ * re-running the calibration on retunes to a known band. The cache can be
+ * persisted by the caller; an invalid cache (magic/version) is cleared.
+ * @param phy The AD9361 current state structure.
+ * @param cache The calibration cache (NULL: disabled).
+ * @return 0 in case of success.
+ */
+int32_t ad9361_set_cal_cache(struct ad9361_rf_phy *phy,
+			     struct ad9361_cal_cache *cache)
+{
+	if (cache && ((cache->magic != AD9361_CAL_CACHE_MAGIC) ||
+		      (cache->version != AD9361_CAL_CACHE_VERSION))) {
+		memset(cache, 0, sizeof(*cache));
+		cache->magic = AD9361_CAL_CACHE_MAGIC;
+		cache->version = AD9361_CAL_CACHE_VERSION;
+	}
+	phy->cal_cache = cache;
+
+	return 0;
+}
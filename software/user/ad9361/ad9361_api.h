@@ -310,6 +310,25 @@ typedef struct {
 	uint32_t	tx_bandwidth;
 } AD9361_TXFIRConfig;
 
+#define AD9361_SNAPSHOT_MAGIC	0x41443953	/* "AD9S" */
+#define AD9361_SNAPSHOT_VERSION	3
+#define AD9361_SNAPSHOT_REGS	1024
+
+/* State snapshot (warm start): register image and driver state after a full
+ * initialization, restored on an already configured AD9361. */
+struct ad9361_snapshot {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	size;				/* sizeof(struct ad9361_snapshot) */
+	uint32_t	product_id;
+	uint64_t	key;				/* Profile key (set by the caller) */
+	uint32_t	ref_clk_rate;
+	uint32_t	clk_rate[NUM_AD9361_CLKS];
+	struct ad9361_rf_phy			phy;	/* Pointers not saved */
+	struct ad9361_phy_platform_data	pdata;
+	uint8_t		regs[AD9361_SNAPSHOT_REGS];	/* Snapshot registers only */
+};
+
 enum ad9361_ensm_mode {
 	ENSM_MODE_TX,
 	ENSM_MODE_RX,
@@ -364,6 +383,8 @@ enum ad9361_ensm_mode {
 /* Initialize the AD9361 part. */
 int32_t ad9361_init (struct ad9361_rf_phy **ad9361_phy,
 		     AD9361_InitParam *init_param, int do_init);
+/* Free the AD9361 driver state. */
+int32_t ad9361_remove(struct ad9361_rf_phy *phy);
 /* Set the Enable State Machine (ENSM) mode. */
 int32_t ad9361_set_en_state_machine_mode (struct ad9361_rf_phy *phy,
 		uint32_t mode);
@@ -543,6 +564,18 @@ int32_t ad9361_do_dcxo_tune_fine(struct ad9361_rf_phy *phy,
 /* Get the temperature. */
 int32_t ad9361_get_temperature(struct ad9361_rf_phy *phy,
 			       int32_t *temp);
+/* Save the AD9361 state in a snapshot. */
+int32_t ad9361_save_snapshot(struct ad9361_rf_phy *phy, uint64_t key,
+			     struct ad9361_snapshot *snap);
+/* Restore the AD9361 state from a snapshot (warm start). */
+int32_t ad9361_restore_snapshot(struct ad9361_rf_phy *phy,
+				const struct ad9361_snapshot *snap);
+/* Set the rate cache (NULL: disabled). */
+int32_t ad9361_set_rate_cache(struct ad9361_rf_phy *phy,
+			      struct ad9361_rate_cache *cache);
+/* Set the calibration cache (NULL: disabled). */
+int32_t ad9361_set_cal_cache(struct ad9361_rf_phy *phy,
+			     struct ad9361_cal_cache *cache);
 
 #ifdef __cplusplus
 }
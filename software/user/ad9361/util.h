@@ -94,6 +94,11 @@ struct device {
 struct spi_device {
 	struct device	dev;
 	uint8_t 		id_no;
+	/* Write-through cache of the static/config registers (see ad9361_spi_cacheable). */
+	uint8_t			cache[1024];
+	uint8_t			cache_valid[1024 / 8];
+	uint32_t		cache_scope;	/* Cache scopes nesting, cache bypassed at 0. */
+	struct ad9361_spi_stats	stats;
 };
 
 struct axiadc_state {
@@ -39,6 +39,30 @@ void litepcie_dma_reader(int fd, uint8_t enable, int64_t *hw_count, int64_t *sw_
     *sw_count = m.sw_count;
 }
 
+/* MSI timestamps (writer: 1 for RX, 0 for TX) */
+
+void litepcie_dma_get_timestamps(int fd, uint8_t writer, struct litepcie_ioctl_dma_timestamps *m) {
+    m->writer = writer;
+    checked_ioctl(fd, LITEPCIE_IOCTL_DMA_TIMESTAMPS, m);
+}
+
+void litepcie_dma_enable_fpga_timestamps(int fd, uint8_t enable) {
+    struct litepcie_ioctl_dma_timestamps_enable m;
+    m.enable = enable;
+    checked_ioctl(fd, LITEPCIE_IOCTL_DMA_TIMESTAMPS_ENABLE, &m);
+}
+
+/* eventfd notification (rx_fd/tx_fd: -1 to disable, watermark: in buffers, 0 for default) */
+
+void litepcie_dma_set_eventfd(int fd, int rx_fd, int tx_fd, uint32_t rx_watermark, uint32_t tx_watermark) {
+    struct litepcie_ioctl_eventfd m;
+    m.rx_fd = rx_fd;
+    m.tx_fd = tx_fd;
+    m.rx_watermark = rx_watermark;
+    m.tx_watermark = tx_watermark;
+    checked_ioctl(fd, LITEPCIE_IOCTL_EVENTFD, &m);
+}
+
 /* lock */
 
 uint8_t litepcie_request_dma(int fd, uint8_t reader, uint8_t writer) {
@@ -32,6 +32,9 @@ struct litepcie_dma_ctrl {
 void litepcie_dma_set_loopback(int fd, uint8_t loopback_enable);
 void litepcie_dma_reader(int fd, uint8_t enable, int64_t *hw_count, int64_t *sw_count);
 void litepcie_dma_writer(int fd, uint8_t enable, int64_t *hw_count, int64_t *sw_count);
+void litepcie_dma_get_timestamps(int fd, uint8_t writer, struct litepcie_ioctl_dma_timestamps *m);
+void litepcie_dma_enable_fpga_timestamps(int fd, uint8_t enable);
+void litepcie_dma_set_eventfd(int fd, int rx_fd, int tx_fd, uint32_t rx_watermark, uint32_t tx_watermark);
 
 uint8_t litepcie_request_dma(int fd, uint8_t reader, uint8_t writer);
 void litepcie_release_dma(int fd, uint8_t reader, uint8_t writer);
@@ -10,15 +10,17 @@
 
 #include <sys/ioctl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include "litepcie_flash.h"
 #include "litepcie_helpers.h"
 #include "litepcie.h"
 
 #ifdef CSR_FLASH_BASE
 
-//#define FLASH_FULL_ERASE
 #define FLASH_RETRIES 16
 
 static void flash_spi_cs(int fd, uint8_t cs_n)
@@ -120,7 +122,7 @@ uint8_t litepcie_flash_read(int fd, uint32_t addr)
     return flash_spi(fd, 40, FLASH_READ, addr << 8) & 0xff;
 }
 
-static void litepcie_flash_read_buffer(int fd, uint32_t addr, uint8_t *buf, uint16_t size)
+static void flash_read_buffer(int fd, uint32_t addr, uint8_t *buf, uint16_t size)
 {
     int i;
 
@@ -153,6 +155,49 @@ static void litepcie_flash_read_buffer(int fd, uint32_t addr, uint8_t *buf, uint
     }
 }
 
+/* Read/program a page with LITEPCIE_IOCTL_FLASH_PAGE (whole sequence in the driver): 0 on success,
+ * 1 when not supported by the driver, -1 on error. */
+static int flash_page(int fd, uint32_t addr, uint8_t *buf, uint32_t size, bool is_write)
+{
+    struct litepcie_ioctl_flash_page m;
+
+    m.addr     = addr;
+    m.is_write = is_write;
+    m.len      = size;
+    if (is_write)
+        memcpy(m.data, buf, size);
+    if (ioctl(fd, LITEPCIE_IOCTL_FLASH_PAGE, &m) < 0)
+        return (errno == ENOTTY) ? 1 : -1;
+    if (!is_write)
+        memcpy(buf, m.data, size);
+    return 0;
+}
+
+static int litepcie_flash_get_flash_program_size(int fd);
+
+void litepcie_flash_read_buffer(int fd, uint32_t addr, uint8_t *buf, uint32_t size)
+{
+    uint32_t i, n;
+    int program_size = 0;
+
+    for (i = 0; i < size; i += n) {
+        /* pages (4-byte multiples) with the page ioctl */
+        n = size - i;
+        if (n > LITEPCIE_FLASH_PAGE_SIZE)
+            n = LITEPCIE_FLASH_PAGE_SIZE;
+        n &= ~3;
+        if (n && flash_page(fd, addr + i, buf + i, n, false) == 0)
+            continue;
+
+        /* older drivers: 4 bytes per ioctl with software cs control, 1 otherwise */
+        if (program_size == 0)
+            program_size = litepcie_flash_get_flash_program_size(fd);
+        if (n == 0 || program_size == 1)
+            n = 1;
+        flash_read_buffer(fd, addr + i, buf + i, n);
+    }
+}
+
 int litepcie_flash_get_erase_block_size(int fd)
 {
     return FLASH_SECTOR_SIZE;
@@ -172,92 +217,147 @@ static int litepcie_flash_get_flash_program_size(int fd)
         return 1;
 }
 
+static bool flash_blank(const uint8_t *buf, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+        if (buf[i] != 0xff)
+            return false;
+    return true;
+}
+
+/* Program buf at base: sectors already holding the data are skipped, the others are erased and
+ * programmed (blank pages skipped) with a read-back verification of each page. */
 int litepcie_flash_write(int fd,
                      uint8_t *buf, uint32_t base, uint32_t size,
                      void (*progress_cb)(void *opaque, const char *fmt, ...),
                      void *opaque)
 {
-    int i;
+    uint32_t i, j, n;
+    uint32_t sector_size;
     int retries;
+    int ret;
+    bool page_ioctl;
     uint16_t flash_program_size;
+    uint32_t skipped = 0;
+    uint32_t erased  = 0;
+    uint32_t pages   = 0;
 
-    flash_program_size = litepcie_flash_get_flash_program_size(fd);
-    printf("flash_program_size: %d\n", flash_program_size);
+    uint8_t cmp_buf[LITEPCIE_FLASH_PAGE_SIZE];
+    uint8_t *sector_buf;
 
-    uint8_t cmp_buf[256];
+    /* sectors are erased as a whole: base must be sector aligned (and so page aligned) */
+    if (base % FLASH_SECTOR_SIZE) {
+        printf("Flash base 0x%08x not aligned on a %d-byte sector\n", base, FLASH_SECTOR_SIZE);
+        return 1;
+    }
+
+    /* page program ioctl when supported by the driver */
+    page_ioctl = ((size % 4) == 0) && (flash_page(fd, base, cmp_buf, 4, false) == 0);
+    flash_program_size = page_ioctl ? LITEPCIE_FLASH_PAGE_SIZE : litepcie_flash_get_flash_program_size(fd);
+    printf("flash_program_size: %d%s\n", flash_program_size, page_ioctl ? " (page ioctl)" : "");
+
+    sector_buf = malloc(FLASH_SECTOR_SIZE);
+    if (!sector_buf)
+        return 1;
 
     /* dummy command because in some case the first erase does not
        work. */
     flash_read_id(fd, 0);
 
-    /* disable write protection */
-     flash_write_enable(fd);
+    for (i = 0; i < size; i += FLASH_SECTOR_SIZE) {
+        sector_size = size - i;
+        if (sector_size > FLASH_SECTOR_SIZE)
+            sector_size = FLASH_SECTOR_SIZE;
 
-#ifndef FLASH_FULL_ERASE
-    /* erase */
-    for(i = 0; i < size; i += FLASH_SECTOR_SIZE) {
+        /* skip identical sectors */
         if (progress_cb) {
-            progress_cb(opaque, "Erasing @%08x\r", base + i);
+            progress_cb(opaque, "Checking @%08x (%3d%%)\r", base + i, (int)((uint64_t)i * 100 / size));
+        }
+        litepcie_flash_read_buffer(fd, base + i, sector_buf, sector_size);
+        if (memcmp(sector_buf, buf + i, sector_size) == 0) {
+            skipped++;
+            continue;
+        }
+
+        /* erase */
+        if (progress_cb) {
+            progress_cb(opaque, "Erasing  @%08x (%3d%%)\r", base + i, (int)((uint64_t)i * 100 / size));
         }
         flash_write_enable(fd);
         flash_erase_sector(fd, base + i);
         while (flash_read_status(fd) & FLASH_WIP) {
             usleep(1000);
         }
-    }
-    if (progress_cb) {
-        progress_cb(opaque, "\n");
-    }
-#else
-    /* erase full flash */
-    printf("Erasing...\n");
-    flash_write_enable(fd);
-    flash_spi(fd, 8, 0xC7, 0);
-    while (flash_read_status(fd) & FLASH_WIP) {
-        usleep(1000);
-    }
-#endif
-    flash_write_disable(fd);
-
-    i = 0;
-    retries = 0;
-    while (i < size) {
-        if (progress_cb && (i % FLASH_SECTOR_SIZE) == 0) {
-            progress_cb(opaque, "Writing @%08x\r", base + i);
-        }
-
-        /* wait flash to be ready */
-        while (flash_read_status(fd) & FLASH_WIP)
-            usleep(100);
+        erased++;
 
-        /* write flash page */
-        flash_write_enable(fd);
-        flash_write_buffer(fd, base + i, buf + i, flash_program_size);
-        flash_write_disable(fd);
-
-        /* wait flash to be ready*/
-        while (flash_read_status(fd) & FLASH_WIP)
-            usleep(100);
-
-        /* verify flash page */
-        litepcie_flash_read_buffer(fd, base + i, cmp_buf, flash_program_size);
-        if (memcmp(buf + i, cmp_buf, flash_program_size) != 0) {
-            retries += 1;
-        } else {
-            i += flash_program_size;
-            retries = 0;
+        /* program */
+        if (progress_cb) {
+            progress_cb(opaque, "Writing  @%08x (%3d%%)\r", base + i, (int)((uint64_t)i * 100 / size));
         }
-
-        if (retries > FLASH_RETRIES) {
-            printf("Not able to write page\n");
-            return 1;
+        retries = 0;
+        for (j = 0; j < sector_size; ) {
+            n = sector_size - j;
+            if (n > flash_program_size)
+                n = flash_program_size;
+
+            /* blank pages are already erased */
+            if (flash_blank(buf + i + j, n)) {
+                j += n;
+                continue;
+            }
+
+            /* write flash page */
+            if (page_ioctl) {
+                ret = flash_page(fd, base + i + j, buf + i + j, n, true);
+                /* invalid request: retrying does not help */
+                if (ret < 0 && errno == EINVAL) {
+                    printf("Page write @%08x (%u bytes) rejected by the driver\n", base + i + j, n);
+                    free(sector_buf);
+                    return 1;
+                }
+            } else {
+                /* wait flash to be ready */
+                while (flash_read_status(fd) & FLASH_WIP)
+                    usleep(100);
+
+                flash_write_enable(fd);
+                flash_write_buffer(fd, base + i + j, buf + i + j, n);
+                flash_write_disable(fd);
+
+                /* wait flash to be ready*/
+                while (flash_read_status(fd) & FLASH_WIP)
+                    usleep(100);
+                ret = 0;
+            }
+
+            /* verify flash page */
+            if (ret == 0)
+                litepcie_flash_read_buffer(fd, base + i + j, cmp_buf, n);
+            if (ret != 0 || memcmp(buf + i + j, cmp_buf, n) != 0) {
+                retries += 1;
+            } else {
+                j += n;
+                pages++;
+                retries = 0;
+            }
+
+            if (retries > FLASH_RETRIES) {
+                printf("Not able to write page\n");
+                free(sector_buf);
+                return 1;
+            }
         }
     }
+    flash_write_disable(fd);
 
     if (progress_cb) {
         progress_cb(opaque, "\n");
     }
+    printf("%u sectors erased, %u skipped (identical), %u pages programmed.\n", erased, skipped, pages);
 
+    free(sector_buf);
     return 0;
 }
 
@@ -29,6 +29,7 @@
 #define FLASH_SECTOR_SIZE (1 << 16)
 
 uint8_t litepcie_flash_read(int fd, uint32_t addr);
+void litepcie_flash_read_buffer(int fd, uint32_t addr, uint8_t *buf, uint32_t size);
 int litepcie_flash_get_erase_block_size(int fd);
 int litepcie_flash_write(int fd,
                          uint8_t *buf, uint32_t base, uint32_t size,
@@ -11,6 +11,7 @@
 #include <time.h>
 
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 
 #include <stdio.h>
 #include <errno.h>
@@ -29,8 +30,56 @@ int64_t get_time_ms(void)
     return (int64_t)ts.tv_sec * 1000 + (ts.tv_nsec / 1000000U);
 }
 
+/* CSR MMIO backend: CSR accesses on fds with a mapped CSR window are direct loads/stores. */
+#define LITEPCIE_CSR_MAP_FDS 1024
+
+static struct {
+    volatile uint32_t *base;
+    uint32_t csr_base;
+    uint32_t csr_size;
+} litepcie_csr_maps[LITEPCIE_CSR_MAP_FDS];
+
+static inline volatile uint32_t *litepcie_csr_ptr(int fd, uint32_t addr) {
+    if (fd < 0 || fd >= LITEPCIE_CSR_MAP_FDS || !litepcie_csr_maps[fd].base)
+        return NULL;
+    if ((addr - litepcie_csr_maps[fd].csr_base) >= litepcie_csr_maps[fd].csr_size)
+        return NULL;
+    return litepcie_csr_maps[fd].base + (addr - litepcie_csr_maps[fd].csr_base) / 4;
+}
+
+/* Map the CSR window of the device, -1 when not supported/allowed (ioctl accesses are kept). */
+int litepcie_csr_mmap(int fd) {
+    struct litepcie_ioctl_mmap_csr_info info;
+    void *base;
+
+    if (fd < 0 || fd >= LITEPCIE_CSR_MAP_FDS)
+        return -1;
+    if (litepcie_csr_maps[fd].base)
+        return 0;
+    if (ioctl(fd, LITEPCIE_IOCTL_MMAP_CSR_INFO, &info) != 0 || info.csr_size == 0)
+        return -1;
+    base = mmap(NULL, info.csr_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, info.csr_offset);
+    if (base == MAP_FAILED)
+        return -1;
+    litepcie_csr_maps[fd].csr_base = info.csr_base;
+    litepcie_csr_maps[fd].csr_size = info.csr_size;
+    litepcie_csr_maps[fd].base     = base;
+    return 0;
+}
+
+/* Unmap the CSR window of the device (to be called before closing the fd). */
+void litepcie_csr_munmap(int fd) {
+    if (fd < 0 || fd >= LITEPCIE_CSR_MAP_FDS || !litepcie_csr_maps[fd].base)
+        return;
+    munmap((void *)litepcie_csr_maps[fd].base, litepcie_csr_maps[fd].csr_size);
+    litepcie_csr_maps[fd].base = NULL;
+}
+
 uint32_t litepcie_readl(int fd, uint32_t addr) {
     struct litepcie_ioctl_reg m;
+    volatile uint32_t *csr = litepcie_csr_ptr(fd, addr);
+    if (csr)
+        return *csr;
     m.is_write = 0;
     m.addr = addr;
     checked_ioctl(fd, LITEPCIE_IOCTL_REG, &m);
@@ -39,12 +88,76 @@ uint32_t litepcie_readl(int fd, uint32_t addr) {
 
 void litepcie_writel(int fd, uint32_t addr, uint32_t val) {
     struct litepcie_ioctl_reg m;
+    volatile uint32_t *csr = litepcie_csr_ptr(fd, addr);
+    if (csr) {
+        *csr = val;
+        return;
+    }
     m.is_write = 1;
     m.addr = addr;
     m.val = val;
     checked_ioctl(fd, LITEPCIE_IOCTL_REG, &m);
 }
 
+/* Register batch: executed in one LITEPCIE_IOCTL_REG_BATCH (or directly on a mapped CSR window,
+ * or access by access with older drivers). Returns 0, or -1 on a poll timeout/error. */
+static int litepcie_reg_batch_local(int fd, struct litepcie_reg_op *ops, int count, uint32_t timeout_us) {
+    int i;
+    uint32_t val;
+    int64_t deadline;
+
+    if (timeout_us == 0)
+        timeout_us = LITEPCIE_REG_BATCH_TIMEOUT;
+    for (i = 0; i < count; i++) {
+        switch (ops[i].op) {
+        case LITEPCIE_REG_OP_READ:
+            ops[i].val = litepcie_readl(fd, ops[i].addr);
+            break;
+        case LITEPCIE_REG_OP_WRITE:
+            litepcie_writel(fd, ops[i].addr, ops[i].val);
+            break;
+        case LITEPCIE_REG_OP_POLL:
+            deadline = get_time_ms() + (timeout_us + 999) / 1000;
+            for (;;) {
+                val = litepcie_readl(fd, ops[i].addr);
+                if ((val & ops[i].mask) == (ops[i].val & ops[i].mask))
+                    break;
+                if (get_time_ms() > deadline) {
+                    ops[i].val = val;
+                    return -1;
+                }
+            }
+            ops[i].val = val;
+            break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int litepcie_reg_batch(int fd, struct litepcie_reg_op *ops, int count, uint32_t timeout_us) {
+    struct litepcie_ioctl_reg_batch m;
+    int i;
+
+    if ((fd >= 0 && fd < LITEPCIE_CSR_MAP_FDS && litepcie_csr_maps[fd].base) || count > LITEPCIE_REG_BATCH_MAX)
+        return litepcie_reg_batch_local(fd, ops, count, timeout_us);
+
+    m.count      = count;
+    m.timeout_us = timeout_us;
+    for (i = 0; i < count; i++)
+        m.ops[i] = ops[i];
+    if (ioctl(fd, LITEPCIE_IOCTL_REG_BATCH, &m) != 0) {
+        if (errno == ENOTTY)
+            return litepcie_reg_batch_local(fd, ops, count, timeout_us);
+        if (errno != ETIMEDOUT)
+            _check_ioctl(-1, __FILE__, __LINE__);
+    }
+    for (i = 0; i < count; i++)
+        ops[i].val = m.ops[i].val;
+    return (m.done == (uint32_t)count) ? 0 : -1;
+}
+
 void litepcie_reload(int fd) {
     struct litepcie_ioctl_icap m;
     m.addr = ICAP_CMD_REG;
@@ -52,6 +165,21 @@ void litepcie_reload(int fd) {
     checked_ioctl(fd, LITEPCIE_IOCTL_ICAP, &m);
 }
 
+/* SoC identifier/DNA, cached by the driver at probe (CSR reads fallback for older drivers). */
+void litepcie_get_info(int fd, struct litepcie_ioctl_info *info) {
+    int i;
+    if (ioctl(fd, LITEPCIE_IOCTL_INFO, info) == 0)
+        return;
+    for (i = 0; i < LITEPCIE_IDENTIFIER_SIZE; i++)
+        info->identifier[i] = litepcie_readl(fd, CSR_IDENTIFIER_MEM_BASE + 4 * i);
+    info->identifier[LITEPCIE_IDENTIFIER_SIZE - 1] = '\0';
+    info->dna = 0;
+#ifdef CSR_DNA_ID_ADDR
+    info->dna |= (uint64_t)litepcie_readl(fd, CSR_DNA_ID_ADDR + 0) << 32;
+    info->dna |= (uint64_t)litepcie_readl(fd, CSR_DNA_ID_ADDR + 4) <<  0;
+#endif
+}
+
 void _check_ioctl(int status, const char *file, int line) {
     if (status) {
         fprintf(stderr, "Failed ioctl at %s:%d: %s\n", file, line, strerror(errno));
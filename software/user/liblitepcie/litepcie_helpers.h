@@ -20,6 +20,17 @@ uint32_t litepcie_readl(int fd, uint32_t addr);
 void litepcie_writel(int fd, uint32_t addr, uint32_t val);
 void litepcie_reload(int fd);
 
+int litepcie_csr_mmap(int fd);
+void litepcie_csr_munmap(int fd);
+
+#define LITEPCIE_REG_BATCH_TIMEOUT 10000 /* in us, default poll timeout */
+
+struct litepcie_reg_op;
+int litepcie_reg_batch(int fd, struct litepcie_reg_op *ops, int count, uint32_t timeout_us);
+
+struct litepcie_ioctl_info;
+void litepcie_get_info(int fd, struct litepcie_ioctl_info *info);
+
 #define checked_ioctl(...) _check_ioctl(ioctl(__VA_ARGS__), __FILE__, __LINE__)
 void _check_ioctl(int status, const char *file, int line);
 
@@ -19,6 +19,9 @@ extern "C" {
 /* Libs */
 #include "m2sdr_si5351_i2c.h"
 #include "m2sdr_ad9361_spi.h"
+#include "m2sdr_sync.h"
+#include "m2sdr_shm.h"
+#include "m2sdr_cache.h"
 
 #ifdef __cplusplus
 }
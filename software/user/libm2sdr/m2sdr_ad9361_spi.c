@@ -20,8 +20,45 @@
 //#define AD9361_SPI_WRITE_DEBUG
 //#define AD9361_SPI_READ_DEBUG
 
+#define AD9361_SPI_MOSI_WORDS CSR_AD9361_SPI_MOSI_SIZE
+#define AD9361_SPI_MISO_WORDS CSR_AD9361_SPI_MISO_SIZE
+
 /* Private Functions */
 
+/* MOSI is shifted out MSB first: left-align the len bytes in the (multi-word, MSB word first) CSR. */
+static void m2sdr_ad9361_spi_pack(uint8_t len, const uint8_t *mosi, uint32_t *words) {
+    uint8_t bytes[4*AD9361_SPI_MOSI_WORDS] = {0};
+    int pad = 4*AD9361_SPI_MOSI_WORDS - AD9361_SPI_XFER_BYTES;
+    int i;
+
+    for (i = 0; i < len; i++)
+        bytes[pad + i] = mosi[i];
+    for (i = 0; i < AD9361_SPI_MOSI_WORDS; i++)
+        words[i] = bytes[4*i + 0] << 24 | bytes[4*i + 1] << 16 | bytes[4*i + 2] << 8 | bytes[4*i + 3];
+}
+
+/* MISO is shifted in LSB first: the len received bytes are right-aligned in the CSR. */
+static void m2sdr_ad9361_spi_unpack(uint8_t len, const uint32_t *words, uint8_t *miso) {
+    uint8_t bytes[4*AD9361_SPI_MISO_WORDS];
+    int i;
+
+    for (i = 0; i < AD9361_SPI_MISO_WORDS; i++) {
+        bytes[4*i + 0] = words[i] >> 24;
+        bytes[4*i + 1] = words[i] >> 16;
+        bytes[4*i + 2] = words[i] >>  8;
+        bytes[4*i + 3] = words[i] >>  0;
+    }
+    for (i = 0; i < len; i++)
+        miso[i] = bytes[4*AD9361_SPI_MISO_WORDS - len + i];
+}
+
+static void m2sdr_ad9361_spi_cmd(uint8_t *mosi, bool is_write, uint16_t reg, uint8_t n) {
+    mosi[0]  = (is_write << 7);
+    mosi[0] |= ((n - 1) & 0x7) << 4;
+    mosi[0] |= (reg >> 8) & 0x03;
+    mosi[1]  = (reg >> 0) & 0xff;
+}
+
 /* Public Functions */
 
 /* PCIe */
@@ -41,24 +78,57 @@ void m2sdr_ad9361_spi_init(int fd, uint8_t reset) {
 }
 
 void m2sdr_ad9361_spi_xfer(int fd, uint8_t len, uint8_t *mosi, uint8_t *miso) {
+    struct litepcie_reg_op ops[AD9361_SPI_MOSI_WORDS + 2 + AD9361_SPI_MISO_WORDS];
+    uint32_t words[AD9361_SPI_MOSI_WORDS > AD9361_SPI_MISO_WORDS ? AD9361_SPI_MOSI_WORDS : AD9361_SPI_MISO_WORDS];
+    int i;
+    int n = 0;
+
     /* Check write. */
     bool is_write = (mosi[0] & 0x80) != 0;
 
     /* Write MOSI. */
-    litepcie_writel(fd, CSR_AD9361_SPI_MOSI_ADDR, mosi[0] << 16 | mosi[1] << 8 | mosi[2]);
+    m2sdr_ad9361_spi_pack(len, mosi, words);
+    for (i = 0; i < AD9361_SPI_MOSI_WORDS; i++) {
+        ops[n].op   = LITEPCIE_REG_OP_WRITE;
+        ops[n].addr = CSR_AD9361_SPI_MOSI_ADDR + 4*i;
+        ops[n].val  = words[i];
+        n++;
+    }
 
     /* Start SPI. */
-    litepcie_writel(fd, CSR_AD9361_SPI_CONTROL_ADDR, 24*SPI_CONTROL_LENGTH | SPI_CONTROL_START);
+    ops[n].op   = LITEPCIE_REG_OP_WRITE;
+    ops[n].addr = CSR_AD9361_SPI_CONTROL_ADDR;
+    ops[n].val  = 8*len*SPI_CONTROL_LENGTH | SPI_CONTROL_START;
+    n++;
 
     /* Wait done. */
 #ifdef AD9361_SPI_WAIT_DONE
-    while ((litepcie_readl(fd, CSR_AD9361_SPI_STATUS_ADDR) & 0x1) != SPI_STATUS_DONE);
+    ops[n].op   = LITEPCIE_REG_OP_POLL;
+    ops[n].addr = CSR_AD9361_SPI_STATUS_ADDR;
+    ops[n].val  = SPI_STATUS_DONE;
+    ops[n].mask = 0x1;
+    n++;
 #endif
 
     /* Read MISO if read. */
-    miso[2] = 0;
     if (!is_write) {
-        miso[2] = litepcie_readl(fd, CSR_AD9361_SPI_MISO_ADDR) & 0xff;
+        for (i = 0; i < AD9361_SPI_MISO_WORDS; i++) {
+            ops[n].op   = LITEPCIE_REG_OP_READ;
+            ops[n].addr = CSR_AD9361_SPI_MISO_ADDR + 4*i;
+            n++;
+        }
+    }
+
+    /* Do the whole sequence in a single register batch. */
+    if (litepcie_reg_batch(fd, ops, n, 0) < 0)
+        fprintf(stderr, "AD9361 SPI timeout\n");
+
+    for (i = 2; i < len; i++)
+        miso[i] = 0;
+    if (!is_write) {
+        for (i = 0; i < AD9361_SPI_MISO_WORDS; i++)
+            words[i] = ops[n - AD9361_SPI_MISO_WORDS + i].val;
+        m2sdr_ad9361_spi_unpack(len, words, miso);
     }
 }
 
@@ -104,6 +174,58 @@ uint8_t m2sdr_ad9361_spi_read(int fd, uint16_t reg) {
     return dat;
 }
 
+/* Write n registers from reg down to reg-n+1 (AD9361 multi-byte write). */
+void m2sdr_ad9361_spi_writem(int fd, uint16_t reg, const uint8_t *buf, uint8_t n) {
+    uint8_t mosi[AD9361_SPI_XFER_BYTES];
+    uint8_t miso[AD9361_SPI_XFER_BYTES];
+    uint8_t burst;
+    int i;
+
+    while (n > 0) {
+        burst = (n < AD9361_SPI_XFER_BYTES - 2) ? n : AD9361_SPI_XFER_BYTES - 2;
+
+        /* Prepare Data. */
+        m2sdr_ad9361_spi_cmd(mosi, 1, reg, burst);
+        for (i = 0; i < burst; i++)
+            mosi[2 + i] = buf[i];
+
+        /* Do SPI Xfer. */
+        m2sdr_ad9361_spi_xfer(fd, 2 + burst, mosi, miso);
+
+        reg -= burst;
+        buf += burst;
+        n   -= burst;
+    }
+}
+
+/* Read n registers from reg down to reg-n+1 (AD9361 multi-byte read). */
+void m2sdr_ad9361_spi_readm(int fd, uint16_t reg, uint8_t *buf, uint8_t n) {
+    uint8_t mosi[AD9361_SPI_XFER_BYTES];
+    uint8_t miso[AD9361_SPI_XFER_BYTES];
+    uint8_t burst;
+    int i;
+
+    while (n > 0) {
+        burst = (n < AD9361_SPI_XFER_BYTES - 2) ? n : AD9361_SPI_XFER_BYTES - 2;
+
+        /* Prepare Data. */
+        m2sdr_ad9361_spi_cmd(mosi, 0, reg, burst);
+        for (i = 0; i < burst; i++)
+            mosi[2 + i] = 0x00;
+
+        /* Do SPI Xfer. */
+        m2sdr_ad9361_spi_xfer(fd, 2 + burst, mosi, miso);
+
+        /* Process Data. */
+        for (i = 0; i < burst; i++)
+            buf[i] = miso[2 + i];
+
+        reg -= burst;
+        buf += burst;
+        n   -= burst;
+    }
+}
+
 /* Etherbone */
 /*-----------*/
 
@@ -123,14 +245,19 @@ void m2sdr_ad9361_eb_spi_init(struct eb_connection *fd, uint8_t reset) {
 }
 
 void m2sdr_ad9361_eb_spi_xfer(struct eb_connection *eb, uint8_t len, uint8_t *mosi, uint8_t *miso) {
+    uint32_t words[AD9361_SPI_MOSI_WORDS > AD9361_SPI_MISO_WORDS ? AD9361_SPI_MOSI_WORDS : AD9361_SPI_MISO_WORDS];
+    int i;
+
     /* Check write. */
     bool is_write = (mosi[0] & 0x80) != 0;
 
     /* Send MOSI. */
-    eb_writel(eb, CSR_AD9361_SPI_MOSI_ADDR, mosi[0] << 16 | mosi[1] << 8 | mosi[2]);
+    m2sdr_ad9361_spi_pack(len, mosi, words);
+    for (i = 0; i < AD9361_SPI_MOSI_WORDS; i++)
+        eb_writel(eb, CSR_AD9361_SPI_MOSI_ADDR + 4*i, words[i]);
 
     /* Start SPI. */
-    eb_writel(eb, CSR_AD9361_SPI_CONTROL_ADDR, 24*SPI_CONTROL_LENGTH | SPI_CONTROL_START);
+    eb_writel(eb, CSR_AD9361_SPI_CONTROL_ADDR, 8*len*SPI_CONTROL_LENGTH | SPI_CONTROL_START);
 
     /* Wait done. */
 #ifdef AD9361_SPI_WAIT_DONE
@@ -138,9 +265,12 @@ void m2sdr_ad9361_eb_spi_xfer(struct eb_connection *eb, uint8_t len, uint8_t *mo
 #endif
 
     /* Read MISO if read. */
-    miso[2] = 0;
+    for (i = 2; i < len; i++)
+        miso[i] = 0;
     if (!is_write) {
-        miso[2] = eb_read32(eb, CSR_AD9361_SPI_MISO_ADDR) & 0xff;
+        for (i = 0; i < AD9361_SPI_MISO_WORDS; i++)
+            words[i] = eb_read32(eb, CSR_AD9361_SPI_MISO_ADDR + 4*i);
+        m2sdr_ad9361_spi_unpack(len, words, miso);
     }
 }
 
@@ -185,3 +315,55 @@ uint8_t m2sdr_ad9361_eb_spi_read(struct eb_connection *eb, uint16_t reg) {
 
     return dat;
 }
+
+/* Write n registers from reg down to reg-n+1 (AD9361 multi-byte write). */
+void m2sdr_ad9361_eb_spi_writem(struct eb_connection *eb, uint16_t reg, const uint8_t *buf, uint8_t n) {
+    uint8_t mosi[AD9361_SPI_XFER_BYTES];
+    uint8_t miso[AD9361_SPI_XFER_BYTES];
+    uint8_t burst;
+    int i;
+
+    while (n > 0) {
+        burst = (n < AD9361_SPI_XFER_BYTES - 2) ? n : AD9361_SPI_XFER_BYTES - 2;
+
+        /* Prepare Data. */
+        m2sdr_ad9361_spi_cmd(mosi, 1, reg, burst);
+        for (i = 0; i < burst; i++)
+            mosi[2 + i] = buf[i];
+
+        /* Do SPI Xfer. */
+        m2sdr_ad9361_eb_spi_xfer(eb, 2 + burst, mosi, miso);
+
+        reg -= burst;
+        buf += burst;
+        n   -= burst;
+    }
+}
+
+/* Read n registers from reg down to reg-n+1 (AD9361 multi-byte read). */
+void m2sdr_ad9361_eb_spi_readm(struct eb_connection *eb, uint16_t reg, uint8_t *buf, uint8_t n) {
+    uint8_t mosi[AD9361_SPI_XFER_BYTES];
+    uint8_t miso[AD9361_SPI_XFER_BYTES];
+    uint8_t burst;
+    int i;
+
+    while (n > 0) {
+        burst = (n < AD9361_SPI_XFER_BYTES - 2) ? n : AD9361_SPI_XFER_BYTES - 2;
+
+        /* Prepare Data. */
+        m2sdr_ad9361_spi_cmd(mosi, 0, reg, burst);
+        for (i = 0; i < burst; i++)
+            mosi[2 + i] = 0x00;
+
+        /* Do SPI Xfer. */
+        m2sdr_ad9361_eb_spi_xfer(eb, 2 + burst, mosi, miso);
+
+        /* Process Data. */
+        for (i = 0; i < burst; i++)
+            buf[i] = miso[2 + i];
+
+        reg -= burst;
+        buf += burst;
+        n   -= burst;
+    }
+}
@@ -24,6 +24,16 @@
 #define SPI_CONTROL_LENGTH (1 << 8)
 #define SPI_STATUS_DONE    (1 << 0)
 
+/* AD9361 multi-byte transfers: 16-bit instruction + up to 8 data bytes (MAX_MBYTE_SPI), address
+ * decremented after each byte. Done in a single SPI transfer with gateware exposing the wide
+ * (80-bit) SPI core, split in single-byte transfers with the 24-bit one. */
+#define AD9361_SPI_MAX_BURST 8
+#if CSR_AD9361_SPI_MOSI_SIZE > 1
+#define AD9361_SPI_XFER_BYTES (2 + AD9361_SPI_MAX_BURST)
+#else
+#define AD9361_SPI_XFER_BYTES 3
+#endif
+
 /* PCIe SPI functions */
 /*---------------*/
 
@@ -31,6 +41,8 @@ void m2sdr_ad9361_spi_init(int fd, uint8_t reset);
 void m2sdr_ad9361_spi_xfer(int fd, uint8_t len, uint8_t *mosi, uint8_t *miso);
 void m2sdr_ad9361_spi_write(int fd, uint16_t reg, uint8_t dat);
 uint8_t m2sdr_ad9361_spi_read(int fd, uint16_t reg);
+void m2sdr_ad9361_spi_writem(int fd, uint16_t reg, const uint8_t *buf, uint8_t n);
+void m2sdr_ad9361_spi_readm(int fd, uint16_t reg, uint8_t *buf, uint8_t n);
 
 /* Etherbone SPI functions */
 /*-------------------------*/
@@ -39,5 +51,7 @@ void m2sdr_ad9361_eb_spi_init(struct eb_connection *fd, uint8_t reset);
 void m2sdr_ad9361_eb_spi_xfer(struct eb_connection *eb, uint8_t len, uint8_t *mosi, uint8_t *miso);
 void m2sdr_ad9361_eb_spi_write(struct eb_connection *eb, uint16_t reg, uint8_t dat);
 uint8_t m2sdr_ad9361_eb_spi_read(struct eb_connection *eb, uint16_t reg);
+void m2sdr_ad9361_eb_spi_writem(struct eb_connection *eb, uint16_t reg, const uint8_t *buf, uint8_t n);
+void m2sdr_ad9361_eb_spi_readm(struct eb_connection *eb, uint16_t reg, uint8_t *buf, uint8_t n);
 
 #endif /* M2SDR_LIB_AD9361_SPI_H */
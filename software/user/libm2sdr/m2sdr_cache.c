@@ -0,0 +1,104 @@
+/*
+ * LiteX-M2SDR library
+ *
+ * This file is part of LiteX-M2SDR project.
+ *
+ * Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "m2sdr_cache.h"
+
+/* Private Functions */
+
+static int m2sdr_cache_mkdir(const char *path) {
+    if (mkdir(path, 0755) < 0 && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+/* Public Functions */
+
+uint64_t m2sdr_cache_hash(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *p = data;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL; /* FNV-1a prime */
+    }
+
+    return hash;
+}
+
+int m2sdr_cache_path(char *path, size_t path_size, const char *serial, const char *name, uint64_t key) {
+    const char *xdg  = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char base[512];
+    char dir[1024];
+
+    /* Cache directory. */
+    if (xdg && xdg[0]) {
+        snprintf(base, sizeof(base), "%s", xdg);
+    } else if (home && home[0]) {
+        snprintf(base, sizeof(base), "%s/.cache", home);
+        if (m2sdr_cache_mkdir(base) < 0)
+            return -1;
+    } else {
+        return -1;
+    }
+    snprintf(dir, sizeof(dir), "%s/%s", base, M2SDR_CACHE_DIR);
+    if (m2sdr_cache_mkdir(dir) < 0)
+        return -1;
+
+    /* Cache file. */
+    if (snprintf(path, path_size, "%s/%s-%s-%016" PRIx64 ".bin", dir, serial, name, key) >= (int)path_size)
+        return -1;
+
+    return 0;
+}
+
+int m2sdr_cache_load(const char *path, void *data, size_t size) {
+    FILE *f;
+    size_t n;
+    int c;
+
+    f = fopen(path, "rb");
+    if (!f)
+        return -1;
+    n = fread(data, 1, size, f);
+    c = fgetc(f);
+    fclose(f);
+
+    /* Reject truncated/oversized files (other layout). */
+    if (n != size || c != EOF)
+        return -1;
+
+    return 0;
+}
+
+int m2sdr_cache_save(const char *path, const void *data, size_t size) {
+    char tmp[1100];
+    FILE *f;
+    size_t n;
+
+    /* Write to a temporary file and rename it (readers never see a partial file). */
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+    f = fopen(tmp, "wb");
+    if (!f)
+        return -1;
+    n = fwrite(data, 1, size, f);
+    if (fclose(f) != 0 || n != size || rename(tmp, path) < 0) {
+        unlink(tmp);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * LiteX-M2SDR library
+ *
+ * This file is part of LiteX-M2SDR project.
+ *
+ * Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef M2SDR_LIB_CACHE_H
+#define M2SDR_LIB_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Persistent cache: binary blobs (AD9361 snapshots, calibrations...) stored per board in
+ * $XDG_CACHE_HOME/m2sdr (~/.cache/m2sdr by default), keyed by the board serial, a name and a
+ * profile key (hash of the configuration the blob depends on). */
+
+/* Cache Constants */
+/*-----------------*/
+
+#define M2SDR_CACHE_DIR       "m2sdr"
+#define M2SDR_CACHE_HASH_INIT 0xcbf29ce484222325ULL /* FNV-1a offset basis */
+
+/* Cache functions */
+/*-----------------*/
+
+/* FNV-1a hash, to build profile keys (start with M2SDR_CACHE_HASH_INIT). */
+uint64_t m2sdr_cache_hash(uint64_t hash, const void *data, size_t size);
+/* Build the cache file path (and create the cache directory), 0 on success. */
+int m2sdr_cache_path(char *path, size_t path_size, const char *serial, const char *name, uint64_t key);
+/* Load a blob of exactly size bytes, 0 on success. */
+int m2sdr_cache_load(const char *path, void *data, size_t size);
+/* Save a blob (atomically replaces the previous one), 0 on success. */
+int m2sdr_cache_save(const char *path, const void *data, size_t size);
+
+#endif /* M2SDR_LIB_CACHE_H */
@@ -0,0 +1,211 @@
+/*
+ * LiteX-M2SDR library
+ *
+ * This file is part of LiteX-M2SDR project.
+ *
+ * Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "liblitepcie.h"
+
+#include "m2sdr_shm.h"
+
+/* Private Functions */
+
+static long m2sdr_shm_futex(uint32_t *uaddr, int op, uint32_t val, const struct timespec *timeout) {
+    return syscall(SYS_futex, uaddr, op, val, timeout, NULL, 0);
+}
+
+static void m2sdr_shm_client_update(struct m2sdr_shm_client *client) {
+    __atomic_store_n(&client->shm->clients[client->slot].cursor, client->cursor, __ATOMIC_RELAXED);
+}
+
+static void m2sdr_shm_client_overflow(struct m2sdr_shm_client *client, int64_t lost) {
+    __atomic_add_fetch(&client->shm->clients[client->slot].overflows, lost, __ATOMIC_RELAXED);
+}
+
+/* Public Functions */
+
+/* Server */
+/*--------*/
+
+void m2sdr_shm_notify(struct m2sdr_shm *shm) {
+    __atomic_add_fetch(&shm->seq, 1, __ATOMIC_RELEASE);
+    m2sdr_shm_futex(&shm->seq, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+/* Client */
+/*--------*/
+
+struct m2sdr_shm_client *m2sdr_shm_client_open(int device_num) {
+    struct m2sdr_shm_client *client;
+    struct litepcie_ioctl_mmap_dma_info info;
+    char name[1024];
+    int shm_fd;
+    int i;
+
+    client = calloc(1, sizeof(*client));
+    if (!client)
+        return NULL;
+    client->fd   = -1;
+    client->slot = -1;
+
+    /* Attach to the server shared-memory. */
+    snprintf(name, sizeof(name), M2SDR_SHM_NAME, device_num);
+    shm_fd = shm_open(name, O_RDWR, 0);
+    if (shm_fd < 0) {
+        fprintf(stderr, "Could not open %s (m2sdr_server not running?)\n", name);
+        goto fail;
+    }
+    client->shm = mmap(NULL, sizeof(struct m2sdr_shm), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (client->shm == MAP_FAILED) {
+        client->shm = NULL;
+        fprintf(stderr, "MMAP failed\n");
+        goto fail;
+    }
+    if (client->shm->magic   != M2SDR_SHM_MAGIC   ||
+        client->shm->version != M2SDR_SHM_VERSION ||
+        client->shm->server_pid == 0) {
+        fprintf(stderr, "%s: no server\n", name);
+        goto fail;
+    }
+
+    /* Map the RX DMA buffers of the device (read-only, no DMA lock required). */
+    snprintf(name, sizeof(name), "/dev/m2sdr%d", device_num);
+    client->fd = open(name, O_RDONLY | O_CLOEXEC);
+    if (client->fd < 0) {
+        fprintf(stderr, "Could not open %s\n", name);
+        goto fail;
+    }
+    checked_ioctl(client->fd, LITEPCIE_IOCTL_MMAP_DMA_INFO, &info);
+
+    /* Validate the buffers geometry published by the server against the device and the mapping. */
+    client->buf_size  = client->shm->buf_size;
+    client->buf_count = client->shm->buf_count;
+    if (client->buf_count == 0 || client->buf_count > DMA_BUFFER_COUNT ||
+        client->buf_size  != info.dma_rx_buf_size ||
+        client->buf_count != info.dma_rx_buf_count ||
+        (uint64_t)client->buf_count * client->buf_size > DMA_BUFFER_TOTAL_SIZE) {
+        fprintf(stderr, "%s: invalid shared-memory buffers geometry\n", name);
+        goto fail;
+    }
+
+    client->buf = mmap(NULL, DMA_BUFFER_TOTAL_SIZE, PROT_READ, MAP_SHARED, client->fd, info.dma_rx_buf_offset);
+    if (client->buf == MAP_FAILED) {
+        client->buf = NULL;
+        fprintf(stderr, "MMAP failed\n");
+        goto fail;
+    }
+
+    /* Register in a free client slot, starting from the latest DMA buffer. */
+    for (i = 0; i < M2SDR_SHM_MAX_CLIENTS; i++) {
+        if (__sync_bool_compare_and_swap(&client->shm->clients[i].pid, 0, getpid())) {
+            client->slot = i;
+            break;
+        }
+    }
+    if (client->slot < 0) {
+        fprintf(stderr, "Too many clients (max: %d)\n", M2SDR_SHM_MAX_CLIENTS);
+        goto fail;
+    }
+    client->shm->clients[client->slot].overflows = 0;
+    m2sdr_shm_client_flush(client);
+
+    return client;
+
+fail:
+    m2sdr_shm_client_close(client);
+    return NULL;
+}
+
+void m2sdr_shm_client_close(struct m2sdr_shm_client *client) {
+    if (!client)
+        return;
+    if (client->slot >= 0)
+        __atomic_store_n(&client->shm->clients[client->slot].pid, 0, __ATOMIC_RELEASE);
+    if (client->buf)
+        munmap(client->buf, DMA_BUFFER_TOTAL_SIZE);
+    if (client->fd >= 0)
+        close(client->fd);
+    if (client->shm)
+        munmap(client->shm, sizeof(struct m2sdr_shm));
+    free(client);
+}
+
+/* Skip the pending RX DMA buffers (restart from the latest one). */
+void m2sdr_shm_client_flush(struct m2sdr_shm_client *client) {
+    client->cursor = __atomic_load_n(&client->shm->hw_count, __ATOMIC_ACQUIRE);
+    m2sdr_shm_client_update(client);
+}
+
+/* Get the next RX DMA buffer (NULL on timeout or when the server is stopped). */
+const char *m2sdr_shm_client_acquire(struct m2sdr_shm_client *client, int64_t *time_ns, int timeout_ms) {
+    struct m2sdr_shm *shm = client->shm;
+    int64_t index;
+    struct timespec timeout;
+    uint32_t seq;
+    int64_t hw_count;
+    int i;
+
+    timeout.tv_sec  = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+
+    for (i = 0; i < 2; i++) {
+        seq      = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+        hw_count = __atomic_load_n(&shm->hw_count, __ATOMIC_ACQUIRE);
+
+        /* Detect overflows (buffers possibly overwritten by the DMA), restart from the latest buffer. */
+        if ((hw_count - client->cursor) > (int64_t)(client->buf_count/2)) {
+            m2sdr_shm_client_overflow(client, hw_count - client->cursor);
+            client->cursor = hw_count;
+            m2sdr_shm_client_update(client);
+        }
+
+        /* Return the buffer. */
+        if (client->cursor < hw_count) {
+            index = client->cursor % client->buf_count;
+            if (time_ns)
+                *time_ns = shm->buf_time[client->cursor % DMA_BUFFER_COUNT];
+            return client->buf + index * client->buf_size;
+        }
+
+        /* Wait for new buffers. */
+        if (__atomic_load_n(&shm->server_pid, __ATOMIC_ACQUIRE) == 0 || timeout_ms == 0)
+            break;
+        m2sdr_shm_futex(&shm->seq, FUTEX_WAIT, seq, &timeout);
+    }
+
+    return NULL;
+}
+
+/* Release the current RX DMA buffer (-1 if it has been overwritten by the DMA while in use). */
+int m2sdr_shm_client_release(struct m2sdr_shm_client *client) {
+    struct m2sdr_shm *shm = client->shm;
+    int64_t hw_count = __atomic_load_n(&shm->hw_count, __ATOMIC_ACQUIRE);
+    int ret = 0;
+
+    if ((hw_count - client->cursor) > (int64_t)(client->buf_count/2)) {
+        m2sdr_shm_client_overflow(client, 1);
+        ret = -1;
+    }
+    client->cursor++;
+    m2sdr_shm_client_update(client);
+
+    return ret;
+}
+
+uint64_t m2sdr_shm_client_overflows(struct m2sdr_shm_client *client) {
+    return __atomic_load_n(&client->shm->clients[client->slot].overflows, __ATOMIC_RELAXED);
+}
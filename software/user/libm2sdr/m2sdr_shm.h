@@ -0,0 +1,78 @@
+/*
+ * LiteX-M2SDR library
+ *
+ * This file is part of LiteX-M2SDR project.
+ *
+ * Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef M2SDR_LIB_SHM_H
+#define M2SDR_LIB_SHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "litepcie.h"
+
+/* Shared-memory RX distribution (m2sdr_server): the server owns the DMA Writer and publishes the
+ * DMA counters/timestamps in a POSIX shared-memory segment; clients mmap the RX DMA buffers of the
+ * devnode read-only (zero-copy) and follow the DMA with their own cursor and overflow accounting. */
+
+/* SHM Constants */
+/*---------------*/
+
+#define M2SDR_SHM_NAME        "/m2sdr_server%d"
+#define M2SDR_SHM_MAGIC       0x4d325348 /* "M2SH" */
+#define M2SDR_SHM_VERSION     1
+#define M2SDR_SHM_MAX_CLIENTS 16
+
+/* SHM Layout */
+/*------------*/
+
+struct m2sdr_shm_client_slot {
+    int32_t  pid;       /* Client PID (0: free slot) */
+    uint32_t reserved;
+    int64_t  cursor;    /* Next DMA buffer to read */
+    uint64_t overflows; /* DMA buffers lost by this client */
+};
+
+struct m2sdr_shm {
+    uint32_t magic;
+    uint32_t version;
+    int32_t  server_pid;                 /* 0 when the server is stopped */
+    uint32_t seq;                        /* Incremented on each update (futex word) */
+    uint32_t buf_size;
+    uint32_t buf_count;
+    int64_t  hw_count;                   /* DMA buffers published */
+    int64_t  buf_time[DMA_BUFFER_COUNT]; /* Time (ns) at the end of each DMA buffer */
+    struct m2sdr_shm_client_slot clients[M2SDR_SHM_MAX_CLIENTS];
+};
+
+/* SHM Server functions */
+/*----------------------*/
+
+void m2sdr_shm_notify(struct m2sdr_shm *shm);
+
+/* SHM Client functions */
+/*----------------------*/
+
+struct m2sdr_shm_client {
+    int fd;
+    int slot;
+    int64_t cursor;
+    uint32_t buf_size;  /* DMA buffers geometry, validated at attach (never re-read from shm) */
+    uint32_t buf_count;
+    struct m2sdr_shm *shm;
+    char *buf;
+};
+
+struct m2sdr_shm_client *m2sdr_shm_client_open(int device_num);
+void m2sdr_shm_client_close(struct m2sdr_shm_client *client);
+void m2sdr_shm_client_flush(struct m2sdr_shm_client *client);
+/* One buffer at a time: acquire returns the same buffer until it is released. */
+const char *m2sdr_shm_client_acquire(struct m2sdr_shm_client *client, int64_t *time_ns, int timeout_ms);
+int m2sdr_shm_client_release(struct m2sdr_shm_client *client);
+uint64_t m2sdr_shm_client_overflows(struct m2sdr_shm_client *client);
+
+#endif /* M2SDR_LIB_SHM_H */
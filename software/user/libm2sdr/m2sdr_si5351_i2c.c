@@ -8,6 +8,10 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
 
 #include "liblitepcie.h"
 
@@ -15,12 +19,48 @@
 
 #ifdef CSR_SI5351_I2C_W_ADDR
 
-extern void nanosleep(int n);
-
 /* Private Functions */
 
+/* Quarter of SCL period (250kHz SCL): busy-wait, CSR accesses can be faster than the I2C timings
+ * (MMIO CSR backend). */
+#define SI5351_I2C_DELAY_NS 1000
+
 static void si5351_i2c_delay(int n) {
-	nanosleep(n);
+	struct timespec t0, t;
+	int64_t elapsed;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		elapsed = (int64_t)(t.tv_sec - t0.tv_sec) * 1000000000 + (t.tv_nsec - t0.tv_nsec);
+	} while (elapsed < (int64_t)n * SI5351_I2C_DELAY_NS);
+}
+
+/* Whole I2C transaction in the kernel (LITEPCIE_IOCTL_I2C): 1 on success, 0 on NACK, -1 when
+ * not supported by the driver (bit-banged from user-space then). */
+static int si5351_i2c_xfer(int fd, uint8_t slave_addr, uint8_t addr, uint8_t *data, uint32_t len,
+	bool is_read, bool send_stop)
+{
+	struct litepcie_ioctl_i2c m;
+
+	memset(&m, 0, sizeof(m));
+	m.slave_addr = slave_addr;
+	m.addr       = addr;
+	m.is_read    = is_read;
+	m.send_stop  = send_stop;
+	m.len        = len;
+	if (!is_read)
+		memcpy(m.data, data, len);
+
+	if (ioctl(fd, LITEPCIE_IOCTL_I2C, &m) < 0) {
+		if (errno == ENXIO)
+			return 0;
+		return -1;
+	}
+	if (is_read)
+		memcpy(data, m.data, len);
+
+	return 1;
 }
 
 static inline void si5351_i2c_oe_scl_sda(int fd, bool oe, bool scl, bool sda)
@@ -145,6 +185,14 @@ void m2sdr_si5351_i2c_reset(int fd)
 bool m2sdr_si5351_i2c_read(int fd, uint8_t slave_addr, uint8_t addr, uint8_t *data, uint32_t len, bool send_stop)
 {
 	int i;
+	int ret;
+
+	/* Kernel transactions (LITEPCIE_I2C_MAX_LEN bytes max each). */
+	if (len <= LITEPCIE_I2C_MAX_LEN) {
+		ret = si5351_i2c_xfer(fd, slave_addr, addr, data, len, true, send_stop);
+		if (ret >= 0)
+			return ret;
+	}
 
 	si5351_i2c_start(fd);
 
@@ -184,6 +232,14 @@ bool m2sdr_si5351_i2c_read(int fd, uint8_t slave_addr, uint8_t addr, uint8_t *da
 bool m2sdr_si5351_i2c_write(int fd, uint8_t slave_addr, uint8_t addr, const uint8_t *data, uint32_t len)
 {
 	int i;
+	int ret;
+
+	/* Kernel transactions (LITEPCIE_I2C_MAX_LEN bytes max each). */
+	if (len <= LITEPCIE_I2C_MAX_LEN) {
+		ret = si5351_i2c_xfer(fd, slave_addr, addr, (uint8_t *)data, len, false, false);
+		if (ret >= 0)
+			return ret;
+	}
 
 	si5351_i2c_start(fd);
 
@@ -245,19 +301,97 @@ void m2sdr_si5351_i2c_scan(int fd)
 
 /*
  * I2C Config
+ *
+ * Incremental: the current values of the registers of the config are read back (consecutive
+ * registers in a single transaction) and only the registers that differ are written. The PLLs are
+ * only reset when their parameters, their input or the multisynths have changed, so switching the
+ * reference doesn't disturb the unaffected outputs. Returns the number of registers written.
  */
 
-void m2sdr_si5351_i2c_config(int fd, uint8_t i2c_addr, const uint8_t i2c_config[][2], size_t i2c_length)
+#define SI5351_REG_CLK_IN_CONFIG   0x0f
+#define SI5351_REG_PLLA_FIRST      0x1a
+#define SI5351_REG_PLLA_LAST       0x21
+#define SI5351_REG_PLLB_FIRST      0x22
+#define SI5351_REG_PLLB_LAST       0x29
+#define SI5351_REG_MS_FIRST        0x2a
+#define SI5351_REG_MS_LAST         0x5b
+#define SI5351_REG_PLL_RESET       0xb1
+#define SI5351_PLL_RESET_A         0x20
+#define SI5351_PLL_RESET_B         0x80
+
+/* Number of consecutive registers of the config from index i (single I2C transaction). */
+static size_t si5351_i2c_config_run(const uint8_t i2c_config[][2], size_t i2c_length, size_t i)
 {
-	int i;
-    for (i=0; i<i2c_length; i++) {
-        uint8_t addr = i2c_config[i][0];
-        uint8_t data = i2c_config[i][1];
-        if (!m2sdr_si5351_i2c_write(fd, i2c_addr, addr, &data, 1)) {
-            fprintf(stderr, "Failed to write to SI5351 at register 0x%02X\n", addr);
-        }
-    }
+	size_t n;
+
+	for (n = 1; (i + n) < i2c_length && n < LITEPCIE_I2C_MAX_LEN; n++)
+		if (i2c_config[i + n][0] != (uint8_t)(i2c_config[i][0] + n))
+			break;
+	return n;
 }
 
+static uint8_t si5351_i2c_config_pll_reset(uint8_t addr)
+{
+	if (addr >= SI5351_REG_PLLA_FIRST && addr <= SI5351_REG_PLLA_LAST)
+		return SI5351_PLL_RESET_A;
+	if (addr >= SI5351_REG_PLLB_FIRST && addr <= SI5351_REG_PLLB_LAST)
+		return SI5351_PLL_RESET_B;
+	if (addr == SI5351_REG_CLK_IN_CONFIG ||
+	   (addr >= SI5351_REG_MS_FIRST && addr <= SI5351_REG_MS_LAST))
+		return SI5351_PLL_RESET_A | SI5351_PLL_RESET_B;
+	return 0;
+}
+
+int m2sdr_si5351_i2c_config(int fd, uint8_t i2c_addr, const uint8_t i2c_config[][2], size_t i2c_length)
+{
+	size_t i, j, n;
+	uint8_t current[256];
+	uint8_t valid[256] = {0};
+	uint8_t data[LITEPCIE_I2C_MAX_LEN];
+	uint8_t pll_reset = 0;
+	int written = 0;
+
+	/* Read back the current values (registers not read back are always written). */
+	for (i = 0; i < i2c_length; i += n) {
+		n = si5351_i2c_config_run(i2c_config, i2c_length, i);
+		if (!m2sdr_si5351_i2c_read(fd, i2c_addr, i2c_config[i][0], data, n, false))
+			continue;
+		for (j = 0; j < n; j++) {
+			current[i2c_config[i + j][0]] = data[j];
+			valid[i2c_config[i + j][0]]   = 1;
+		}
+	}
+
+	/* Write the consecutive changed registers in single transactions. */
+	for (i = 0; i < i2c_length; i += n) {
+		uint8_t addr = i2c_config[i][0];
+		for (n = 0; (i + n) < i2c_length && n < LITEPCIE_I2C_MAX_LEN; n++) {
+			uint8_t reg = i2c_config[i + n][0];
+			if (reg != (uint8_t)(addr + n))
+				break;
+			if (valid[reg] && current[reg] == i2c_config[i + n][1])
+				break;
+			data[n] = i2c_config[i + n][1];
+			pll_reset |= si5351_i2c_config_pll_reset(reg);
+		}
+		if (n == 0) {
+			n = 1; /* Unchanged. */
+			continue;
+		}
+		if (!m2sdr_si5351_i2c_write(fd, i2c_addr, addr, data, n)) {
+			fprintf(stderr, "Failed to write to SI5351 at register 0x%02X\n", addr);
+			continue;
+		}
+		written += n;
+	}
+
+	/* Reset the PLLs affected by the changes. */
+	if (pll_reset) {
+		if (!m2sdr_si5351_i2c_write(fd, i2c_addr, SI5351_REG_PLL_RESET, &pll_reset, 1))
+			fprintf(stderr, "Failed to write to SI5351 at register 0x%02X\n", SI5351_REG_PLL_RESET);
+	}
+
+	return written;
+}
 
 #endif
\ No newline at end of file
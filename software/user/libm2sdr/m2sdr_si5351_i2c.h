@@ -23,6 +23,6 @@ bool m2sdr_si5351_i2c_write(int fd, uint8_t slave_addr, uint8_t addr, const uint
 bool m2sdr_si5351_i2c_read(int fd,  uint8_t slave_addr, uint8_t addr, uint8_t *data, uint32_t len, bool send_stop);
 bool m2sdr_si5351_i2c_poll(int fd,  uint8_t slave_addr);
 void m2sdr_si5351_i2c_scan(int fd);
-void m2sdr_si5351_i2c_config(int fd, uint8_t i2c_addr, const uint8_t i2c_config[][2], size_t i2c_length);
+int m2sdr_si5351_i2c_config(int fd, uint8_t i2c_addr, const uint8_t i2c_config[][2], size_t i2c_length);
 
 #endif /* M2SDR_LIB_SI5351_I2C_H */
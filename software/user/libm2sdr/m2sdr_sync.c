@@ -0,0 +1,249 @@
+/*
+ * LiteX-M2SDR library
+ *
+ * This file is part of LiteX-M2SDR project.
+ *
+ * Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/ioctl.h>
+
+#include "liblitepcie.h"
+
+#include "m2sdr_sync.h"
+
+#define M2SDR_SYNC_MEASURE_TRIES 8
+
+/* Private Functions */
+
+static void m2sdr_sync_sleep_ns(uint64_t ns) {
+    struct timespec ts;
+    ts.tv_sec  = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    nanosleep(&ts, NULL);
+}
+
+/* Time accesses go through LITEPCIE_IOCTL_TIME, serialized in the driver with the PTP Hardware Clock
+ * and the DMA MSI timestamps. Direct CSR accesses are only used as fallback with older drivers. */
+static int m2sdr_time_ioctl(int fd, uint32_t op, int64_t value, struct litepcie_ioctl_time *m) {
+    memset(m, 0, sizeof(*m));
+    m->op    = op;
+    m->value = value;
+    return ioctl(fd, LITEPCIE_IOCTL_TIME, m);
+}
+
+static void m2sdr_time_adjustment_write(int fd, int64_t adjustment_ns) {
+    struct litepcie_ioctl_time m;
+    if (m2sdr_time_ioctl(fd, LITEPCIE_TIME_OP_SET_ADJUSTMENT, adjustment_ns, &m) == 0)
+        return;
+    litepcie_writel(fd, CSR_TIME_GEN_TIME_ADJUSTMENT_ADDR + 0, (uint32_t)(((uint64_t)adjustment_ns >> 32) & 0xffffffff));
+    litepcie_writel(fd, CSR_TIME_GEN_TIME_ADJUSTMENT_ADDR + 4, (uint32_t)(((uint64_t)adjustment_ns >>  0) & 0xffffffff));
+}
+
+static int64_t m2sdr_time_adjustment_read(int fd) {
+    uint64_t adjustment_ns = 0;
+    adjustment_ns |= ((uint64_t)litepcie_readl(fd, CSR_TIME_GEN_TIME_ADJUSTMENT_ADDR + 0)) << 32;
+    adjustment_ns |= ((uint64_t)litepcie_readl(fd, CSR_TIME_GEN_TIME_ADJUSTMENT_ADDR + 4)) <<  0;
+    return (int64_t)adjustment_ns;
+}
+
+static void m2sdr_time_adjustment_add(int fd, int64_t delta_ns) {
+    struct litepcie_ioctl_time m;
+    /* Read-modify-write done by the driver: composes with the PHC adjustments. */
+    if (m2sdr_time_ioctl(fd, LITEPCIE_TIME_OP_ADD_ADJUSTMENT, delta_ns, &m) == 0)
+        return;
+    m2sdr_time_adjustment_write(fd, m2sdr_time_adjustment_read(fd) + delta_ns);
+}
+
+static uint64_t m2sdr_pps_phase(uint64_t time_ns) {
+    return (time_ns + M2SDR_PPS_PERIOD_NS - M2SDR_PPS_OFFSET_NS) % M2SDR_PPS_PERIOD_NS;
+}
+
+/* Public Functions */
+
+/* Time */
+/*------*/
+
+uint64_t m2sdr_time_read(int fd) {
+    struct litepcie_ioctl_time m;
+    struct litepcie_reg_op ops[4] = {
+        /* Latch the 64-bit Time (ns) by pulsing READ bit of Control Register. */
+        {LITEPCIE_REG_OP_WRITE, CSR_TIME_GEN_CONTROL_ADDR,
+            (1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET) | (1 << CSR_TIME_GEN_CONTROL_READ_OFFSET), 0},
+        {LITEPCIE_REG_OP_WRITE, CSR_TIME_GEN_CONTROL_ADDR,
+            (1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET), 0},
+        /* Read the upper/lower 32 bits of the 64-bit Time (ns). */
+        {LITEPCIE_REG_OP_READ, CSR_TIME_GEN_READ_TIME_ADDR + 0, 0, 0},
+        {LITEPCIE_REG_OP_READ, CSR_TIME_GEN_READ_TIME_ADDR + 4, 0, 0},
+    };
+
+    if (m2sdr_time_ioctl(fd, LITEPCIE_TIME_OP_READ, 0, &m) == 0)
+        return (uint64_t)m.time;
+
+    /* Single register batch: keeps the latch/read sequence short and deterministic. */
+    litepcie_reg_batch(fd, ops, 4, 0);
+
+    return ((uint64_t)ops[2].val << 32) | ops[3].val;
+}
+
+void m2sdr_time_write(int fd, uint64_t time_ns) {
+    struct litepcie_ioctl_time m;
+
+    if (m2sdr_time_ioctl(fd, LITEPCIE_TIME_OP_WRITE, (int64_t)time_ns, &m) == 0)
+        return;
+
+    /* Write the 64-bit Time (ns). */
+    litepcie_writel(fd, CSR_TIME_GEN_WRITE_TIME_ADDR + 0, (uint32_t)((time_ns >> 32) & 0xffffffff));
+    litepcie_writel(fd, CSR_TIME_GEN_WRITE_TIME_ADDR + 4, (uint32_t)((time_ns >>  0) & 0xffffffff));
+
+    /* Pulse the WRITE bit of Control Register. */
+    litepcie_writel(fd, CSR_TIME_GEN_CONTROL_ADDR,
+        (1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET) |
+        (1 << CSR_TIME_GEN_CONTROL_WRITE_OFFSET));
+    litepcie_writel(fd, CSR_TIME_GEN_CONTROL_ADDR,
+        (1 << CSR_TIME_GEN_CONTROL_ENABLE_OFFSET));
+}
+
+/* Multi-board Sync */
+/*------------------*/
+
+int m2sdr_sync_check_clkin(int *fds, int n) {
+    int mask = 0;
+#ifdef CSR_SI5351_CONTROL_ADDR
+    int i;
+    uint32_t control;
+    for (i = 0; i < n; i++) {
+        control = litepcie_readl(fds[i], CSR_SI5351_CONTROL_ADDR);
+        /* SI5351C Version with 10MHz ClkIn from uFL. */
+        if (!(control & (1 << CSR_SI5351_CONTROL_VERSION_OFFSET)) ||
+            !(control & (1 << CSR_SI5351_CONTROL_CLK_IN_SRC_OFFSET)))
+            mask |= (1 << i);
+    }
+#else
+    mask = (1 << n) - 1;
+#endif
+    return mask;
+}
+
+uint64_t m2sdr_sync_measure(int *fds, int n, int64_t *offsets_ns) {
+    int i, j;
+    uint64_t t0a, t0b, ti;
+    uint64_t window, best_window;
+    uint64_t uncertainty = 0;
+
+    offsets_ns[0] = 0;
+    for (i = 1; i < n; i++) {
+        best_window = UINT64_MAX;
+        /* Bracket board i time read with two reads of the first board and keep the tightest one. */
+        for (j = 0; j < M2SDR_SYNC_MEASURE_TRIES; j++) {
+            t0a = m2sdr_time_read(fds[0]);
+            ti  = m2sdr_time_read(fds[i]);
+            t0b = m2sdr_time_read(fds[0]);
+            window = t0b - t0a;
+            if (window < best_window) {
+                best_window   = window;
+                offsets_ns[i] = (int64_t)(ti - (t0a + window/2));
+            }
+        }
+        if (best_window/2 > uncertainty)
+            uncertainty = best_window/2;
+    }
+
+    return uncertainty;
+}
+
+uint64_t m2sdr_sync_time(int *fds, int n, uint64_t time_ns, int64_t *offsets_ns) {
+    int i;
+    uint64_t max_offset = 0;
+
+    /* Clear Time Adjustments and write Time on all boards back-to-back (the residual offsets are
+     * measured and compensated below). */
+    for (i = 0; i < n; i++)
+        m2sdr_time_adjustment_write(fds[i], 0);
+    for (i = 0; i < n; i++)
+        m2sdr_time_write(fds[i], time_ns);
+
+    /* Measure residual offsets and compensate them with the Time Adjustments. */
+    m2sdr_sync_measure(fds, n, offsets_ns);
+    for (i = 1; i < n; i++)
+        m2sdr_time_adjustment_add(fds[i], -offsets_ns[i]);
+
+    /* Verify. */
+    m2sdr_sync_measure(fds, n, offsets_ns);
+    for (i = 1; i < n; i++) {
+        uint64_t offset = (uint64_t)llabs(offsets_ns[i]);
+        if (offset > max_offset)
+            max_offset = offset;
+    }
+
+    return max_offset;
+}
+
+uint64_t m2sdr_sync_next_pps(int fd) {
+    uint64_t time_ns = m2sdr_time_read(fd);
+    return time_ns - m2sdr_pps_phase(time_ns) + M2SDR_PPS_PERIOD_NS;
+}
+
+static uint64_t m2sdr_sync_wait_arm_window(int *fds, int n, uint64_t guard_ns) {
+    int i;
+    uint64_t phase;
+    uint64_t wait_ns;
+
+    for (;;) {
+        /* Arm window: from guard after a PPS edge to the middle of the second, on all boards. */
+        wait_ns = 0;
+        for (i = 0; i < n; i++) {
+            phase = m2sdr_pps_phase(m2sdr_time_read(fds[i]));
+            if (phase < guard_ns) {
+                if (guard_ns - phase > wait_ns)
+                    wait_ns = guard_ns - phase;
+            } else if (phase > M2SDR_PPS_PERIOD_NS/2) {
+                if (M2SDR_PPS_PERIOD_NS - phase + guard_ns > wait_ns)
+                    wait_ns = M2SDR_PPS_PERIOD_NS - phase + guard_ns;
+            }
+        }
+        if (wait_ns == 0)
+            break;
+        m2sdr_sync_sleep_ns(wait_ns);
+    }
+
+    return m2sdr_sync_next_pps(fds[0]);
+}
+
+uint64_t m2sdr_sync_dma_start(int *fds, int n, uint64_t guard_ns, uint8_t reader, uint8_t writer) {
+    int i;
+    int64_t hw_count, sw_count;
+    uint64_t pps_ns;
+
+    /* Wait for the arm window, then arm the DMAs on all boards back-to-back: the kernel DMA
+     * Synchronizer holds them until the next PPS edge. */
+    pps_ns = m2sdr_sync_wait_arm_window(fds, n, guard_ns);
+    for (i = 0; i < n; i++) {
+        if (writer)
+            litepcie_dma_writer(fds[i], 1, &hw_count, &sw_count);
+        if (reader)
+            litepcie_dma_reader(fds[i], 1, &hw_count, &sw_count);
+    }
+
+    /* Check all DMAs were armed before the PPS edge, stop them otherwise. */
+    for (i = 0; i < n; i++) {
+        if (m2sdr_time_read(fds[i]) < pps_ns)
+            continue;
+        for (i = 0; i < n; i++) {
+            if (writer)
+                litepcie_dma_writer(fds[i], 0, &hw_count, &sw_count);
+            if (reader)
+                litepcie_dma_reader(fds[i], 0, &hw_count, &sw_count);
+        }
+        return 0;
+    }
+
+    return pps_ns;
+}
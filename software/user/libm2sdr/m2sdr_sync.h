@@ -0,0 +1,51 @@
+/*
+ * LiteX-M2SDR library
+ *
+ * This file is part of LiteX-M2SDR project.
+ *
+ * Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef M2SDR_LIB_SYNC_H
+#define M2SDR_LIB_SYNC_H
+
+#include <stdint.h>
+
+#include "csr.h"
+#include "soc.h"
+
+/* Sync Constants */
+/*----------------*/
+
+#define M2SDR_SYNC_MAX_BOARDS   16
+#define M2SDR_PPS_PERIOD_NS     1000000000ULL
+#define M2SDR_PPS_OFFSET_NS      500000000ULL /* PPS rising edge position in the second (PPSGenerator offset). */
+
+/* Time functions */
+/*----------------*/
+
+uint64_t m2sdr_time_read(int fd);
+void m2sdr_time_write(int fd, uint64_t time_ns);
+
+/* Multi-board Sync functions */
+/*----------------------------*/
+
+/* Check the boards are clocked from the external 10MHz reference (SI5351C ClkIn from uFL). */
+int m2sdr_sync_check_clkin(int *fds, int n);
+
+/* Measure the time offset of each board vs the first one (returns the worst measurement uncertainty). */
+uint64_t m2sdr_sync_measure(int *fds, int n, int64_t *offsets_ns);
+
+/* Set identical hardware time on all boards; returns the max absolute residual offset (ns). */
+uint64_t m2sdr_sync_time(int *fds, int n, uint64_t time_ns, int64_t *offsets_ns);
+
+/* Time of the next PPS rising edge (DMA start) of a board. */
+uint64_t m2sdr_sync_next_pps(int fd);
+
+/* Start the DMAs (requested beforehand) of all boards on the same PPS edge: waits for the arm window
+ * (guard_ns after a PPS edge to the middle of the second) then arms them back-to-back. Returns the
+ * time of the PPS edge on which they start, or 0 (DMAs stopped) if the window was missed. */
+uint64_t m2sdr_sync_dma_start(int *fds, int n, uint64_t guard_ns, uint8_t reader, uint8_t writer);
+
+#endif /* M2SDR_LIB_SYNC_H */
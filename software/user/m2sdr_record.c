@@ -8,6 +8,7 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -16,6 +17,7 @@
 #include <fcntl.h>
 #include <math.h>
 #include <signal.h>
+#include <errno.h>
 
 #include "liblitepcie.h"
 
@@ -110,6 +112,114 @@ static void m2sdr_record(const char *device_name, const char *filename, uint32_t
         fclose(fo);
 }
 
+/* Record (DMA RX, splice) */
+/*-------------------------*/
+
+static void m2sdr_record_splice(const char *device_name, const char *filename, uint32_t size)
+{
+    int fd, fo;
+    int pipefd[2];
+    int i = 0;
+    ssize_t len, n;
+    size_t total_len = 0;
+    int64_t hw_count, sw_count;
+    int64_t last_time;
+    size_t total_len_last = 0;
+
+    /* Open File to write to (or /dev/null to monitor stream). */
+    fo = open(filename != NULL ? filename : "/dev/null", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fo < 0) {
+        perror(filename != NULL ? filename : "/dev/null");
+        exit(1);
+    }
+
+    /* Open device and request DMA Writer. */
+    fd = open(device_name, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open device\n");
+        exit(1);
+    }
+    if (litepcie_request_dma(fd, 0, 1) == 0) {
+        fprintf(stderr, "DMA not available\n");
+        exit(1);
+    }
+
+    /* Create pipe between DMA and File. */
+    if (pipe(pipefd) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    /* Start DMA Writer. */
+    litepcie_dma_writer(fd, 1, &hw_count, &sw_count);
+
+    /* Record Loop. */
+    last_time = get_time_ms();
+    for (;;) {
+        /* Exit loop on CTRL+C. */
+        if (!keep_running)
+            break;
+
+        /* Move DMA buffers to the pipe (copied once in the kernel, no user-space copy). */
+        len = splice(fd, NULL, pipefd[1], NULL, 16 * DMA_BUFFER_SIZE, SPLICE_F_MOVE);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("splice");
+            break;
+        }
+
+        /* Move pipe content to the File. */
+        while (len > 0) {
+            n = splice(pipefd[0], NULL, fo, NULL, len, SPLICE_F_MOVE);
+            if (n <= 0) {
+                perror("splice");
+                keep_running = 0;
+                break;
+            }
+            len -= n;
+            total_len += n;
+        }
+
+        /* Stop when specified size is reached */
+        if (size > 0 && total_len >= size)
+            keep_running = 0;
+
+        /* Statistics every 200ms. */
+        int64_t duration = get_time_ms() - last_time;
+        if (duration > 200) {
+            /* Print banner every 10 lines. */
+            if (i % 10 == 0)
+                printf("\e[1mSPEED(Gbps)    BUFFERS SIZE(MB)\e[0m\n");
+            i++;
+            /* Print statistics. */
+            printf("%10.2f %10" PRIu64 "  %8" PRIu64"\n",
+                    (double)(total_len - total_len_last) * 8 / ((double)duration * 1e6),
+                    (uint64_t)(total_len / DMA_BUFFER_SIZE),
+                    (uint64_t)(total_len / 1024 / 1024));
+            /* Update time/count. */
+            last_time = get_time_ms();
+            total_len_last = total_len;
+        }
+    }
+
+    /* Stop DMA Writer. */
+    litepcie_dma_writer(fd, 0, &hw_count, &sw_count);
+    litepcie_release_dma(fd, 0, 1);
+
+    /* Splicing is done in whole pages: truncate File to specified size. */
+    if (filename != NULL && size > 0 && total_len > size) {
+        if (ftruncate(fo, size) < 0)
+            perror("ftruncate");
+    }
+
+    /* Close Pipe/Device/File. */
+    close(pipefd[0]);
+    close(pipefd[1]);
+    close(fd);
+    close(fo);
+}
+
 /* Help */
 /*------*/
 
@@ -122,6 +232,7 @@ static void help(void)
            "-h                    Display this help message.\n"
            "-c device_num         Select the device (default = 0).\n"
            "-z                    Enable zero-copy DMA mode.\n"
+           "-s                    Use splice to move DMA buffers to file (kernel copy, no user-space copy).\n"
            "\n"
            "Arguments:\n"
            "filename              File to record I/Q samples to (optional, omit to monitor stream).\n"
@@ -138,15 +249,17 @@ int main(int argc, char **argv)
     static char litepcie_device[1024];
     static int litepcie_device_num;
     static uint8_t litepcie_device_zero_copy;
+    static uint8_t litepcie_device_splice;
 
     litepcie_device_num = 0;
     litepcie_device_zero_copy = 0;
+    litepcie_device_splice = 0;
 
     signal(SIGINT, intHandler);
 
     /* Parameters. */
     for (;;) {
-        c = getopt(argc, argv, "hc:z");
+        c = getopt(argc, argv, "hc:zs");
         if (c == -1)
             break;
         switch(c) {
@@ -159,6 +272,9 @@ int main(int argc, char **argv)
         case 'z':
             litepcie_device_zero_copy = 1;
             break;
+        case 's':
+            litepcie_device_splice = 1;
+            break;
         default:
             exit(1);
         }
@@ -176,7 +292,10 @@ int main(int argc, char **argv)
         filename = argv[optind++];
         size = strtoul(argv[optind++], NULL, 0);
     }
-    m2sdr_record(litepcie_device, filename, size, litepcie_device_zero_copy);
+    if (litepcie_device_splice)
+        m2sdr_record_splice(litepcie_device, filename, size);
+    else
+        m2sdr_record(litepcie_device, filename, size, litepcie_device_zero_copy);
     return 0;
 
 show_help:
@@ -33,6 +33,7 @@
 
 static char litepcie_device[1024];
 static int litepcie_device_num;
+static int litepcie_fd = -1;
 
 sig_atomic_t keep_running = 1;
 
@@ -51,28 +52,20 @@ int spi_write_then_read(struct spi_device *spi,
                         const unsigned char *txbuf, unsigned n_tx,
                         unsigned char *rxbuf, unsigned n_rx)
 {
-    int fd;
-
-    fd = open(litepcie_device, O_RDWR);
-    if (fd < 0) {
-        fprintf(stderr, "Could not init driver\n");
-        exit(1);
-    }
-
-    if (n_tx == 2 && n_rx == 1) {
-        /* read */
-        rxbuf[0] = m2sdr_ad9361_spi_read(fd, txbuf[0] << 8 | txbuf[1]);
-    } else if (n_tx == 3 && n_rx == 0) {
-        /* write */
-        m2sdr_ad9361_spi_write(fd, txbuf[0] << 8 | txbuf[1], txbuf[2]);
+    int fd = litepcie_fd;
+
+    if (n_tx == 2 && n_rx >= 1 && n_rx <= AD9361_SPI_MAX_BURST) {
+        /* read (multi-byte reads in bursts) */
+        m2sdr_ad9361_spi_readm(fd, (txbuf[0] << 8 | txbuf[1]) & 0x3ff, rxbuf, n_rx);
+    } else if (n_tx >= 3 && n_tx <= 2 + AD9361_SPI_MAX_BURST && n_rx == 0) {
+        /* write (multi-byte writes in bursts) */
+        m2sdr_ad9361_spi_writem(fd, (txbuf[0] << 8 | txbuf[1]) & 0x3ff, &txbuf[2], n_tx - 2);
     } else {
         fprintf(stderr, "Unsupported SPI transfer n_tx=%d n_rx=%d\n",
                 n_tx, n_rx);
         exit(1);
     }
 
-    close(fd);
-
     return 0;
 }
 
@@ -107,6 +100,20 @@ void gpio_set_value(unsigned gpio, int value)
 
 }
 
+/* Print the AD9361 SPI accesses since the last call (and those saved by the register cache). */
+static void ad9361_print_spi_stats(struct ad9361_rf_phy *phy)
+{
+    static struct ad9361_spi_stats last;
+    struct ad9361_spi_stats stats;
+
+    ad9361_spi_get_stats(phy->spi, &stats);
+    printf("AD9361 SPI: %u reads (%u cached), %u writes (%u elided), %u transfers.\n",
+        stats.reads  - last.reads,  stats.reads_cached  - last.reads_cached,
+        stats.writes - last.writes, stats.writes_elided - last.writes_elided,
+        stats.transfers - last.transfers);
+    last = stats;
+}
+
 /* M2SDR Init */
 /*------------*/
 
@@ -136,9 +143,17 @@ static void m2sdr_init(
         exit(1);
     }
 
+    /* Direct MMIO CSR accesses when allowed by the driver (ioctls otherwise). */
+    litepcie_csr_mmap(fd);
+
+    /* Shared with the AD9361 SPI transfers. */
+    litepcie_fd = fd;
+
 #ifdef  CSR_SI5351_BASE
     /* Initialize SI531 Clocking */
     printf("Initializing SI5351 Clocking...\n");
+    int64_t si5351_time = get_time_ms();
+    int si5351_writes = 0;
 
     /* Internal Sync */
     if (strcmp(sync_mode, "internal") == 0) {
@@ -147,7 +162,7 @@ static void m2sdr_init(
         litepcie_writel(fd, CSR_SI5351_CONTROL_ADDR,
             SI5351B_VERSION * (1 << CSR_SI5351_CONTROL_VERSION_OFFSET) /* SI5351B Version. */
         );
-        m2sdr_si5351_i2c_config(fd, SI5351_I2C_ADDR, si5351_xo_config, sizeof(si5351_xo_config)/sizeof(si5351_xo_config[0]));
+        si5351_writes = m2sdr_si5351_i2c_config(fd, SI5351_I2C_ADDR, si5351_xo_config, sizeof(si5351_xo_config)/sizeof(si5351_xo_config[0]));
 
     /* External Sync */
     } else if (strcmp(sync_mode, "external") == 0) {
@@ -157,12 +172,14 @@ static void m2sdr_init(
               SI5351C_VERSION               * (1 << CSR_SI5351_CONTROL_VERSION_OFFSET)    | /* SI5351C Version. */
               SI5351C_10MHZ_CLK_IN_FROM_UFL * (1 << CSR_SI5351_CONTROL_CLK_IN_SRC_OFFSET)   /* ClkIn from uFL. */
         );
-        m2sdr_si5351_i2c_config(fd, SI5351_I2C_ADDR, si5351_clkin_10m_config, sizeof(si5351_clkin_10m_config)/sizeof(si5351_clkin_10m_config[0]));
+        si5351_writes = m2sdr_si5351_i2c_config(fd, SI5351_I2C_ADDR, si5351_clkin_10m_config, sizeof(si5351_clkin_10m_config)/sizeof(si5351_clkin_10m_config[0]));
     /* Invalid Sync */
     } else {
         fprintf(stderr, "Invalid synchronization mode: %s\n", sync_mode);
         exit(1);
     }
+    printf("SI5351 Clocking initialized in %d ms (%d registers updated).\n",
+        (int)(get_time_ms() - si5351_time), si5351_writes);
 #endif
 
     /* Initialize AD9361 SPI */
@@ -192,7 +209,13 @@ static void m2sdr_init(
         default_init_param.two_t_two_r_timing_enable     = 1;
         litepcie_writel(fd, CSR_AD9361_PHY_CONTROL_ADDR, 0);
     }
+    int64_t init_time = get_time_ms();
     ad9361_init(&ad9361_phy, &default_init_param, 1);
+    printf("AD9361 RFIC initialized in %d ms.\n", (int)(get_time_ms() - init_time));
+    ad9361_print_spi_stats(ad9361_phy);
+
+    /* The configuration below is a single sequence: use the SPI register cache until its end. */
+    ad9361_spi_cache_begin(ad9361_phy->spi);
 
     /* Configure AD9361 Samplerate */
     printf("Setting TX/RX Samplerate to %f MSPS.\n", samplerate/1e6);
@@ -225,8 +248,11 @@ static void m2sdr_init(
     /* Configure AD9361 TX/RX Frequencies */
     printf("Setting TX LO Freq to %f MHz.\n", tx_freq/1e6);
     printf("Setting RX LO Freq to %f MHz.\n", rx_freq/1e6);
+    int64_t tune_time = get_time_ms();
     ad9361_set_tx_lo_freq(ad9361_phy, tx_freq);
     ad9361_set_rx_lo_freq(ad9361_phy, rx_freq);
+    printf("TX/RX LO Freqs set in %d ms.\n", (int)(get_time_ms() - tune_time));
+    ad9361_print_spi_stats(ad9361_phy);
 
     /* Configure AD9361 TX/RX FIRs */
     ad9361_set_tx_fir_config(ad9361_phy, tx_fir_config);
@@ -408,6 +434,10 @@ static void m2sdr_init(
         ad9361_enable_oversampling(ad9361_phy);
     }
 
+    ad9361_spi_cache_end(ad9361_phy->spi);
+
+    litepcie_fd = -1;
+    litepcie_csr_munmap(fd);
     close(fd);
 }
 
@@ -0,0 +1,304 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+ *
+ * M2SDR RX Server Utility.
+ *
+ * This file is part of LiteX-M2SDR project.
+ *
+ * Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "liblitepcie.h"
+#include "libm2sdr.h"
+
+/* Variables */
+/*-----------*/
+
+sig_atomic_t keep_running = 1;
+
+void intHandler(int dummy) {
+    keep_running = 0;
+}
+
+/* Timestamps */
+/*------------*/
+
+/* Estimate the time at the end of the new DMA buffers from the kernel MSI timestamps (FPGA time when
+ * available on both records, host time otherwise): anchor on the latest record, period from the
+ * oldest one. */
+static void m2sdr_server_timestamps(int fd, struct m2sdr_shm *shm, int64_t first, int64_t last)
+{
+    static struct litepcie_ioctl_dma_timestamps m;
+    struct litepcie_dma_timestamp *oldest, *latest;
+    int64_t oldest_time, latest_time;
+    int64_t period = 0;
+    int64_t k;
+
+    litepcie_dma_get_timestamps(fd, 1, &m);
+    if (m.count == 0) {
+        for (k = first; k < last; k++)
+            shm->buf_time[k % DMA_BUFFER_COUNT] = 0;
+        return;
+    }
+    oldest = &m.ts[0];
+    latest = &m.ts[m.count - 1];
+    if (oldest->fpga_time && latest->fpga_time) {
+        oldest_time = oldest->fpga_time;
+        latest_time = latest->fpga_time;
+    } else {
+        oldest_time = oldest->host_time;
+        latest_time = latest->host_time;
+    }
+    if (latest->hw_count > oldest->hw_count)
+        period = (latest_time - oldest_time) / (latest->hw_count - oldest->hw_count);
+
+    for (k = first; k < last; k++)
+        shm->buf_time[k % DMA_BUFFER_COUNT] = latest_time + (k + 1 - latest->hw_count) * period;
+}
+
+/* Server (DMA RX) */
+/*-----------------*/
+
+/* Remove a stale Shared-Memory segment (server stopped or dead), fail if its server is running. */
+static int m2sdr_server_remove_stale(const char *shm_name)
+{
+    struct m2sdr_shm *shm;
+    struct stat st;
+    int32_t pid = 0;
+    int shm_fd;
+
+    shm_fd = shm_open(shm_name, O_RDONLY, 0);
+    if (shm_fd < 0) {
+        if (errno == ENOENT)
+            return 0;
+        perror(shm_name);
+        return -1;
+    }
+    if (fstat(shm_fd, &st) == 0 && st.st_size >= (off_t)sizeof(struct m2sdr_shm)) {
+        shm = mmap(NULL, sizeof(struct m2sdr_shm), PROT_READ, MAP_SHARED, shm_fd, 0);
+        if (shm != MAP_FAILED) {
+            pid = __atomic_load_n(&shm->server_pid, __ATOMIC_ACQUIRE);
+            munmap(shm, sizeof(struct m2sdr_shm));
+        }
+    }
+    close(shm_fd);
+
+    if (pid != 0 && !(kill(pid, 0) < 0 && errno == ESRCH)) {
+        fprintf(stderr, "%s already served by m2sdr_server (pid %d)\n", shm_name, (int)pid);
+        return -1;
+    }
+    shm_unlink(shm_name);
+    return 0;
+}
+
+static void m2sdr_server(const char *device_name, int device_num, const char *group)
+{
+    static struct litepcie_dma_ctrl dma = {.use_writer = 1};
+
+    struct m2sdr_shm *shm;
+    char shm_name[1024];
+    int shm_fd;
+    int i, j;
+    int clients;
+    int64_t hw_count;
+    int64_t last_time;
+    int64_t hw_count_last = 0;
+
+    /* Create Shared-Memory (new segment, owner only or owner/group: it holds control state). */
+    snprintf(shm_name, sizeof(shm_name), M2SDR_SHM_NAME, device_num);
+    if (m2sdr_server_remove_stale(shm_name) < 0)
+        exit(1);
+    shm_fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (shm_fd < 0) {
+        perror(shm_name);
+        exit(1);
+    }
+    if (group != NULL) {
+        struct group *gr = getgrnam(group);
+        if (gr == NULL) {
+            fprintf(stderr, "Unknown group %s\n", group);
+            shm_unlink(shm_name);
+            exit(1);
+        }
+        if (fchown(shm_fd, -1, gr->gr_gid) < 0 || fchmod(shm_fd, 0660) < 0) {
+            perror(shm_name);
+            shm_unlink(shm_name);
+            exit(1);
+        }
+    }
+    if (ftruncate(shm_fd, sizeof(struct m2sdr_shm)) < 0) {
+        perror("ftruncate");
+        exit(1);
+    }
+    shm = mmap(NULL, sizeof(struct m2sdr_shm), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (shm == MAP_FAILED) {
+        fprintf(stderr, "MMAP failed\n");
+        exit(1);
+    }
+
+    /* Claim the segment (before the DMA initialization, for the stale segment check). */
+    memset(shm, 0, sizeof(struct m2sdr_shm));
+    __atomic_store_n(&shm->server_pid, getpid(), __ATOMIC_RELEASE);
+
+    /* Initialize DMA (zero-copy: clients read the DMA buffers directly). */
+    if (litepcie_dma_init(&dma, device_name, 1)) {
+        shm_unlink(shm_name);
+        exit(1);
+    }
+
+    dma.writer_enable = 1;
+
+    /* Latch FPGA time on DMA MSIs for the buffer timestamps. */
+    litepcie_dma_enable_fpga_timestamps(dma.fds.fd, 1);
+
+    /* Publish Shared-Memory (magic last). */
+    shm->version    = M2SDR_SHM_VERSION;
+    shm->buf_size   = dma.mmap_dma_info.dma_rx_buf_size;
+    shm->buf_count  = dma.mmap_dma_info.dma_rx_buf_count;
+    __atomic_store_n(&shm->magic, M2SDR_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    printf("Serving %s on %s (%d clients max)...\n", device_name, shm_name, M2SDR_SHM_MAX_CLIENTS);
+
+    /* Server Loop. */
+    i = 0;
+    last_time = get_time_ms();
+    for (;;) {
+        /* Exit loop on CTRL+C. */
+        if (!keep_running)
+            break;
+
+        /* Update DMA status (also releases the DMA buffers: the DMA never waits on the clients). */
+        litepcie_dma_process(&dma);
+
+        /* Publish new DMA buffers and wake up the clients. */
+        hw_count = dma.writer_sw_count + dma.buffers_available_read;
+        dma.buffers_available_read = 0;
+        if (hw_count > shm->hw_count) {
+            m2sdr_server_timestamps(dma.fds.fd, shm, shm->hw_count, hw_count);
+            __atomic_store_n(&shm->hw_count, hw_count, __ATOMIC_RELEASE);
+            m2sdr_shm_notify(shm);
+        }
+
+        /* Statistics every 1s. */
+        int64_t duration = get_time_ms() - last_time;
+        if (duration > 1000) {
+            /* Reap dead clients. */
+            clients = 0;
+            for (j = 0; j < M2SDR_SHM_MAX_CLIENTS; j++) {
+                int32_t pid = __atomic_load_n(&shm->clients[j].pid, __ATOMIC_ACQUIRE);
+                if (pid == 0)
+                    continue;
+                if (kill(pid, 0) < 0 && errno == ESRCH) {
+                    __sync_bool_compare_and_swap(&shm->clients[j].pid, pid, 0);
+                    continue;
+                }
+                clients++;
+            }
+            /* Print banner every 10 lines. */
+            if (i % 10 == 0)
+                printf("\e[1mSPEED(Gbps)    BUFFERS CLIENTS OVERFLOWS\e[0m\n");
+            i++;
+            /* Print statistics. */
+            uint64_t overflows = 0;
+            for (j = 0; j < M2SDR_SHM_MAX_CLIENTS; j++) {
+                if (shm->clients[j].pid != 0)
+                    overflows += shm->clients[j].overflows;
+            }
+            printf("%10.2f %10" PRId64 " %7d %9" PRIu64 "\n",
+                    (double)(shm->hw_count - hw_count_last) * DMA_BUFFER_SIZE * 8 / ((double)duration * 1e6),
+                    shm->hw_count,
+                    clients,
+                    overflows);
+            /* Update time/count. */
+            last_time = get_time_ms();
+            hw_count_last = shm->hw_count;
+        }
+    }
+
+    /* Stop clients. */
+    __atomic_store_n(&shm->server_pid, 0, __ATOMIC_RELEASE);
+    m2sdr_shm_notify(shm);
+
+    /* Cleanup DMA. */
+    litepcie_dma_cleanup(&dma);
+
+    /* Remove Shared-Memory. */
+    munmap(shm, sizeof(struct m2sdr_shm));
+    shm_unlink(shm_name);
+}
+
+/* Help */
+/*------*/
+
+static void help(void)
+{
+    printf("M2SDR RX Server Utility\n"
+           "usage: m2sdr_server [options]\n"
+           "\n"
+           "Owns the RX DMA of the device and shares the received buffers with multiple client\n"
+           "processes (zero-copy, per-client cursor and overflow accounting, see m2sdr_shm.h).\n"
+           "\n"
+           "Options:\n"
+           "-h                    Display this help message.\n"
+           "-c device_num         Select the device (default = 0).\n"
+           "-g group              Share with the members of group (default: owner only).\n");
+    exit(1);
+}
+
+/* Main */
+/*------*/
+
+int main(int argc, char **argv)
+{
+    int c;
+    static char litepcie_device[1024];
+    static int litepcie_device_num;
+    static char *group;
+
+    litepcie_device_num = 0;
+    group = NULL;
+
+    signal(SIGINT, intHandler);
+    signal(SIGTERM, intHandler);
+
+    /* Parameters. */
+    for (;;) {
+        c = getopt(argc, argv, "hc:g:");
+        if (c == -1)
+            break;
+        switch(c) {
+        case 'h':
+            help();
+            break;
+        case 'c':
+            litepcie_device_num = atoi(optarg);
+            break;
+        case 'g':
+            group = optarg;
+            break;
+        default:
+            exit(1);
+        }
+    }
+
+    /* Select device. */
+    snprintf(litepcie_device, sizeof(litepcie_device), "/dev/m2sdr%d", litepcie_device_num);
+
+    /* Serve. */
+    m2sdr_server(litepcie_device, litepcie_device_num, group);
+
+    return 0;
+}
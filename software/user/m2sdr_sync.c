@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: BSD-2-Clause
+ *
+ * M2SDR Multi-Board Sync Utility.
+ *
+ * This file is part of LiteX-M2SDR project.
+ *
+ * Copyright (c) 2024-2025 Enjoy-Digital <enjoy-digital.fr>
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <getopt.h>
+
+#include "liblitepcie.h"
+#include "libm2sdr.h"
+
+/* Parameters */
+/*------------*/
+
+#define DEFAULT_TIME      1000000000 /* Small start time: PPSGenerator catches up the seconds after a Time write. */
+#define DEFAULT_TOLERANCE 1000
+#define DEFAULT_RETRIES   3
+#define DEFAULT_ARM_GUARD 100000000 /* Arm the DMAs at least 100ms after a PPS edge. */
+#define DMA_CHECK_TIME    500000000 /* Let the DMAs run 500ms before comparing their counts. */
+
+/* Variables */
+/*-----------*/
+
+static int m2sdr_fds[M2SDR_SYNC_MAX_BOARDS];
+static int m2sdr_device_nums[M2SDR_SYNC_MAX_BOARDS];
+static int m2sdr_count;
+
+/* M2SDR DMA Check */
+/*-----------------*/
+
+static void m2sdr_dma_check(void)
+{
+    int i;
+    int64_t hw_counts[M2SDR_SYNC_MAX_BOARDS];
+    int64_t sw_count;
+    uint64_t pps_ns, now_ns;
+
+    /* Request the RX DMAs. */
+    for (i = 0; i < m2sdr_count; i++) {
+        if (litepcie_request_dma(m2sdr_fds[i], 0, 1) == 0) {
+            fprintf(stderr, "DMA of m2sdr%d not available\n", m2sdr_device_nums[i]);
+            exit(1);
+        }
+    }
+
+    /* Start the RX DMAs on a common PPS edge. */
+    pps_ns = m2sdr_sync_dma_start(m2sdr_fds, m2sdr_count, DEFAULT_ARM_GUARD, 0, 1);
+    if (pps_ns == 0) {
+        fprintf(stderr, "Could not arm the DMAs before the PPS edge.\n");
+        exit(1);
+    }
+    printf("RX DMAs armed, starting on PPS at %" PRIu64 " ns.\n", pps_ns);
+
+    /* Let the DMAs run and compare their buffer counts (updated on MSIs). */
+    now_ns = m2sdr_time_read(m2sdr_fds[0]);
+    if (now_ns < pps_ns + DMA_CHECK_TIME)
+        usleep((pps_ns + DMA_CHECK_TIME - now_ns) / 1000);
+    for (i = 0; i < m2sdr_count; i++)
+        litepcie_dma_writer(m2sdr_fds[i], 1, &hw_counts[i], &sw_count);
+    for (i = 0; i < m2sdr_count; i++)
+        printf("  m2sdr%d: %" PRId64 " buffers (%+" PRId64 ", MSI granularity: %d buffers)\n",
+            m2sdr_device_nums[i], hw_counts[i], hw_counts[i] - hw_counts[0], DMA_BUFFER_PER_IRQ);
+
+    /* Stop/Release the RX DMAs. */
+    for (i = 0; i < m2sdr_count; i++) {
+        litepcie_dma_writer(m2sdr_fds[i], 0, &hw_counts[i], &sw_count);
+        litepcie_release_dma(m2sdr_fds[i], 0, 1);
+    }
+}
+
+/* M2SDR Sync */
+/*------------*/
+
+static void m2sdr_sync(uint64_t time_ns, uint64_t tolerance, bool force, bool dma_check)
+{
+    int i;
+    int retry;
+    int clkin_mask;
+    char device[1024];
+    int64_t offsets[M2SDR_SYNC_MAX_BOARDS];
+    uint64_t uncertainty;
+    uint64_t max_offset = 0;
+
+    /* Open devices. */
+    for (i = 0; i < m2sdr_count; i++) {
+        snprintf(device, sizeof(device), "/dev/m2sdr%d", m2sdr_device_nums[i]);
+        m2sdr_fds[i] = open(device, O_RDWR);
+        if (m2sdr_fds[i] < 0) {
+            fprintf(stderr, "Could not open %s\n", device);
+            exit(1);
+        }
+    }
+
+    /* Check common 10MHz reference. */
+    clkin_mask = m2sdr_sync_check_clkin(m2sdr_fds, m2sdr_count);
+    for (i = 0; i < m2sdr_count; i++) {
+        if (clkin_mask & (1 << i))
+            fprintf(stderr, "m2sdr%d is not using the external 10MHz reference (see m2sdr_rf -sync external).\n",
+                m2sdr_device_nums[i]);
+    }
+    if (clkin_mask && !force)
+        exit(1);
+
+    /* Hardware Time Sync. */
+    for (retry = 0; retry < DEFAULT_RETRIES; retry++) {
+        printf("Setting Time to %" PRIu64 " ns on %d boards...\n", time_ns, m2sdr_count);
+        max_offset  = m2sdr_sync_time(m2sdr_fds, m2sdr_count, time_ns, offsets);
+        uncertainty = m2sdr_sync_measure(m2sdr_fds, m2sdr_count, offsets);
+        for (i = 0; i < m2sdr_count; i++)
+            printf("  m2sdr%d: offset %+" PRId64 " ns (+-%" PRIu64 " ns)\n",
+                m2sdr_device_nums[i], offsets[i], uncertainty);
+        if (max_offset <= tolerance)
+            break;
+    }
+    if (max_offset > tolerance) {
+        fprintf(stderr, "Time offset (%" PRIu64 " ns) above tolerance (%" PRIu64 " ns).\n", max_offset, tolerance);
+        exit(1);
+    }
+
+    /* DMAs armed on all boards before this PPS (kernel DMA Synchronizer) will start on it. */
+    printf("Next common PPS at %" PRIu64 " ns.\n", m2sdr_sync_next_pps(m2sdr_fds[0]));
+
+    /* Check the RX DMAs start together. */
+    if (dma_check)
+        m2sdr_dma_check();
+
+    /* Close devices. */
+    for (i = 0; i < m2sdr_count; i++)
+        close(m2sdr_fds[i]);
+}
+
+/* Help */
+/*------*/
+
+static void help(void)
+{
+    printf("M2SDR Multi-Board Sync Utility\n"
+           "usage: m2sdr_sync [options]\n"
+           "\n"
+           "Options:\n"
+           "  -h                     Show this help message and exit.\n"
+           "  -d device_nums         Select the devices, comma separated (default: 0).\n"
+           "  -time ns               Set the common Hardware Time in ns (default: %d).\n"
+           "  -tolerance ns          Set the max Time offset between boards in ns (default: %d).\n"
+           "  -force                 Continue even if boards are not on the external 10MHz reference.\n"
+           "  -dma_check             Start the RX DMAs of all boards on a common PPS and compare their counts.\n",
+           DEFAULT_TIME,
+           DEFAULT_TOLERANCE);
+    exit(1);
+}
+
+static struct option options[] = {
+    { "help",      no_argument, NULL, 'h' }, /* 0 */
+    { "time",      required_argument },      /* 1 */
+    { "tolerance", required_argument },      /* 2 */
+    { "force",     no_argument },            /* 3 */
+    { "dma_check", no_argument },            /* 4 */
+    { NULL },
+};
+
+/* Main */
+/*------*/
+
+int main(int argc, char **argv)
+{
+    int c;
+    int option_index;
+    char *token;
+
+    bool     force = false;
+    bool     dma_check = false;
+    uint64_t time_ns;
+    uint64_t tolerance;
+
+    m2sdr_count          = 1;
+    m2sdr_device_nums[0] = 0;
+    time_ns              = DEFAULT_TIME;
+    tolerance            = DEFAULT_TOLERANCE;
+
+    /* Parse/Handle Parameters. */
+    for (;;) {
+        c = getopt_long_only(argc, argv, "hd:", options, &option_index);
+        if (c == -1)
+            break;
+        switch(c) {
+        case 0 :
+            switch(option_index) {
+                case 1: /* time */
+                    time_ns = (uint64_t)strtod(optarg, NULL);
+                    break;
+                case 2: /* tolerance */
+                    tolerance = (uint64_t)strtod(optarg, NULL);
+                    break;
+                case 3: /* force */
+                    force = true;
+                    break;
+                case 4: /* dma_check */
+                    dma_check = true;
+                    break;
+                default:
+                    fprintf(stderr, "unknown option index: %d\n", option_index);
+                    exit(1);
+            }
+            break;
+        case 'h':
+            help();
+            exit(1);
+            break;
+        case 'd':
+            m2sdr_count = 0;
+            for (token = strtok(optarg, ","); token; token = strtok(NULL, ",")) {
+                if (m2sdr_count == M2SDR_SYNC_MAX_BOARDS) {
+                    fprintf(stderr, "Too many devices (max: %d)\n", M2SDR_SYNC_MAX_BOARDS);
+                    exit(1);
+                }
+                m2sdr_device_nums[m2sdr_count++] = atoi(token);
+            }
+            break;
+        default:
+            exit(1);
+        }
+    }
+
+    if (m2sdr_count == 0)
+        help();
+
+    /* Synchronize boards. */
+    m2sdr_sync(time_ns, tolerance, force, dma_check);
+
+    return 0;
+}
@@ -83,8 +83,8 @@ static void test_si5351_init(void)
     }
 
     printf("\e[1m[> SI53512 Init...\e[0m\n");
-    m2sdr_si5351_i2c_config(fd, SI5351_I2C_ADDR, si5351_xo_config, sizeof(si5351_xo_config)/sizeof(si5351_xo_config[0]));
-    printf("Done.\n");
+    int writes = m2sdr_si5351_i2c_config(fd, SI5351_I2C_ADDR, si5351_xo_config, sizeof(si5351_xo_config)/sizeof(si5351_xo_config[0]));
+    printf("Done (%d registers updated).\n", writes);
 
     close(fd);
 }
@@ -133,8 +133,7 @@ static uint32_t icap_read(int fd, uint32_t reg)
 static void info(void)
 {
     int fd;
-    int i;
-    unsigned char fpga_identifier[256];
+    struct litepcie_ioctl_info soc_info;
 
     fd = open(litepcie_device, O_RDWR);
     if (fd < 0) {
@@ -146,14 +145,10 @@ static void info(void)
     printf("\e[1m[> FPGA/SoC Info:\e[0m\n");
     printf("-----------------\n");
 
-    for (i = 0; i < 256; i ++)
-        fpga_identifier[i] = litepcie_readl(fd, CSR_IDENTIFIER_MEM_BASE + 4 * i);
-    printf("SoC Identifier   : %s.\n", fpga_identifier);
+    litepcie_get_info(fd, &soc_info);
+    printf("SoC Identifier   : %s.\n", soc_info.identifier);
 #ifdef CSR_DNA_BASE
-    printf("FPGA DNA         : 0x%08x%08x\n",
-        litepcie_readl(fd, CSR_DNA_ID_ADDR + 4 * 0),
-        litepcie_readl(fd, CSR_DNA_ID_ADDR + 4 * 1)
-    );
+    printf("FPGA DNA         : 0x%016" PRIx64 "\n", soc_info.dna);
 #endif
 #ifdef CSR_XADC_BASE
     printf("FPGA Temperature : %0.1f °C\n",
@@ -213,6 +208,77 @@ void scratch_test(void)
     close(fd);
 }
 
+/* CSR Bench */
+/*-----------*/
+
+static double csr_bench_ns(struct timespec *start, int count)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec)) / count;
+}
+
+static void csr_bench(int count)
+{
+    int fd;
+    int i, backend;
+    struct timespec start;
+    double results[2][3] = {{0}};
+    const char *names[3] = {"CSR read", "CSR write", "AD9361 SPI read"};
+
+    if (count < 10)
+        count = 10;
+
+    printf("\e[1m[> CSR access benchmark:\e[0m\n");
+    printf("------------------------\n");
+
+    /* Open LitePCIe device. */
+    fd = open(litepcie_device, O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "Could not init driver\n");
+        exit(1);
+    }
+
+    /* AD9361 SPI Init */
+    m2sdr_ad9361_spi_init(fd, 0);
+
+    /* Run the same accesses through the ioctl then the MMIO backend. */
+    for (backend = 0; backend < 2; backend++) {
+        if (backend == 1 && litepcie_csr_mmap(fd) < 0) {
+            printf("CSR mmap not available (driver too old or csr_mmap=0).\n");
+            break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < count; i++)
+            litepcie_readl(fd, CSR_CTRL_SCRATCH_ADDR);
+        results[backend][0] = csr_bench_ns(&start, count);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < count; i++)
+            litepcie_writel(fd, CSR_CTRL_SCRATCH_ADDR, i);
+        results[backend][1] = csr_bench_ns(&start, count);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < count/10; i++)
+            m2sdr_ad9361_spi_read(fd, REG_PRODUCT_ID);
+        results[backend][2] = csr_bench_ns(&start, count/10);
+    }
+
+    /* Results. */
+    printf("\e[1m%-16s %12s %12s %8s\e[0m\n", "ACCESS", "IOCTL (ns)", "MMIO (ns)", "SPEEDUP");
+    for (i = 0; i < 3; i++) {
+        if (results[1][i] > 0)
+            printf("%-16s %12.1f %12.1f %7.1fx\n", names[i], results[0][i], results[1][i], results[0][i] / results[1][i]);
+        else
+            printf("%-16s %12.1f %12s %8s\n", names[i], results[0][i], "-", "-");
+    }
+
+    /* Close LitePCIe device. */
+    litepcie_csr_munmap(fd);
+    close(fd);
+}
+
 /* SPI Flash */
 /*-----------*/
 
@@ -247,6 +313,11 @@ static void flash_program(uint32_t base, const uint8_t *buf1, int size1)
 
     /* Get flash sector size and pad size to it. */
     sector_size = litepcie_flash_get_erase_block_size(fd);
+    if (base % sector_size) {
+        fprintf(stderr, "Flash offset 0x%08x must be a multiple of the %d-byte erase sector size\n",
+            base, sector_size);
+        exit(1);
+    }
     size = ((size1 + sector_size - 1) / sector_size) * sector_size;
 
     /* Alloc buffer and copy data to it. */
@@ -315,8 +386,9 @@ static void flash_read(const char *filename, uint32_t size, uint32_t offset)
     FILE * f;
     uint32_t base;
     uint32_t sector_size;
-    uint8_t byte;
-    int i;
+    uint32_t n;
+    uint8_t *buf;
+    uint32_t i;
 
     /* Open data destination file. */
     f = fopen(filename, "wb");
@@ -335,18 +407,26 @@ static void flash_read(const char *filename, uint32_t size, uint32_t offset)
     /* Get flash sector size. */
     sector_size = litepcie_flash_get_erase_block_size(fd);
 
-    /* Read flash and write to destination file. */
+    /* Read flash (one sector at a time, pages per ioctl) and write to destination file. */
+    buf = malloc(sector_size);
+    if (!buf) {
+        fprintf(stderr, "%d: malloc failed\n", __LINE__);
+        exit(1);
+    }
     base = offset;
-    for (i = 0; i < size; i++) {
-        if ((i % sector_size) == 0) {
-            printf("Reading 0x%08x\r", base + i);
-            fflush(stdout);
-        }
-        byte = litepcie_flash_read(fd, base + i);
-        fwrite(&byte, 1, 1, f);
+    for (i = 0; i < size; i += n) {
+        n = size - i;
+        if (n > sector_size)
+            n = sector_size;
+        printf("Reading 0x%08x (%3d%%)\r", base + i, (int)((uint64_t)i * 100 / size));
+        fflush(stdout);
+        litepcie_flash_read_buffer(fd, base + i, buf, n);
+        fwrite(buf, 1, n, f);
     }
+    printf("\n");
 
     /* Close destination file and LitePCIe device. */
+    free(buf);
     fclose(f);
     close(fd);
 }
@@ -639,10 +719,30 @@ static void latch_all_clocks(int fd)
     }
 }
 
-static void read_all_clocks(int fd, uint64_t *values)
+/* Latch and read all the clocks in a single register batch. */
+static void measure_all_clocks(int fd, uint64_t *values)
 {
+    struct litepcie_reg_op ops[3*N_CLKS];
+    int n = 0;
+
+    for (int i = 0; i < N_CLKS; i++) {
+        ops[n].op   = LITEPCIE_REG_OP_WRITE;
+        ops[n].addr = latch_addrs[i];
+        ops[n].val  = 1;
+        n++;
+    }
+    for (int i = 0; i < N_CLKS; i++) {
+        ops[n].op   = LITEPCIE_REG_OP_READ;
+        ops[n].addr = value_addrs[i] + 4;
+        n++;
+        ops[n].op   = LITEPCIE_REG_OP_READ;
+        ops[n].addr = value_addrs[i] + 0;
+        n++;
+    }
+    litepcie_reg_batch(fd, ops, n, 0);
+
     for (int i = 0; i < N_CLKS; i++) {
-        values[i] = read_64bit_register(fd, value_addrs[i]);
+        values[i] = ((uint64_t)ops[N_CLKS + 2*i + 1].val << 32) | ops[N_CLKS + 2*i + 0].val;
     }
 }
 
@@ -661,15 +761,13 @@ static void clk_test(int num_measurements, int delay_between_tests)
     struct timespec start_time, current_time;
     double elapsed_time;
 
-    latch_all_clocks(fd);
-    read_all_clocks(fd, previous_values);
+    measure_all_clocks(fd, previous_values);
     clock_gettime(CLOCK_MONOTONIC, &start_time);
 
     for (int i = 0; i < num_measurements; i++) {
         sleep(delay_between_tests);
 
-        latch_all_clocks(fd);
-        read_all_clocks(fd, current_values);
+        measure_all_clocks(fd, current_values);
         clock_gettime(CLOCK_MONOTONIC, &current_time);
 
         elapsed_time = (current_time.tv_sec - start_time.tv_sec) +
@@ -795,6 +893,7 @@ static void help(void)
            "dma_test                          Test DMA.\n"
            "scratch_test                      Test Scratch register.\n"
            "clk_test                          Test Clks frequencies.\n"
+           "csr_bench [count]                 Benchmark CSR accesses (ioctl vs mmap).\n"
 #ifdef  CSR_SI5351_BASE
            "vcxo_test                         Test VCXO frequency variation.\n"
 #endif
@@ -885,6 +984,16 @@ int main(int argc, char **argv)
     else if (!strcmp(cmd, "scratch_test"))
         scratch_test();
 
+    /* CSR cmds. */
+    else if (!strcmp(cmd, "csr_bench")) {
+        int count = 100000;
+
+        if (optind < argc)
+            count = atoi(argv[optind++]);
+
+        csr_bench(count);
+    }
+
     /* Clk cmds. */
     else if (!strcmp(cmd, "clk_test")) {
         int num_measurements = 10;